@@ -0,0 +1,302 @@
+/*
+* Group-by aggregation (GBY) with multiple tasklets
+*
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <defs.h>
+#include <mram.h>
+#include <alloc.h>
+#include <perfcounter.h>
+#include <barrier.h>
+#include <atomic_bit.h>
+#include <mutex.h>
+
+#include "../support/common.h"
+
+__host dpu_arguments_t DPU_INPUT_ARGUMENTS;
+__host dpu_results_t DPU_RESULTS[NR_TASKLETS];
+
+// Array for communication between adjacent tasklets
+T* message[NR_TASKLETS];
+
+// Barrier
+BARRIER_INIT(my_barrier, NR_TASKLETS);
+
+// Mutexes of the MRAM table
+ATOMIC_BIT_INIT(table_mutexes)[NR_LOCKS];
+mutex_id_t table_mutex[NR_LOCKS];
+
+// Direct-mapped aggregation in each tasklet
+static void aggregate_direct(T *table, KEY *keys, T *values, unsigned int l_size){
+    for(unsigned int j = 0; j < l_size; j++) {
+        table[keys[j]] += values[j];
+    }
+}
+
+// Add a partial sum to the MRAM table
+static void spill(__mram_ptr T *table_mram, KEY key, T sum, T *cache){
+    mutex_id_t mutex = table_mutex[key & (NR_LOCKS - 1)];
+    mutex_lock(mutex);
+    mram_read(&table_mram[key], cache, sizeof(T));
+    *cache += sum;
+    mram_write(cache, &table_mram[key], sizeof(T));
+    mutex_unlock(mutex);
+}
+
+// Hash aggregation in each tasklet. A key that finds no free entry within PROBES slots of its
+// home slot evicts the entry in the home slot to the MRAM table
+static uint64_t aggregate_hash(entry_t *hash, uint32_t shift, __mram_ptr T *table_mram, T *cache, KEY *keys, T *values, unsigned int l_size){
+    uint64_t spills = 0;
+    uint32_t mask = (0xFFFFFFFF >> shift);
+    for(unsigned int j = 0; j < l_size; j++) {
+        KEY key = keys[j];
+        uint32_t home = (key * 2654435761u) >> shift;
+        unsigned int p;
+        for(p = 0; p < PROBES; p++) {
+            entry_t *e = &hash[(home + p) & mask];
+            if(e->key == key) {
+                e->sum += values[j];
+                break;
+            }
+            if(e->key == EMPTY_KEY) {
+                e->key = key;
+                e->sum = values[j];
+                break;
+            }
+        }
+        if(p == PROBES) {
+            entry_t *e = &hash[home];
+            spill(table_mram, e->key, e->sum, cache);
+            e->key = key;
+            e->sum = values[j];
+            spills++;
+        }
+    }
+    return spills;
+}
+
+// Compaction of the occupied entries (non-zero sums) of the DPU table into a list sorted by key, after the
+// table in MRAM. Each tasklet compacts a contiguous range of keys at the offset given by the counts of the
+// previous tasklets. The table is read from WRAM (table_wram) or from MRAM in chunks that fill at most one
+// block of entries
+static void compact_table(T *table_wram, __mram_ptr T *table_mram, __mram_ptr entry_t *list, uint32_t nr_keys, T *cache, entry_t *entries){
+    unsigned int tasklet_id = me();
+    const uint32_t chunk = BLOCK_SIZE / sizeof(entry_t);
+    uint32_t keys_tasklet = divceil(nr_keys, NR_TASKLETS);
+    keys_tasklet = divceil(keys_tasklet, chunk) * chunk;
+    uint32_t first = tasklet_id * keys_tasklet < nr_keys ? tasklet_id * keys_tasklet : nr_keys;
+    uint32_t last = first + keys_tasklet < nr_keys ? first + keys_tasklet : nr_keys;
+
+    // Count
+    uint32_t count = 0;
+    for(uint32_t k = first; k < last; k += chunk){
+        uint32_t l_size = last - k < chunk ? last - k : chunk;
+        T *sums = table_wram ? table_wram + k : cache;
+        if(!table_wram)
+            mram_read(&table_mram[k], cache, l_size * sizeof(T));
+        for(unsigned int j = 0; j < l_size; j++){
+            count += sums[j] != 0;
+        }
+    }
+    DPU_RESULTS[tasklet_id].groups = count;
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t offset = 0;
+    for(unsigned int j = 0; j < tasklet_id; j++){
+        offset += DPU_RESULTS[j].groups;
+    }
+
+    // Write
+    for(uint32_t k = first; k < last; k += chunk){
+        uint32_t l_size = last - k < chunk ? last - k : chunk;
+        T *sums = table_wram ? table_wram + k : cache;
+        if(!table_wram)
+            mram_read(&table_mram[k], cache, l_size * sizeof(T));
+        uint32_t n = 0;
+        for(unsigned int j = 0; j < l_size; j++){
+            if(sums[j] != 0){
+                entries[n].key = k + j;
+                entries[n].sum = sums[j];
+                n++;
+            }
+        }
+        if(n > 0)
+            mram_write(entries, &list[offset], n * sizeof(entry_t));
+        offset += n;
+    }
+}
+
+extern int main_kernel1(void);
+extern int main_kernel2(void);
+
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2};
+
+int main(void) {
+    // Kernel
+    return kernels[DPU_INPUT_ARGUMENTS.kernel]();
+}
+
+// main_kernel1: direct-mapped tables in WRAM, merged by all tasklets
+int main_kernel1() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size; // Keys of this DPU in bytes
+    uint32_t input_size_dpu_bytes_transfer = DPU_INPUT_ARGUMENTS.transfer_size; // Transfer input size (keys) per DPU in bytes
+    uint32_t nr_keys = DPU_INPUT_ARGUMENTS.keys;
+    DPU_RESULTS[tasklet_id].spills = 0;
+
+    // Address of the current processing block in MRAM
+    uint32_t base_tasklet = tasklet_id << (BLOCK_SIZE_LOG2 - 1);
+    uint32_t mram_base_addr_K = (uint32_t)DPU_MRAM_HEAP_POINTER;
+    uint32_t mram_base_addr_V = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes_transfer);
+    uint32_t mram_base_addr_table = (uint32_t)(DPU_MRAM_HEAP_POINTER + 3 * input_size_dpu_bytes_transfer);
+
+    // Initialize a local cache to store the MRAM block
+    KEY *cache_K = (KEY *) mem_alloc(BLOCK_SIZE >> 1);
+    T *cache_V = (T *) mem_alloc(BLOCK_SIZE);
+
+    // Local table
+    T *table = (T *) mem_alloc(nr_keys * sizeof(T));
+    for(unsigned int i = 0; i < nr_keys; i++){
+        table[i] = 0;
+    }
+
+    // Aggregate
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += (BLOCK_SIZE >> 1) * NR_TASKLETS){
+
+        // Bound checking
+        uint32_t l_size_bytes = (byte_index + (BLOCK_SIZE >> 1) >= input_size_dpu_bytes) ? (input_size_dpu_bytes - byte_index) : (BLOCK_SIZE >> 1);
+        uint32_t l_size = l_size_bytes / sizeof(KEY);
+
+        // Load cache with current MRAM block
+        mram_read((const __mram_ptr void*)(mram_base_addr_K + byte_index), cache_K, (l_size_bytes + 7) & ~7);
+        mram_read((const __mram_ptr void*)(mram_base_addr_V + (byte_index << 1)), cache_V, l_size * sizeof(T));
+
+        aggregate_direct(table, cache_K, cache_V, l_size);
+
+    }
+    message[tasklet_id] = table;
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    T *table_dpu = message[0];
+
+    for (unsigned int i = tasklet_id; i < nr_keys; i += NR_TASKLETS){
+        T s = 0;
+        for (unsigned int j = 0; j < NR_TASKLETS; j++){
+            s += *(message[j] + i);
+        }
+        table_dpu[i] = s;
+    }
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    // Write dpu table to MRAM
+    uint32_t table_bytes = nr_keys * sizeof(T);
+    for(unsigned int byte_index = tasklet_id << 11; byte_index < table_bytes; byte_index += 2048 * NR_TASKLETS){
+        uint32_t l_size_bytes = (byte_index + 2048 >= table_bytes) ? (table_bytes - byte_index) : 2048;
+        mram_write(table_dpu + (byte_index >> DIV), (__mram_ptr void*)(mram_base_addr_table + byte_index), l_size_bytes);
+    }
+
+    // Compacted table
+    compact_table(table_dpu, NULL, (__mram_ptr entry_t *)(mram_base_addr_table + table_bytes), nr_keys, NULL, (entry_t *) cache_V);
+
+    return 0;
+}
+
+// main_kernel2: hash tables in WRAM, spilled to a direct-mapped table in MRAM
+int main_kernel2() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+        for (unsigned int i = 0; i < NR_LOCKS; i++)
+            table_mutex[i] = &ATOMIC_BIT_GET(table_mutexes)[i];
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size; // Keys of this DPU in bytes
+    uint32_t input_size_dpu_bytes_transfer = DPU_INPUT_ARGUMENTS.transfer_size; // Transfer input size (keys) per DPU in bytes
+    uint32_t nr_keys = DPU_INPUT_ARGUMENTS.keys;
+
+    // Address of the current processing block in MRAM
+    uint32_t base_tasklet = tasklet_id << (BLOCK_SIZE_LOG2 - 1);
+    uint32_t mram_base_addr_K = (uint32_t)DPU_MRAM_HEAP_POINTER;
+    uint32_t mram_base_addr_V = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes_transfer);
+    __mram_ptr T *table_mram = (__mram_ptr T *)(DPU_MRAM_HEAP_POINTER + 3 * input_size_dpu_bytes_transfer);
+
+    // Initialize a local cache to store the MRAM block
+    KEY *cache_K = (KEY *) mem_alloc(BLOCK_SIZE >> 1);
+    T *cache_V = (T *) mem_alloc(BLOCK_SIZE);
+    T *cache_S = (T *) mem_alloc(sizeof(T));
+
+    // Local hash table: 2^(32 - shift) entries
+    uint32_t shift = 32;
+    while((2u << (32 - shift)) * sizeof(entry_t) * NR_TASKLETS <= WRAM_TABLE)
+        shift--;
+    uint32_t hash_entries = 1 << (32 - shift);
+    entry_t *hash = (entry_t *) mem_alloc(hash_entries * sizeof(entry_t));
+    for(unsigned int i = 0; i < hash_entries; i++){
+        hash[i].key = EMPTY_KEY;
+    }
+
+    // Clear the MRAM table
+    for(unsigned int i = 0; i < (BLOCK_SIZE >> DIV); i++){
+        cache_V[i] = 0;
+    }
+    uint32_t table_bytes = nr_keys * sizeof(T);
+    for(unsigned int byte_index = tasklet_id << BLOCK_SIZE_LOG2; byte_index < table_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+        uint32_t l_size_bytes = (byte_index + BLOCK_SIZE >= table_bytes) ? (table_bytes - byte_index) : BLOCK_SIZE;
+        mram_write(cache_V, (__mram_ptr void*)((uint32_t)table_mram + byte_index), l_size_bytes);
+    }
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    // Aggregate
+    uint64_t spills = 0;
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += (BLOCK_SIZE >> 1) * NR_TASKLETS){
+
+        // Bound checking
+        uint32_t l_size_bytes = (byte_index + (BLOCK_SIZE >> 1) >= input_size_dpu_bytes) ? (input_size_dpu_bytes - byte_index) : (BLOCK_SIZE >> 1);
+        uint32_t l_size = l_size_bytes / sizeof(KEY);
+
+        // Load cache with current MRAM block
+        mram_read((const __mram_ptr void*)(mram_base_addr_K + byte_index), cache_K, (l_size_bytes + 7) & ~7);
+        mram_read((const __mram_ptr void*)(mram_base_addr_V + (byte_index << 1)), cache_V, l_size * sizeof(T));
+
+        spills += aggregate_hash(hash, shift, table_mram, cache_S, cache_K, cache_V, l_size);
+
+    }
+
+    // Flush the local hash table
+    for(unsigned int i = 0; i < hash_entries; i++){
+        if(hash[i].key != EMPTY_KEY)
+            spill(table_mram, hash[i].key, hash[i].sum, cache_S);
+    }
+    DPU_RESULTS[tasklet_id].spills = spills;
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    // Compacted table
+    compact_table(NULL, table_mram, (__mram_ptr entry_t *)((uint32_t)table_mram + table_bytes), nr_keys, (T *) cache_K, (entry_t *) cache_V);
+
+    return 0;
+}
@@ -0,0 +1,327 @@
+/**
+* app.c
+* GBY Host Application Source File
+*
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dpu.h>
+#include <dpu_log.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <assert.h>
+
+#include "../support/common.h"
+#include "../support/timer.h"
+#include "../support/params.h"
+#include "../support/pool.h"
+
+// Define the DPU Binary path as DPU_BINARY here
+#ifndef DPU_BINARY
+#define DPU_BINARY "./bin/dpu_code"
+#endif
+
+#if ENERGY
+#include <dpu_probe.h>
+#endif
+
+// Pointer declaration
+static KEY* A_keys;
+static T* A_values;
+static T* table_host;
+static void* staging;
+static T* table;
+
+// Create input arrays
+static void read_input(KEY* keys, T* values, unsigned int nr_elements, unsigned int nr_keys) {
+    srand(0);
+    printf("nr_elements\t%u\tnr_keys\t%u\t", nr_elements, nr_keys);
+    for (unsigned int i = 0; i < nr_elements; i++) {
+        keys[i] = (KEY)(rand() % nr_keys);
+        values[i] = (T)(rand() % 100);
+    }
+}
+
+// Compute output in the host
+static void group_by_host(T* table, KEY* keys, T* values, unsigned int nr_elements, unsigned int nr_keys) {
+    memset(table, 0, nr_keys * sizeof(T));
+    for (unsigned int i = 0; i < nr_elements; i++) {
+        table[keys[i]] += values[i];
+    }
+}
+
+// Merge of the DPU tables: each host thread sums a range of keys over all DPUs
+typedef struct {
+    T *table;
+    void *staging; // Dense tables (nr_keys sums) or compacted tables (stride entries) of the DPUs
+    uint32_t *groups;
+    uint32_t stride;
+    unsigned int nr_keys;
+    unsigned int nr_dpus;
+} merge_args_t;
+
+static void merge_tables(void *arg, unsigned int thread, unsigned int nr_threads) {
+    merge_args_t *m = (merge_args_t *) arg;
+    T *table_dpus = (T *) m->staging;
+    uint64_t first, last;
+    pool_range(m->nr_keys, thread, nr_threads, &first, &last);
+    memcpy(&m->table[first], &table_dpus[first], (last - first) * sizeof(T));
+    for (unsigned int i = 1; i < m->nr_dpus; i++) {
+        T *partial = table_dpus + (uint64_t) i * m->nr_keys;
+        for (uint64_t k = first; k < last; k++) {
+            m->table[k] += partial[k];
+        }
+    }
+}
+
+// The compacted tables are sorted by key: each host thread finds the first key of its range in every DPU
+static void merge_lists(void *arg, unsigned int thread, unsigned int nr_threads) {
+    merge_args_t *m = (merge_args_t *) arg;
+    uint64_t first, last;
+    pool_range(m->nr_keys, thread, nr_threads, &first, &last);
+    memset(&m->table[first], 0, (last - first) * sizeof(T));
+    for (unsigned int i = 0; i < m->nr_dpus; i++) {
+        entry_t *list = (entry_t *) m->staging + (uint64_t) i * m->stride;
+        uint32_t lo = 0, hi = m->groups[i];
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (list[mid].key < first)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (uint32_t j = lo; j < m->groups[i] && list[j].key < last; j++) {
+            m->table[list[j].key] += list[j].sum;
+        }
+    }
+}
+
+// Main of the Host Application
+int main(int argc, char **argv) {
+
+    struct Params p = input_params(argc, argv);
+
+    struct dpu_set_t dpu_set, dpu;
+    uint32_t nr_of_dpus;
+
+#if ENERGY
+    struct dpu_probe_t probe;
+    DPU_ASSERT(dpu_probe_init("energy_probe", &probe));
+#endif
+
+    // Allocate DPUs and load binary
+    DPU_ASSERT(dpu_alloc(NR_DPUS, NULL, &dpu_set));
+    DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
+    DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
+    printf("Allocated %d DPU(s)\n", nr_of_dpus);
+
+    unsigned int i = 0;
+
+    const unsigned int input_size = p.exp == 0 ? p.input_size * nr_of_dpus : p.input_size; // Total input size (weak or strong scaling)
+    const unsigned int input_size_dpu = divceil(input_size, nr_of_dpus); // Input size per DPU (max.)
+    const unsigned int input_size_dpu_8bytes =
+        ((input_size_dpu * sizeof(KEY)) % 8) != 0 ? roundup(input_size_dpu, 8) : input_size_dpu; // Input size per DPU (max.), 8-byte aligned
+    const unsigned int nr_keys = p.keys;
+
+    // MRAM layout: keys, values, table, compacted table
+    const uint32_t table_offset = input_size_dpu_8bytes * (sizeof(KEY) + sizeof(T));
+    assert((uint64_t) table_offset + (uint64_t) nr_keys * (sizeof(T) + sizeof(entry_t)) <= MRAM_CAPACITY && "Input and table do not fit in MRAM!");
+
+    // Direct-mapped tables in WRAM if they fit, otherwise hash tables spilled to MRAM
+    unsigned int kernel = p.mode == MODE_HASH ? kernel2 : kernel1;
+    if (p.mode == MODE_AUTO && nr_keys * sizeof(T) * NR_TASKLETS > WRAM_TABLE)
+        kernel = kernel2;
+    assert((kernel == kernel2 || nr_keys * sizeof(T) * NR_TASKLETS <= WRAM_TABLE) && "Direct-mapped tables do not fit in WRAM!");
+
+    // Input/output allocation
+    A_keys = calloc((uint64_t) input_size_dpu_8bytes * nr_of_dpus, sizeof(KEY));
+    A_values = calloc((uint64_t) input_size_dpu_8bytes * nr_of_dpus, sizeof(T));
+    table_host = malloc(nr_keys * sizeof(T));
+    uint64_t staging_bytes = 0;
+    staging = NULL;
+    uint32_t groups[nr_of_dpus];
+    table = malloc(nr_keys * sizeof(T));
+
+    // Create an input file with arbitrary data
+    read_input(A_keys, A_values, input_size, nr_keys);
+
+    // Host threads
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+
+    // Timer declaration
+    Timer timer;
+    uint64_t spills = 0;
+    uint64_t total_groups = 0;
+    bool compacted = false;
+
+    printf("NR_TASKLETS\t%d\tBL\t%d\tkernel\t%s\n", NR_TASKLETS, BL, kernel == kernel1 ? "direct" : "hash");
+
+    // Loop over main kernel
+    for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
+
+        // Compute output on CPU (performance comparison and verification purposes)
+        if(rep >= p.n_warmup)
+            start(&timer, 0, rep - p.n_warmup);
+        group_by_host(table_host, A_keys, A_values, input_size, nr_keys);
+        if(rep >= p.n_warmup)
+            stop(&timer, 0);
+
+        printf("Load input data\n");
+        if(rep >= p.n_warmup)
+            start(&timer, 1, rep - p.n_warmup);
+        // Input arguments
+        dpu_arguments_t input_arguments[NR_DPUS];
+        for(i=0; i<nr_of_dpus; i++) {
+            unsigned int first = input_size_dpu_8bytes * i;
+            unsigned int rows = first >= input_size ? 0 : (input_size - first < input_size_dpu_8bytes ? input_size - first : input_size_dpu_8bytes);
+            input_arguments[i].size=rows * sizeof(KEY);
+            input_arguments[i].transfer_size=input_size_dpu_8bytes * sizeof(KEY);
+            input_arguments[i].keys=nr_keys;
+            input_arguments[i].kernel=kernel;
+        }
+        // Copy input arrays
+        i = 0;
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, A_keys + input_size_dpu_8bytes * i));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, input_size_dpu_8bytes * sizeof(KEY), DPU_XFER_DEFAULT));
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, A_values + input_size_dpu_8bytes * i));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu_8bytes * sizeof(KEY), input_size_dpu_8bytes * sizeof(T), DPU_XFER_DEFAULT));
+        if(rep >= p.n_warmup)
+            stop(&timer, 1);
+
+        printf("Run program on DPU(s) \n");
+        // Run DPU kernel
+        if(rep >= p.n_warmup) {
+            start(&timer, 2, rep - p.n_warmup);
+            #if ENERGY
+            DPU_ASSERT(dpu_probe_start(&probe));
+            #endif
+        }
+
+        DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
+        if(rep >= p.n_warmup) {
+            stop(&timer, 2);
+            #if ENERGY
+            DPU_ASSERT(dpu_probe_stop(&probe));
+            #endif
+        }
+
+#if PRINT
+        {
+            unsigned int each_dpu = 0;
+            printf("Display DPU Logs\n");
+            DPU_FOREACH (dpu_set, dpu) {
+                printf("DPU#%d:\n", each_dpu);
+                DPU_ASSERT(dpulog_read_for_dpu(dpu.dpu, stdout));
+                each_dpu++;
+            }
+        }
+#endif
+
+        printf("Retrieve results\n");
+        if(rep >= p.n_warmup)
+            start(&timer, 3, rep - p.n_warmup);
+        // Occupied entries of the DPU tables and MRAM spills
+        dpu_results_t results[nr_of_dpus][NR_TASKLETS];
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, results[i]));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, "DPU_RESULTS", 0, NR_TASKLETS * sizeof(dpu_results_t), DPU_XFER_DEFAULT));
+        uint32_t max_groups = 0;
+        spills = 0;
+        total_groups = 0;
+        for(i = 0; i < nr_of_dpus; i++) {
+            groups[i] = 0;
+            for(unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
+                groups[i] += results[i][each_tasklet].groups;
+                spills += results[i][each_tasklet].spills;
+            }
+            if(groups[i] > max_groups)
+                max_groups = groups[i];
+            total_groups += groups[i];
+        }
+        // Compacted tables, padded to the largest one, unless the dense tables are smaller
+        compacted = (uint64_t) max_groups * sizeof(entry_t) < (uint64_t) nr_keys * sizeof(T);
+        uint32_t stride_bytes = compacted ? max_groups * sizeof(entry_t) : nr_keys * sizeof(T);
+        if((uint64_t) stride_bytes * nr_of_dpus > staging_bytes) {
+            free(staging);
+            staging_bytes = (uint64_t) stride_bytes * nr_of_dpus;
+            staging = malloc(staging_bytes);
+        }
+        if(stride_bytes > 0) {
+            // PARALLEL RETRIEVE TRANSFER
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, (uint8_t *) staging + (uint64_t) stride_bytes * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, table_offset + (compacted ? nr_keys * sizeof(T) : 0), stride_bytes, DPU_XFER_DEFAULT));
+        }
+        if(rep >= p.n_warmup)
+            stop(&timer, 3);
+
+        // Final merging of the DPU tables
+        if(rep >= p.n_warmup)
+            start(&timer, 4, rep - p.n_warmup);
+        merge_args_t merge_args = {table, staging, groups, max_groups, nr_keys, nr_of_dpus};
+        pool_run(&pool, compacted ? merge_lists : merge_tables, &merge_args);
+        if(rep >= p.n_warmup)
+            stop(&timer, 4);
+
+    }
+
+    // Print timing results
+    printf("CPU ");
+    print(&timer, 0, p.n_reps);
+    printf("CPU-DPU ");
+    print(&timer, 1, p.n_reps);
+    printf("DPU Kernel ");
+    print(&timer, 2, p.n_reps);
+    printf("DPU-CPU ");
+    print(&timer, 3, p.n_reps);
+    printf("Inter-DPU ");
+    print(&timer, 4, p.n_reps);
+    printf("\nMRAM spills per DPU\t%.1f\n", (double) spills / nr_of_dpus);
+    printf("Occupied entries per DPU\t%.1f\tretrieval\t%s\n", (double) total_groups / nr_of_dpus, compacted ? "compacted" : "dense");
+
+    #if ENERGY
+    double energy;
+    DPU_ASSERT(dpu_probe_get(&probe, DPU_ENERGY, DPU_AVERAGE, &energy));
+    printf("DPU Energy (J): %f\t", energy);
+    #endif
+
+    // Check output
+    bool status = true;
+    for (unsigned int j = 0; j < nr_keys; j++) {
+        if(table_host[j] != table[j]){
+            status = false;
+#if PRINT
+            printf("%u: %ld -- %ld\n", j, table_host[j], table[j]);
+#endif
+        }
+    }
+    if (status) {
+        printf("[" ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "] Outputs are equal\n");
+    } else {
+        printf("[" ANSI_COLOR_RED "ERROR" ANSI_COLOR_RESET "] Outputs differ!\n");
+    }
+
+    // Deallocation
+    pool_free(&pool);
+    free(A_keys);
+    free(A_values);
+    free(table_host);
+    free(staging);
+    free(table);
+    DPU_ASSERT(dpu_free(dpu_set));
+
+    return status ? 0 : -1;
+}
@@ -0,0 +1,21 @@
+#!/bin/bash
+
+# Key cardinality from 16 to 1M: automatic table (direct-mapped in WRAM while it fits) and hash tables with MRAM spill
+for i in 1 
+do
+	for k in 1 2 4 8 16
+	do
+		NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
+		wait
+		for c in 16 64 256 1024 4096 16384 65536 262144 1048576
+		do
+			for m in 0 2
+			do
+				./bin/host_code -w 2 -e 5 -k ${c} -m ${m} > profile/GBY_k${c}_m${m}_tl${k}_dpu${i}.txt
+				wait
+			done
+		done
+		make clean
+		wait
+	done
+done
@@ -0,0 +1,72 @@
+#ifndef _COMMON_H_
+#define _COMMON_H_
+
+// Transfer size between MRAM and WRAM (values; the matching keys take half of it)
+#ifdef BL
+#define BLOCK_SIZE_LOG2 BL
+#define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
+#else
+#define BLOCK_SIZE_LOG2 8
+#define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
+#define BL BLOCK_SIZE_LOG2
+#endif
+
+// Data types: GROUP BY key SUM(value)
+#define KEY uint32_t
+#define T int64_t
+#define DIV 3 // Shift right to divide by sizeof(T)
+#define EMPTY_KEY UINT32_MAX
+
+// WRAM (bytes, all tasklets together) for the aggregation tables.
+// Direct-mapped tables hold keys * sizeof(T) bytes per tasklet; hash tables use the largest power-of-2
+// number of entries that fits
+#define WRAM_TABLE 16384
+// Linear probing distance before a hash entry is spilled to the MRAM table
+#define PROBES 4
+// Mutexes protecting the read-modify-write of the MRAM table
+#define NR_LOCKS 8
+
+// Hash table entry, also the (key, sum) entries of the compacted DPU tables
+typedef struct {
+    KEY key;
+    uint32_t pad;
+    T sum;
+} entry_t;
+
+// Structures used by both the host and the dpu to communicate information 
+typedef struct {
+    uint32_t size;
+    uint32_t transfer_size;
+    uint32_t keys;
+	enum kernels {
+	    kernel1 = 0, // Direct-mapped table per tasklet in WRAM
+	    kernel2 = 1, // Hash table per tasklet in WRAM, spilled to a direct-mapped table in MRAM
+	    nr_kernels = 2,
+	} kernel;
+} dpu_arguments_t;
+
+typedef struct {
+    uint64_t spills;
+    uint32_t groups; // Occupied entries of the DPU table in the key range of the tasklet
+    uint32_t pad;
+} dpu_results_t;
+
+// Kernel selection
+#define MODE_AUTO 0
+#define MODE_DIRECT 1
+#define MODE_HASH 2
+
+#define MRAM_CAPACITY (64 << 20)
+
+#ifndef ENERGY
+#define ENERGY 0
+#endif
+#define PRINT 0 
+
+#define ANSI_COLOR_RED     "\x1b[31m"
+#define ANSI_COLOR_GREEN   "\x1b[32m"
+#define ANSI_COLOR_RESET   "\x1b[0m"
+
+#define divceil(n, m) (((n)-1) / (m) + 1)
+#define roundup(n, m) ((n / m) * m + m)
+#endif
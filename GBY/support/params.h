@@ -0,0 +1,71 @@
+#ifndef _PARAMS_H_
+#define _PARAMS_H_
+
+#include "common.h"
+
+typedef struct Params {
+    unsigned int   input_size;
+    unsigned int   keys;
+    unsigned int   mode;
+    unsigned int   n_threads;
+    int   n_warmup;
+    int   n_reps;
+    int  exp;
+}Params;
+
+static void usage() {
+    fprintf(stderr,
+        "\nUsage:  ./program [options]"
+        "\n"
+        "\nGeneral options:"
+        "\n    -h        help"
+        "\n    -w <W>    # of untimed warmup iterations (default=1)"
+        "\n    -e <E>    # of timed repetition iterations (default=3)"
+        "\n    -x <X>    Weak (0) or strong (1) scaling (default=0)"
+        "\n    -t <T>    # of host threads for the merge of the DPU tables (default=4)"
+        "\n"
+        "\nBenchmark-specific options:"
+        "\n    -i <I>    input size (default=1M rows per DPU)"
+        "\n    -k <K>    key cardinality, 16 to 1M (default=1024)"
+        "\n    -m <M>    aggregation table: 0 automatic, 1 direct-mapped (WRAM), 2 hash (WRAM) with MRAM spill (default=0)"
+        "\n");
+}
+
+struct Params input_params(int argc, char **argv) {
+    struct Params p;
+    p.input_size    = 1 << 20;
+    p.keys          = 1024;
+    p.mode          = MODE_AUTO;
+    p.n_threads     = 4;
+    p.n_warmup      = 1;
+    p.n_reps        = 3;
+    p.exp           = 0;
+
+    int opt;
+    while((opt = getopt(argc, argv, "hi:k:m:t:w:e:x:")) >= 0) {
+        switch(opt) {
+        case 'h':
+        usage();
+        exit(0);
+        break;
+        case 'i': p.input_size    = atoi(optarg); break;
+        case 'k': p.keys          = atoi(optarg); break;
+        case 'm': p.mode          = atoi(optarg); break;
+        case 't': p.n_threads     = atoi(optarg); break;
+        case 'w': p.n_warmup      = atoi(optarg); break;
+        case 'e': p.n_reps        = atoi(optarg); break;
+        case 'x': p.exp           = atoi(optarg); break;
+        default:
+            fprintf(stderr, "\nUnrecognized option!\n");
+            usage();
+            exit(0);
+        }
+    }
+    assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    assert(p.keys > 0 && p.keys < EMPTY_KEY && "Invalid key cardinality!");
+    assert(p.mode <= MODE_HASH && "Invalid aggregation table!");
+    assert(p.n_threads > 0 && "Invalid # of host threads!");
+
+    return p;
+}
+#endif
@@ -15,6 +15,9 @@
 #include "../support/common.h"
 
 __host dpu_arguments_t DPU_INPUT_ARGUMENTS;
+__host dpu_results_t DPU_RESULTS[NR_TASKLETS];
+// Lower edges of the non-uniform bins of each column
+__host T DPU_EDGES[2 * MAX_EDGES];
 
 // Array for communication between adjacent tasklets
 uint32_t* message[NR_TASKLETS];
@@ -27,21 +30,104 @@ ATOMIC_BIT_INIT(barriers_mutexes)[NR_HISTO];
 barrier_t barriers[NR_HISTO];
 
 // Mutex
+ATOMIC_BIT_INIT(histo_mutexes)[NR_HISTO];
 mutex_id_t my_mutex[NR_HISTO];
 
+// Bins of a column
+typedef struct {
+    uint32_t bins;
+    uint32_t span; // Edges searched (power of two)
+    T *edges; // NULL if uniform
+} column_t;
+
+// Columns of the input: x, and y for joint histograms (y.bins == 0 otherwise)
+static void columns(column_t *x, column_t *y){
+    uint32_t bins_y = DPU_INPUT_ARGUMENTS.bins_y;
+    x->bins = bins_y ? DPU_INPUT_ARGUMENTS.bins / bins_y : DPU_INPUT_ARGUMENTS.bins;
+    y->bins = bins_y;
+    x->edges = DPU_INPUT_ARGUMENTS.edges ? DPU_EDGES : NULL;
+    y->edges = DPU_INPUT_ARGUMENTS.edges ? DPU_EDGES + MAX_EDGES : NULL;
+    for(x->span = 1; x->span < x->bins; x->span <<= 1);
+    for(y->span = 1; y->span < y->bins; y->span <<= 1);
+}
+
+// Bin of value d in a column: uniform, or the last lower edge not above d (branchless binary search)
+static inline uint32_t column_bin(const column_t *c, T d){
+    if(c->edges == NULL)
+        return (d * c->bins) >> DEPTH;
+    uint32_t k = 0;
+    for(uint32_t step = c->span >> 1; step > 0; step >>= 1)
+        k += (c->edges[k + step] <= d) ? step : 0;
+    return k < c->bins ? k : c->bins - 1;
+}
+
+// Bin of the element (or pair of elements, joint histogram) at input[j]
+static inline uint32_t element_bin(const column_t *x, const column_t *y, T *input, unsigned int j){
+    uint32_t b = column_bin(x, input[j]);
+    if(y->bins)
+        b = b * y->bins + column_bin(y, input[j + 1]);
+    return b;
+}
+
 // Histogram in each tasklet
-static void histogram(uint32_t* histo, uint32_t bins, T *input, uint32_t histo_id, unsigned int l_size){
-    for(unsigned int j = 0; j < l_size; j++) {
-        T d = (input[j] * bins) >> DEPTH;
+static uint32_t histogram(uint32_t* histo, const column_t *x, const column_t *y, T *input, uint32_t histo_id, unsigned int l_size){
+    unsigned int step = y->bins ? 2 : 1;
+    for(unsigned int j = 0; j < l_size; j += step) {
+        T d = element_bin(x, y, input, j);
         mutex_lock(my_mutex[histo_id]);
         histo[d] += 1;
         mutex_unlock(my_mutex[histo_id]);
     }
+    return l_size / step;
+}
+
+// Hot-bin cache entry
+typedef struct {
+    uint32_t bin;
+    uint32_t count;
+} hot_t;
+
+// Add a batch of victims to the shared histogram
+static void flush(uint32_t* histo, hot_t *victims, unsigned int nr_victims, uint32_t histo_id){
+    mutex_lock(my_mutex[histo_id]);
+    for(unsigned int j = 0; j < nr_victims; j++) {
+        histo[victims[j].bin] += victims[j].count;
+    }
+    mutex_unlock(my_mutex[histo_id]);
+}
+
+// Histogram in each tasklet through its hot-bin cache. A bin that misses evicts the entry of its slot
+// to the victims, which are flushed once FLUSH_BATCH of them are pending. Returns the number of flushes
+static uint32_t histogram_hot(uint32_t* histo, const column_t *x, const column_t *y, T *input, hot_t *hot, hot_t *victims, unsigned int *nr_victims, uint32_t histo_id, unsigned int l_size){
+    uint32_t flushes = 0;
+    unsigned int v = *nr_victims;
+    unsigned int step = y->bins ? 2 : 1;
+    for(unsigned int j = 0; j < l_size; j += step) {
+        uint32_t d = element_bin(x, y, input, j);
+        hot_t *e = &hot[d & (HOT_BINS - 1)];
+        if(e->bin == d) {
+            e->count++;
+            continue;
+        }
+        if(e->count != 0) {
+            victims[v++] = *e;
+            if(v == FLUSH_BATCH) {
+                flush(histo, victims, v, histo_id);
+                flushes++;
+                v = 0;
+            }
+        }
+        e->bin = d;
+        e->count = 1;
+    }
+    *nr_victims = v;
+    return flushes;
 }
 
 extern int main_kernel1(void);
 
-int (*kernels[nr_kernels])(void) = {main_kernel1};
+// Both update schemes share the kernel, which selects the per-block update from DPU_INPUT_ARGUMENTS
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel1};
 
 int main(void) { 
     // Kernel
@@ -60,6 +146,8 @@ int main_kernel1() {
 
     if (tasklet_id == 0){ // Initialize once the cycle counter
         mem_reset(); // Reset the heap
+        for (unsigned int each_histo = 0; each_histo < NR_HISTO; each_histo++)
+            my_mutex[each_histo] = &ATOMIC_BIT_GET(histo_mutexes)[each_histo];
         // Initialize barriers
         for (unsigned int each_barrier = 0; each_barrier < NR_HISTO; each_barrier++) {
             barriers[each_barrier].wait_queue = 0xff;
@@ -74,6 +162,8 @@ int main_kernel1() {
     uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size;
     uint32_t input_size_dpu_bytes_transfer = DPU_INPUT_ARGUMENTS.transfer_size; // Transfer input size per DPU in bytes
     uint32_t bins = DPU_INPUT_ARGUMENTS.bins;
+    column_t x, y;
+    columns(&x, &y);
 
     // Address of the current processing block in MRAM
     uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
@@ -82,6 +172,20 @@ int main_kernel1() {
 
     // Initialize a local cache to store the MRAM block
     T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
+
+    // Hot-bin cache and pending victims
+    hot_t *hot = NULL;
+    hot_t *victims = NULL;
+    unsigned int nr_victims = 0;
+    uint32_t flushes = 0;
+    if(DPU_INPUT_ARGUMENTS.kernel == kernel2) {
+        hot = (hot_t *) mem_alloc(HOT_BINS * sizeof(hot_t));
+        victims = (hot_t *) mem_alloc(FLUSH_BATCH * sizeof(hot_t));
+        for(unsigned int i = 0; i < HOT_BINS; i++){
+            hot[i].bin = UINT32_MAX;
+            hot[i].count = 0;
+        }
+    }
 	
     // Local histogram
     if (tasklet_id < NR_HISTO){ // Allocate DPU histogram
@@ -110,8 +214,30 @@ int main_kernel1() {
         mram_read((const __mram_ptr void*)(mram_base_addr_A + byte_index), cache_A, l_size_bytes);
 
         // Histogram in each tasklet
-        histogram(my_histo, bins, cache_A, my_histo_id, l_size_bytes >> DIV);
+        if(DPU_INPUT_ARGUMENTS.kernel == kernel2)
+            flushes += histogram_hot(my_histo, &x, &y, cache_A, hot, victims, &nr_victims, my_histo_id, l_size_bytes >> DIV);
+        else
+            flushes += histogram(my_histo, &x, &y, cache_A, my_histo_id, l_size_bytes >> DIV);
+    }
+
+    // Flush the hot-bin cache
+    if(DPU_INPUT_ARGUMENTS.kernel == kernel2) {
+        for(unsigned int i = 0; i < HOT_BINS; i++){
+            if(hot[i].count == 0)
+                continue;
+            victims[nr_victims++] = hot[i];
+            if(nr_victims == FLUSH_BATCH) {
+                flush(my_histo, victims, nr_victims, my_histo_id);
+                flushes++;
+                nr_victims = 0;
+            }
+        }
+        if(nr_victims > 0) {
+            flush(my_histo, victims, nr_victims, my_histo_id);
+            flushes++;
+        }
     }
+    DPU_RESULTS[tasklet_id].flushes = flushes;
 
     // Barrier
     barrier_wait(&my_barrier);
@@ -17,6 +17,7 @@
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 // Define the DPU Binary path as DPU_BINARY here
 #ifndef DPU_BINARY
@@ -31,6 +32,7 @@
 static T* A;
 static unsigned int* histo_host;
 static unsigned int* histo;
+static T* edges;
 
 // Create input arrays
 static void read_input(T* A, const Params p) {
@@ -55,20 +57,78 @@ static void read_input(T* A, const Params p) {
     }
 }
 
-// Compute output in the host
-static void histogram_host(unsigned int* histo, T* A, unsigned int bins, unsigned int nr_elements, int exp, unsigned int nr_of_dpus) {
-    if(!exp){
-        for (unsigned int i = 0; i < nr_of_dpus; i++) {
-            for (unsigned int j = 0; j < nr_elements; j++) {
-                T d = A[j];
-                histo[i * bins + ((d * bins) >> DEPTH)] += 1;
-            }
+// Lower edges of non-uniform bins over [0, 2^DEPTH), padded with UINT32_MAX
+static void create_edges(T* edges, unsigned int bins, unsigned int mode) {
+    const unsigned int range = 1 << DEPTH;
+    unsigned int e = 0;
+    for(unsigned int k = 0; k < MAX_EDGES; k++)
+        edges[k] = UINT32_MAX;
+    for(unsigned int k = 1; k < bins; k++) {
+        if(mode == EDGES_LOG) {
+            unsigned int l = (unsigned int) pow((double) range, (double) k / bins);
+            e = l > e ? l : e + 1;
+            if(e > range - (bins - k))
+                e = range - (bins - k);
+        } else {
+            unsigned int first = range * k / bins, last = range * (k + 1) / bins;
+            e = first + rand() % (last - first);
         }
+        edges[k] = e;
+    }
+    if(bins > 0)
+        edges[0] = 0;
+}
+
+// Bin of value d in a column (edges: lower edges of non-uniform bins, or NULL)
+static unsigned int column_bin_host(T d, unsigned int bins, const T* edges) {
+    if(edges == NULL)
+        return (d * bins) >> DEPTH;
+    unsigned int lo = 1, hi = bins; // First edge above d
+    while(lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        if(edges[mid] <= d)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    else{
+    return lo - 1;
+}
+
+// Compute output in the host. Joint histograms count pairs of consecutive pixels
+static void histogram_host(unsigned int* histo, T* A, const Params p, const T* edges, unsigned int nr_elements) {
+    const T* edges_y = edges == NULL ? NULL : edges + MAX_EDGES;
+    if(p.bins_y == 0) {
         for (unsigned int j = 0; j < nr_elements; j++) {
-            T d = A[j];
-            histo[(d * bins) >> DEPTH] += 1;
+            histo[column_bin_host(A[j], p.bins, edges)] += 1;
+        }
+    }
+    else {
+        for (unsigned int j = 0; j + 1 < nr_elements; j += 2) {
+            histo[column_bin_host(A[j], p.bins, edges) * p.bins_y + column_bin_host(A[j + 1], p.bins_y, edges_y)] += 1;
+        }
+    }
+}
+
+// Merge of the DPU histograms: each host thread sums a range of bins over all DPUs, in chunks
+// that stay in cache. The merged histogram replaces the one of the first DPU
+#define MERGE_CHUNK 4096
+typedef struct {
+    unsigned int *histo;
+    unsigned int bins;
+    unsigned int nr_dpus;
+} merge_args_t;
+
+static void merge_histograms(void *arg, unsigned int thread, unsigned int nr_threads) {
+    merge_args_t *m = (merge_args_t *) arg;
+    uint64_t first, last;
+    pool_range(m->bins, thread, nr_threads, &first, &last);
+    unsigned int *restrict dst = m->histo;
+    for (uint64_t c = first; c < last; c += MERGE_CHUNK) {
+        uint64_t c_last = c + MERGE_CHUNK < last ? c + MERGE_CHUNK : last;
+        for (unsigned int i = 1; i < m->nr_dpus; i++) {
+            const unsigned int *restrict src = m->histo + (uint64_t) i * m->bins;
+            for (uint64_t j = c; j < c_last; j++)
+                dst[j] += src[j];
         }
     }
 }
@@ -108,11 +168,15 @@ int main(int argc, char **argv) {
     const unsigned int input_size_dpu_8bytes = 
         ((input_size_dpu * sizeof(T)) % 8) != 0 ? roundup(input_size_dpu, 8) : input_size_dpu; // Input size per DPU (max.), 8-byte aligned
 
+    const unsigned int bins = p.bins_y ? p.bins * p.bins_y : p.bins; // Bins of the (joint) histogram
+    assert(bins % 2 == 0 && (bins <= 512 || bins % 512 == 0) && "Histogram written to MRAM in 2048-byte chunks!");
+    assert((uint64_t) bins * sizeof(uint32_t) * NR_HISTO <= WRAM_HISTO && "WRAM histograms do not fit in WRAM!");
+
     // Input/output allocation
     A = malloc(input_size_dpu_8bytes * nr_of_dpus * sizeof(T));
     T *bufferA = A;
-    histo_host = malloc(p.bins * sizeof(unsigned int));
-    histo = malloc(nr_of_dpus * p.bins * sizeof(unsigned int));
+    histo_host = malloc(bins * sizeof(unsigned int));
+    histo = malloc(nr_of_dpus * bins * sizeof(unsigned int));
 
     // Create an input file with arbitrary data
     read_input(A, p);
@@ -126,20 +190,35 @@ int main(int argc, char **argv) {
             memcpy(&A[j * p.input_size], &A[0], p.input_size * sizeof(T));
     }
 
+    // Non-uniform bins, in WRAM of every DPU
+    if(p.edges != EDGES_UNIFORM) {
+        edges = malloc(2 * MAX_EDGES * sizeof(T));
+        create_edges(edges, p.bins, p.edges);
+        create_edges(edges + MAX_EDGES, p.bins_y, p.edges);
+        DPU_ASSERT(dpu_broadcast_to(dpu_set, "DPU_EDGES", 0, edges, 2 * MAX_EDGES * sizeof(T), DPU_XFER_DEFAULT));
+    }
+
+    // Host threads
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+    merge_args_t merge_args = {histo, bins, nr_of_dpus};
+
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\tinput_size\t%u\n", NR_TASKLETS, BL, input_size);
+    uint64_t flushes = 0;
+
+    printf("NR_TASKLETS\t%d\tBL\t%d\tinput_size\t%u\tupdate\t%s\tbins\t%u\tedges\t%u\n", NR_TASKLETS, BL, input_size, p.kernel == kernel1 ? "mutex" : "hot-bin", bins, p.edges);
 
     // Loop over main kernel
     for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
-        memset(histo_host, 0, p.bins * sizeof(unsigned int));
-        memset(histo, 0, nr_of_dpus * p.bins * sizeof(unsigned int));
+        memset(histo_host, 0, bins * sizeof(unsigned int));
+        memset(histo, 0, nr_of_dpus * bins * sizeof(unsigned int));
 
         // Compute output on CPU (performance comparison and verification purposes)
         if(rep >= p.n_warmup)
             start(&timer, 0, rep - p.n_warmup);
-        histogram_host(histo_host, A, p.bins, p.input_size, 1, nr_of_dpus);
+        histogram_host(histo_host, A, p, edges, p.input_size);
         if(rep >= p.n_warmup)
             stop(&timer, 0);
 
@@ -147,19 +226,23 @@ int main(int argc, char **argv) {
         if(rep >= p.n_warmup)
             start(&timer, 1, rep - p.n_warmup);
         // Input arguments
-        unsigned int kernel = 0;
+        unsigned int kernel = p.kernel;
         i = 0;
 	    dpu_arguments_t input_arguments[NR_DPUS];
 	    for(i=0; i<nr_of_dpus-1; i++) {
 	        input_arguments[i].size=input_size_dpu_8bytes * sizeof(T); 
 	        input_arguments[i].transfer_size=input_size_dpu_8bytes * sizeof(T); 
-	        input_arguments[i].bins=p.bins;
+	        input_arguments[i].bins=bins;
 	        input_arguments[i].kernel=kernel;
+	        input_arguments[i].bins_y=p.bins_y;
+	        input_arguments[i].edges=edges != NULL;
 	    }
 	    input_arguments[nr_of_dpus-1].size=(input_size_8bytes - input_size_dpu_8bytes * (NR_DPUS-1)) * sizeof(T); 
 	    input_arguments[nr_of_dpus-1].transfer_size=input_size_dpu_8bytes * sizeof(T); 
-	    input_arguments[nr_of_dpus-1].bins=p.bins;
+	    input_arguments[nr_of_dpus-1].bins=bins;
 	    input_arguments[nr_of_dpus-1].kernel=kernel;
+	    input_arguments[nr_of_dpus-1].bins_y=p.bins_y;
+	    input_arguments[nr_of_dpus-1].edges=edges != NULL;
 
         // Copy input arrays
         i = 0;
@@ -208,19 +291,30 @@ int main(int argc, char **argv) {
             start(&timer, 3, rep - p.n_warmup);
         // PARALLEL RETRIEVE TRANSFER
         DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, histo + p.bins * i));
+            DPU_ASSERT(dpu_prepare_xfer(dpu, histo + bins * i));
         }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu_8bytes * sizeof(T), p.bins * sizeof(unsigned int), DPU_XFER_DEFAULT));
-		
-        // Final histogram merging
-        for(i = 1; i < nr_of_dpus; i++){
-            for(unsigned int j = 0; j < p.bins; j++){
-                histo[j] += histo[j + i * p.bins];
-            }			
-        }		
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu_8bytes * sizeof(T), bins * sizeof(unsigned int), DPU_XFER_DEFAULT));
         if(rep >= p.n_warmup)
             stop(&timer, 3);
 
+        // Final histogram merging
+        if(rep >= p.n_warmup)
+            start(&timer, 4, rep - p.n_warmup);
+        pool_run(&pool, merge_histograms, &merge_args);
+        if(rep >= p.n_warmup)
+            stop(&timer, 4);
+
+        // Lock acquisitions (not timed)
+        dpu_results_t results[nr_of_dpus][NR_TASKLETS];
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, results[i]));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, "DPU_RESULTS", 0, NR_TASKLETS * sizeof(dpu_results_t), DPU_XFER_DEFAULT));
+        flushes = 0;
+        for(i = 0; i < nr_of_dpus; i++)
+            for(unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++)
+                flushes += results[i][each_tasklet].flushes;
+
     }
 
     // Print timing results
@@ -232,6 +326,9 @@ int main(int argc, char **argv) {
     print(&timer, 2, p.n_reps);
     printf("DPU-CPU ");
     print(&timer, 3, p.n_reps);
+    printf("Inter-DPU ");
+    print(&timer, 4, p.n_reps);
+    printf("\nLock acquisitions per DPU\t%.1f\n", (double) flushes / nr_of_dpus);
 
     #if ENERGY
     double energy;
@@ -243,7 +340,7 @@ int main(int argc, char **argv) {
     // Check output
     bool status = true;
     if(p.exp == 1) 
-        for (unsigned int j = 0; j < p.bins; j++) {
+        for (unsigned int j = 0; j < bins; j++) {
             if(histo_host[j] != histo[j]){ 
                 status = false;
 #if PRINT
@@ -252,7 +349,7 @@ int main(int argc, char **argv) {
             }
         }
     else if(p.exp == 2) 
-        for (unsigned int j = 0; j < p.bins; j++) {
+        for (unsigned int j = 0; j < bins; j++) {
             if(dpu_s * histo_host[j] != histo[j]){ 
                 status = false;
 #if PRINT
@@ -261,7 +358,7 @@ int main(int argc, char **argv) {
             }
         }
     else
-        for (unsigned int j = 0; j < p.bins; j++) {
+        for (unsigned int j = 0; j < bins; j++) {
             if(nr_of_dpus * histo_host[j] != histo[j]){ 
                 status = false;
 #if PRINT
@@ -279,6 +376,8 @@ int main(int argc, char **argv) {
     free(A);
     free(histo_host);
     free(histo);
+    free(edges);
+    pool_free(&pool);
     DPU_ASSERT(dpu_free(dpu_set));
 	
     return status ? 0 : -1;
@@ -1,17 +1,46 @@
 #!/bin/bash
 
+# Update of the shared histograms (-k): mutex per element (0) or hot-bin cache with batched flushes (1),
+# against the replication of the histogram (NR_HISTO)
 for i in 1 
 do
 	for b in 64 128 256 512 1024 2048 4096
 	do
     	for k in 1 2 4 8 16
 	    do
-	        NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
-		    wait
-            ./bin/host_code -w 2 -e 5 -b ${b} > profile/HSTL_${b}_tl${k}_dpu${i}.txt
-		    wait
-		    make clean
-		    wait
+	        for h in 1 2 4 8
+	        do
+	            if [ $h -gt $k ]; then continue; fi
+	            if [ $((b * 4 * h)) -gt 16384 ]; then continue; fi # WRAM_HISTO
+	            NR_DPUS=$i NR_TASKLETS=$k BL=10 NR_HISTO=$h make all
+		        wait
+	            for m in 0 1
+	            do
+                    ./bin/host_code -w 2 -e 5 -b ${b} -k ${m} > profile/HSTL_${b}_tl${k}_dpu${i}_histo${h}_k${m}.txt
+		            wait
+	            done
+		        make clean
+		        wait
+	        done
 		done
 	done
 done
+
+# Non-uniform bins (logarithmic and random edges) and joint histograms of pixel pairs
+for i in 1 
+do
+    for k in 1 2 4 8 16
+    do
+        NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
+        wait
+        for g in 0 1 2
+        do
+            ./bin/host_code -w 2 -e 5 -b 256 -g ${g} > profile/HSTL_EDGES_${g}_tl${k}_dpu${i}.txt
+            wait
+            ./bin/host_code -w 2 -e 5 -b 16 -y 16 -g ${g} > profile/HSTL_JOINT_16x16_${g}_tl${k}_dpu${i}.txt
+            wait
+        done
+        make clean
+        wait
+    done
+done
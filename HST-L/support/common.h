@@ -20,17 +20,39 @@
 #define DEPTH 12
 #define ByteSwap16(n) (((((unsigned int)n) << 8) & 0xFF00) | ((((unsigned int)n) >> 8) & 0x00FF))
 
+// Hot-bin cache of each tasklet (direct-mapped entries) and victims flushed to the shared
+// histogram under a single lock acquisition
+#define HOT_BINS 64
+#define FLUSH_BATCH 16
+
+// WRAM (bytes, all NR_HISTO replicas together) for the shared histograms
+#define WRAM_HISTO 16384
+
+// Non-uniform bins: lower edges of the bins of each column (second column at MAX_EDGES), padded with
+// UINT32_MAX up to the next power of two
+#define MAX_EDGES 256
+#define EDGES_UNIFORM 0
+#define EDGES_LOG 1
+#define EDGES_RANDOM 2
+
 // Structures used by both the host and the dpu to communicate information 
 typedef struct {
     uint32_t size;
     uint32_t transfer_size;
     uint32_t bins;
+    uint32_t bins_y; // Bins of the second column of a joint histogram of column pairs (0: single column). bins is the product
+    uint32_t edges; // Non-uniform bins, given by their lower edges in DPU_EDGES
 	enum kernels {
-	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel1 = 0, // Mutex per element
+	    kernel2 = 1, // Hot-bin cache per tasklet, batched flushes
+	    nr_kernels = 2,
 	} kernel;
 } dpu_arguments_t;
 
+typedef struct {
+    uint32_t flushes; // Lock acquisitions of the tasklet
+} dpu_results_t;
+
 #ifndef ENERGY
 #define ENERGY 0
 #endif
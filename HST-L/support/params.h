@@ -11,6 +11,10 @@ typedef struct Params {
     const char *file_name;
     int  exp;
     int  dpu_s;
+    unsigned int   kernel;
+    unsigned int   n_threads;
+    unsigned int   edges;
+    unsigned int   bins_y;
 }Params;
 
 static void usage() {
@@ -22,11 +26,15 @@ static void usage() {
         "\n    -w <W>    # of untimed warmup iterations (default=1)"
         "\n    -e <E>    # of timed repetition iterations (default=3)"
         "\n    -x <X>    Weak (0) or strong (1, 2) scaling (default=0)"
+        "\n    -t <T>    # of host threads for the merge of the DPU histograms (default=4)"
         "\n"
         "\nBenchmark-specific options:"
         "\n    -i <I>    input size (default=1536*1024 elements)"
         "\n    -b <B>    histogram size (default=256 bins)"
         "\n    -f <F>    input image file (default=../input/image_VanHateren.iml)"
+        "\n    -k <K>    update of the shared histograms: 0 mutex per element, 1 hot-bin cache per tasklet with batched flushes (default=1)"
+        "\n    -g <G>    bins: 0 uniform, 1 logarithmic edges, 2 random edges (default=0)"
+        "\n    -y <Y>    joint histogram of pixel pairs, with Y bins for the second pixel (default=0, single pixels)"
         "\n");
 }
 
@@ -39,9 +47,13 @@ struct Params input_params(int argc, char **argv) {
     p.exp           = 0;
     p.file_name     = "./input/image_VanHateren.iml";
     p.dpu_s         = 64;
+    p.kernel        = kernel2;
+    p.n_threads     = 4;
+    p.edges         = EDGES_UNIFORM;
+    p.bins_y        = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hi:b:w:e:f:x:z:")) >= 0) {
+    while((opt = getopt(argc, argv, "hi:b:w:e:f:x:z:k:t:g:y:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
@@ -54,6 +66,10 @@ struct Params input_params(int argc, char **argv) {
         case 'f': p.file_name     = optarg; break;
         case 'x': p.exp           = atoi(optarg); break;
         case 'z': p.dpu_s         = atoi(optarg); break;
+        case 'k': p.kernel        = atoi(optarg); break;
+        case 't': p.n_threads     = atoi(optarg); break;
+        case 'g': p.edges         = atoi(optarg); break;
+        case 'y': p.bins_y        = atoi(optarg); break;
         default:
             fprintf(stderr, "\nUnrecognized option!\n");
             usage();
@@ -61,6 +77,12 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    assert(p.kernel < nr_kernels && "Invalid kernel!");
+    assert(p.n_threads > 0 && "Invalid # of host threads!");
+    assert(p.edges <= EDGES_RANDOM && "Invalid bin edges!");
+    assert((p.edges == EDGES_UNIFORM || (p.bins <= MAX_EDGES && p.bins_y <= MAX_EDGES)) && "Too many non-uniform bins!");
+    assert((p.edges == EDGES_UNIFORM || (p.bins <= (1 << DEPTH) && p.bins_y <= (1 << DEPTH))) && "More non-uniform bins than values!");
+    assert((p.bins_y == 0 || p.input_size % 2 == 0) && "Joint histograms need pixel pairs!");
 
     return p;
 }
@@ -13,26 +13,117 @@
 #include "../support/common.h"
 
 __host dpu_arguments_t DPU_INPUT_ARGUMENTS;
+__host dpu_results_t DPU_RESULTS;
+// Lower edges of the non-uniform bins of each column
+__host T DPU_EDGES[2 * MAX_EDGES];
 
 // Array for communication between adjacent tasklets
 uint32_t* message[NR_TASKLETS];
+// Bins of the block of each tasklet, bucketed by owner: message_offsets[t][o] is the first of owner o
+uint16_t message_offsets[NR_TASKLETS][NR_TASKLETS + 1];
+// Non-empty bins of each tasklet (pre-merge)
+uint32_t message_nonzero[NR_TASKLETS];
 // DPU histogram
 uint32_t* histo_dpu;
 
 // Barrier
 BARRIER_INIT(my_barrier, NR_TASKLETS);
 
+// Bins of a column
+typedef struct {
+    uint32_t bins;
+    uint32_t depth;
+    uint32_t span; // Edges searched (power of two)
+    T *edges; // NULL if uniform
+} column_t;
+
+// Columns of the input: x, and y for joint histograms (y.bins == 0 otherwise)
+static void columns(column_t *x, column_t *y){
+    uint32_t bins_y = DPU_INPUT_ARGUMENTS.bins_y;
+    x->bins = bins_y ? DPU_INPUT_ARGUMENTS.bins / bins_y : DPU_INPUT_ARGUMENTS.bins;
+    y->bins = bins_y;
+    x->depth = y->depth = DPU_INPUT_ARGUMENTS.depth;
+    x->edges = DPU_INPUT_ARGUMENTS.edges ? DPU_EDGES : NULL;
+    y->edges = DPU_INPUT_ARGUMENTS.edges ? DPU_EDGES + MAX_EDGES : NULL;
+    for(x->span = 1; x->span < x->bins; x->span <<= 1);
+    for(y->span = 1; y->span < y->bins; y->span <<= 1);
+}
+
+// Bin of value d in a column: uniform, or the last lower edge not above d (branchless binary search)
+static inline uint32_t column_bin(const column_t *c, T d){
+    if(c->edges == NULL)
+        return BIN(d, c->bins, c->depth);
+    uint32_t k = 0;
+    for(uint32_t step = c->span >> 1; step > 0; step >>= 1)
+        k += (c->edges[k + step] <= d) ? step : 0;
+    return k < c->bins ? k : c->bins - 1;
+}
+
+// Bin of the element (or pair of elements, joint histogram) at input[j]
+static inline uint32_t element_bin(const column_t *x, const column_t *y, T *input, unsigned int j){
+    uint32_t b = column_bin(x, input[j]);
+    if(y->bins)
+        b = b * y->bins + column_bin(y, input[j + 1]);
+    return b;
+}
+
 // Histogram in each tasklet
-static void histogram(uint32_t* histo, uint32_t bins, T *input, unsigned int l_size){
+static void histogram(uint32_t* histo, const column_t *x, const column_t *y, T *input, unsigned int l_size){
+    if(y->bins == 0 && x->edges == NULL){
+        uint32_t bins = x->bins, depth = x->depth;
+        for(unsigned int j = 0; j < l_size; j++) {
+            T d = input[j];
+            histo[(d * bins) >> depth] += 1;
+        }
+        return;
+    }
+    unsigned int step = y->bins ? 2 : 1;
+    for(unsigned int j = 0; j < l_size; j += step) {
+        histo[element_bin(x, y, input, j)] += 1;
+    }
+}
+
+// Bucket the bins of a block by owner tasklet (counting sort)
+static void bucket(uint32_t *sorted, uint16_t *offsets, T *input, const column_t *x, const column_t *y, uint32_t range_log2, unsigned int l_size){
+    uint16_t next[NR_TASKLETS];
+    for(unsigned int o = 0; o <= NR_TASKLETS; o++) {
+        offsets[o] = 0;
+    }
+    // Bins replace the elements (pairs) of the block at the front
+    unsigned int step = y->bins ? 2 : 1;
+    l_size /= step;
     for(unsigned int j = 0; j < l_size; j++) {
-        T d = input[j];
-        histo[(d * bins) >> DEPTH] += 1;
+        input[j] = element_bin(x, y, input, j * step);
+        offsets[(input[j] >> range_log2) + 1]++;
     }
+    for(unsigned int o = 0; o < NR_TASKLETS; o++) {
+        offsets[o + 1] += offsets[o];
+        next[o] = offsets[o];
+    }
+    for(unsigned int j = 0; j < l_size; j++) {
+        sorted[next[input[j] >> range_log2]++] = input[j];
+    }
+}
+
+// Add one to a bin of the MRAM histogram through the write-back cache of lines of the tasklet
+static inline void line_update(uint32_t mram_base_addr_histo, uint32_t *tags, uint32_t *lines, uint32_t bin){
+    uint32_t line = bin >> 1;
+    uint32_t slot = line & (LINES - 1);
+    uint32_t *data = &lines[slot << 1];
+    if(tags[slot] != line) {
+        if(tags[slot] != UINT32_MAX)
+            mram_write(data, (__mram_ptr void*)(mram_base_addr_histo + (tags[slot] << 3)), 8);
+        mram_read((__mram_ptr void const*)(mram_base_addr_histo + (line << 3)), data, 8);
+        tags[slot] = line;
+    }
+    data[bin & 1]++;
 }
 
 extern int main_kernel1(void);
+extern int main_kernel2(void);
+extern int main_kernel3(void);
 
-int (*kernels[nr_kernels])(void) = {main_kernel1};
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2, main_kernel3};
 
 int main(void) { 
     // Kernel
@@ -54,6 +145,8 @@ int main_kernel1() {
     uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size;
     uint32_t input_size_dpu_bytes_transfer = DPU_INPUT_ARGUMENTS.transfer_size; // Transfer input size per DPU in bytes
     uint32_t bins = DPU_INPUT_ARGUMENTS.bins;
+    column_t x, y;
+    columns(&x, &y);
 
     // Address of the current processing block in MRAM
     uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
@@ -64,10 +157,11 @@ int main_kernel1() {
     T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
 	
     // Local histogram
-    uint32_t *histo = (uint32_t *) mem_alloc(bins * sizeof(uint32_t));
+    uint32_t bins_8bytes = (bins + 1) & ~1;
+    uint32_t *histo = (uint32_t *) mem_alloc(bins_8bytes * sizeof(uint32_t));
 
     // Initialize local histogram
-    for(unsigned int i = 0; i < bins; i++){
+    for(unsigned int i = 0; i < bins_8bytes; i++){
         histo[i] = 0;
     }
 
@@ -78,10 +172,10 @@ int main_kernel1() {
         uint32_t l_size_bytes = (byte_index + BLOCK_SIZE >= input_size_dpu_bytes) ? (input_size_dpu_bytes - byte_index) : BLOCK_SIZE;
 
         // Load cache with current MRAM block
-        mram_read((const __mram_ptr void*)(mram_base_addr_A + byte_index), cache_A, l_size_bytes);
+        mram_read((const __mram_ptr void*)(mram_base_addr_A + byte_index), cache_A, (l_size_bytes + 7) & ~7);
 
         // Histogram in each tasklet
-        histogram(histo, bins, cache_A, l_size_bytes >> DIV);
+        histogram(histo, &x, &y, cache_A, l_size_bytes >> DIV);
 
     }
     message[tasklet_id] = histo;
@@ -102,15 +196,190 @@ int main_kernel1() {
     // Barrier
     barrier_wait(&my_barrier);
 
-    // Write dpu histogram to current MRAM block
-    if(tasklet_id == 0){
-        if(bins * sizeof(uint32_t) <= 2048)
-            mram_write(histo_dpu, (__mram_ptr void*)(mram_base_addr_histo), bins * sizeof(uint32_t));
-        else 
-            for(unsigned int offset = 0; offset < ((bins * sizeof(uint32_t)) >> 11); offset++){
-                mram_write(histo_dpu + (offset << 9), (__mram_ptr void*)(mram_base_addr_histo + (offset << 11)), 2048);
+    // Write dpu histogram to current MRAM block, or add it to the histogram of the previous waves
+    if(DPU_INPUT_ARGUMENTS.accumulate){
+        for(uint32_t byte_index = tasklet_id << BLOCK_SIZE_LOG2; byte_index < bins_8bytes * sizeof(uint32_t); byte_index += BLOCK_SIZE * NR_TASKLETS){
+            uint32_t l_size_bytes = (byte_index + BLOCK_SIZE >= bins_8bytes * sizeof(uint32_t)) ? (bins_8bytes * sizeof(uint32_t) - byte_index) : BLOCK_SIZE;
+            mram_read((const __mram_ptr void*)(mram_base_addr_histo + byte_index), cache_A, l_size_bytes);
+            for(unsigned int j = 0; j < (l_size_bytes >> 2); j++){
+                cache_A[j] += histo_dpu[(byte_index >> 2) + j];
             }
+            mram_write(cache_A, (__mram_ptr void*)(mram_base_addr_histo + byte_index), l_size_bytes);
+        }
+    }
+    else if(tasklet_id == 0){
+        for(uint32_t byte_index = 0; byte_index < bins_8bytes * sizeof(uint32_t); byte_index += 2048){
+            uint32_t l_size_bytes = (byte_index + 2048 >= bins_8bytes * sizeof(uint32_t)) ? (bins_8bytes * sizeof(uint32_t) - byte_index) : 2048;
+            mram_write(histo_dpu + (byte_index >> 2), (__mram_ptr void*)(mram_base_addr_histo + byte_index), l_size_bytes);
+        }
+    }
+
+    return 0;
+}
+
+// main_kernel2: histogram in MRAM. Tasklet t owns the bins [t << range_log2, (t + 1) << range_log2).
+// In each round, every tasklet buckets the bins of its block by owner in WRAM; after a barrier, each
+// owner applies its bucket of every block through a write-back cache of histogram lines
+int main_kernel2() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size;
+    uint32_t input_size_dpu_bytes_transfer = DPU_INPUT_ARGUMENTS.transfer_size; // Transfer input size per DPU in bytes
+    uint32_t bins = DPU_INPUT_ARGUMENTS.bins;
+    column_t x, y;
+    columns(&x, &y);
+
+    // Bins of this tasklet (whole lines)
+    uint32_t range_log2 = 1;
+    while(((uint32_t) NR_TASKLETS << range_log2) < bins)
+        range_log2++;
+    uint32_t bins_8bytes = (bins + 1) & ~1;
+    uint32_t first_bin = tasklet_id << range_log2;
+    uint32_t last_bin = first_bin + (1 << range_log2) < bins_8bytes ? first_bin + (1 << range_log2) : bins_8bytes;
+
+    // Address of the current processing block in MRAM
+    uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
+    uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
+    uint32_t mram_base_addr_histo = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes_transfer);
+
+    // Initialize a local cache to store the MRAM block, its bucketed bins and the histogram lines
+    T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
+    uint32_t *sorted = (uint32_t *) mem_alloc(BLOCK_SIZE);
+    uint32_t *tags = (uint32_t *) mem_alloc(LINES * sizeof(uint32_t));
+    uint32_t *lines = (uint32_t *) mem_alloc(LINES * 2 * sizeof(uint32_t));
+    for(unsigned int i = 0; i < LINES; i++){
+        tags[i] = UINT32_MAX;
+    }
+    message[tasklet_id] = sorted;
+
+    // Clear the bins of this tasklet, unless they hold the histogram of the previous waves
+    for(unsigned int i = 0; i < REGS; i++){
+        sorted[i] = 0;
+    }
+    for(uint32_t byte_index = first_bin << 2; byte_index < (last_bin << 2) && !DPU_INPUT_ARGUMENTS.accumulate; byte_index += BLOCK_SIZE){
+        uint32_t l_size_bytes = (byte_index + BLOCK_SIZE >= (last_bin << 2)) ? ((last_bin << 2) - byte_index) : BLOCK_SIZE;
+        mram_write(sorted, (__mram_ptr void*)(mram_base_addr_histo + byte_index), l_size_bytes);
+    }
+
+    // Compute histogram. All tasklets take part in every round
+    for(unsigned int round_index = 0; round_index < input_size_dpu_bytes; round_index += BLOCK_SIZE * NR_TASKLETS){
+        uint32_t byte_index = round_index + base_tasklet;
+
+        // Bound checking
+        uint32_t l_size_bytes = byte_index >= input_size_dpu_bytes ? 0 :
+            (byte_index + BLOCK_SIZE >= input_size_dpu_bytes) ? (input_size_dpu_bytes - byte_index) : BLOCK_SIZE;
+
+        // Load cache with current MRAM block
+        if(l_size_bytes > 0)
+            mram_read((const __mram_ptr void*)(mram_base_addr_A + byte_index), cache_A, (l_size_bytes + 7) & ~7);
+
+        // Bucket the bins of the block by owner
+        bucket(sorted, message_offsets[tasklet_id], cache_A, &x, &y, range_log2, l_size_bytes >> DIV);
+
+        // Barrier
+        barrier_wait(&my_barrier);
+
+        // Apply the bins of this tasklet from all blocks of the round
+        for(unsigned int t = 0; t < NR_TASKLETS; t++){
+            uint32_t *bucketed = message[t];
+            for(unsigned int k = message_offsets[t][tasklet_id]; k < message_offsets[t][tasklet_id + 1]; k++){
+                line_update(mram_base_addr_histo, tags, lines, bucketed[k]);
+            }
+        }
+
+        // Barrier
+        barrier_wait(&my_barrier);
+    }
+
+    // Write back the cached lines
+    for(unsigned int i = 0; i < LINES; i++){
+        if(tags[i] != UINT32_MAX)
+            mram_write(&lines[i << 1], (__mram_ptr void*)(mram_base_addr_histo + (tags[i] << 3)), 8);
+    }
+
+    return 0;
+}
+
+// main_kernel3: pre-merge. The non-empty bins of the DPU histogram are packed as (bin, count) pairs
+// after it, in bin order, so that the host retrieves and merges only those. Tasklet t packs a
+// contiguous range of blocks of the histogram; a first pass counts its non-empty bins
+int main_kernel3() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t input_size_dpu_bytes_transfer = DPU_INPUT_ARGUMENTS.transfer_size; // Transfer input size per DPU in bytes
+    uint32_t bins = DPU_INPUT_ARGUMENTS.bins;
+    uint32_t histo_bytes = ((bins + 1) & ~1) * sizeof(uint32_t);
+
+    // Blocks of the histogram of this tasklet
+    uint32_t blocks = divceil(histo_bytes, BLOCK_SIZE);
+    uint32_t first_byte = (blocks * tasklet_id / NR_TASKLETS) << BLOCK_SIZE_LOG2;
+    uint32_t last_byte = (blocks * (tasklet_id + 1) / NR_TASKLETS) << BLOCK_SIZE_LOG2;
+    if(last_byte > histo_bytes)
+        last_byte = histo_bytes;
+
+    uint32_t mram_base_addr_histo = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes_transfer);
+    uint32_t mram_base_addr_pairs = mram_base_addr_histo + histo_bytes;
+
+    // Initialize a local cache to store the MRAM block and the packed pairs
+    uint32_t *cache_H = (uint32_t *) mem_alloc(BLOCK_SIZE);
+    pair_t *cache_P = (pair_t *) mem_alloc(BLOCK_SIZE);
+
+    // Count non-empty bins
+    uint32_t l_count = 0;
+    for(uint32_t byte_index = first_byte; byte_index < last_byte; byte_index += BLOCK_SIZE){
+        uint32_t l_size_bytes = (byte_index + BLOCK_SIZE >= last_byte) ? (last_byte - byte_index) : BLOCK_SIZE;
+        mram_read((const __mram_ptr void*)(mram_base_addr_histo + byte_index), cache_H, l_size_bytes);
+        for(unsigned int j = 0; j < (l_size_bytes >> 2); j++){
+            l_count += cache_H[j] != 0;
+        }
+    }
+    message_nonzero[tasklet_id] = l_count;
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t p_count = 0;
+    for(unsigned int t = 0; t < tasklet_id; t++){
+        p_count += message_nonzero[t];
+    }
+    if(tasklet_id == NR_TASKLETS - 1)
+        DPU_RESULTS.nonzero = p_count + l_count;
+
+    // Pack
+    unsigned int n = 0;
+    for(uint32_t byte_index = first_byte; byte_index < last_byte; byte_index += BLOCK_SIZE){
+        uint32_t l_size_bytes = (byte_index + BLOCK_SIZE >= last_byte) ? (last_byte - byte_index) : BLOCK_SIZE;
+        mram_read((const __mram_ptr void*)(mram_base_addr_histo + byte_index), cache_H, l_size_bytes);
+        for(unsigned int j = 0; j < (l_size_bytes >> 2); j++){
+            if(cache_H[j] == 0)
+                continue;
+            cache_P[n].bin = (byte_index >> 2) + j;
+            cache_P[n].count = cache_H[j];
+            if(++n == PAIRS){
+                mram_write(cache_P, (__mram_ptr void*)(mram_base_addr_pairs + p_count * sizeof(pair_t)), BLOCK_SIZE);
+                p_count += n;
+                n = 0;
+            }
+        }
     }
+    if(n > 0)
+        mram_write(cache_P, (__mram_ptr void*)(mram_base_addr_pairs + p_count * sizeof(pair_t)), n * sizeof(pair_t));
 
     return 0;
 }
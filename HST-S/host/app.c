@@ -17,6 +17,7 @@
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 // Define the DPU Binary path as DPU_BINARY here
 #ifndef DPU_BINARY
@@ -31,6 +32,8 @@
 static T* A;
 static unsigned int* histo_host;
 static unsigned int* histo;
+static pair_t* pairs;
+static T* edges;
 
 // Create input arrays
 static void read_input(T* A, const Params p) {
@@ -38,6 +41,15 @@ static void read_input(T* A, const Params p) {
     char  dctFileName[100];
     FILE *File = NULL;
 
+    // Random values of more bits than the image pixels
+    if(p.depth > DEPTH) {
+        T mask = p.depth == 32 ? UINT32_MAX : (1u << p.depth) - 1;
+        srand(0);
+        for(unsigned int y = 0; y < p.input_size; y++)
+            A[y] = (((T) rand() << 16) ^ (T) rand()) & mask;
+        return;
+    }
+
     // Open input file
     unsigned short temp;
     sprintf(dctFileName, p.file_name);
@@ -55,22 +67,170 @@ static void read_input(T* A, const Params p) {
     }
 }
 
-// Compute output in the host
-static void histogram_host(unsigned int* histo, T* A, unsigned int bins, unsigned int nr_elements, int exp, unsigned int nr_of_dpus) {
-    if(!exp){
-        for (unsigned int i = 0; i < nr_of_dpus; i++) {
-            for (unsigned int j = 0; j < nr_elements; j++) {
-                T d = A[j];
-                histo[i * bins + ((d * bins) >> DEPTH)] += 1;
-            }
+// Lower edges of non-uniform bins over [0, 2^depth), padded with UINT32_MAX
+static void create_edges(T* edges, unsigned int bins, unsigned int depth, unsigned int mode) {
+    const uint64_t range = (uint64_t) 1 << depth;
+    uint64_t e = 0;
+    for(unsigned int k = 0; k < MAX_EDGES; k++)
+        edges[k] = UINT32_MAX;
+    for(unsigned int k = 1; k < bins; k++) {
+        if(mode == EDGES_LOG) {
+            uint64_t l = (uint64_t) pow((double) range, (double) k / bins);
+            e = l > e ? l : e + 1;
+            if(e > range - (bins - k))
+                e = range - (bins - k);
+        } else {
+            uint64_t first = range * k / bins, last = range * (k + 1) / bins;
+            e = first + (uint64_t) rand() % (last - first);
         }
+        edges[k] = (T) e;
+    }
+    if(bins > 0)
+        edges[0] = 0;
+}
+
+// Bin of value d in a column (edges: lower edges of non-uniform bins, or NULL)
+static unsigned int column_bin_host(T d, unsigned int bins, unsigned int depth, const T* edges) {
+    if(edges == NULL)
+        return BIN(d, bins, depth);
+    unsigned int lo = 1, hi = bins; // First edge above d
+    while(lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        if(edges[mid] <= d)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    else{
+    return lo - 1;
+}
+
+// Compute output in the host. Joint histograms count pairs of consecutive pixels
+static void histogram_host(unsigned int* histo, T* A, const Params p, const T* edges, unsigned int nr_elements) {
+    const T* edges_y = edges == NULL ? NULL : edges + MAX_EDGES;
+    if(p.bins_y == 0) {
         for (unsigned int j = 0; j < nr_elements; j++) {
-            T d = A[j];
-            histo[(d * bins) >> DEPTH] += 1;
+            histo[column_bin_host(A[j], p.bins, p.depth, edges)] += 1;
+        }
+    }
+    else {
+        for (unsigned int j = 0; j + 1 < nr_elements; j += 2) {
+            histo[column_bin_host(A[j], p.bins, p.depth, edges) * p.bins_y + column_bin_host(A[j + 1], p.bins_y, p.depth, edges_y)] += 1;
+        }
+    }
+}
+
+// Merge of the DPU histograms: each host thread sums a range of bins over all DPUs, in chunks
+// that stay in cache. The merged histogram replaces the one of the first DPU
+#define MERGE_CHUNK 4096
+typedef struct {
+    unsigned int *histo;
+    unsigned int bins;
+    unsigned int stride; // Distance between DPU histograms
+    unsigned int nr_dpus;
+    pair_t       *pairs; // Packed histograms (pre-merge), max_pairs apart
+    uint64_t     *nonzero;
+    uint64_t     max_pairs;
+} merge_args_t;
+
+static void merge_histograms(void *arg, unsigned int thread, unsigned int nr_threads) {
+    merge_args_t *m = (merge_args_t *) arg;
+    uint64_t first, last;
+    pool_range(m->bins, thread, nr_threads, &first, &last);
+    unsigned int *restrict dst = m->histo;
+    for (uint64_t c = first; c < last; c += MERGE_CHUNK) {
+        uint64_t c_last = c + MERGE_CHUNK < last ? c + MERGE_CHUNK : last;
+        for (unsigned int i = 1; i < m->nr_dpus; i++) {
+            const unsigned int *restrict src = m->histo + (uint64_t) i * m->stride;
+            for (uint64_t j = c; j < c_last; j++)
+                dst[j] += src[j];
+        }
+    }
+}
+
+// Merge of the packed histograms: each host thread finds its range of bins in the pairs of every DPU
+static void merge_pairs(void *arg, unsigned int thread, unsigned int nr_threads) {
+    merge_args_t *m = (merge_args_t *) arg;
+    uint64_t first, last;
+    pool_range(m->bins, thread, nr_threads, &first, &last);
+    memset(&m->histo[first], 0, (last - first) * sizeof(unsigned int));
+    for (unsigned int i = 0; i < m->nr_dpus; i++) {
+        const pair_t *p = m->pairs + (uint64_t) i * m->max_pairs;
+        uint64_t lo = 0, hi = m->nonzero[i];
+        while (lo < hi) {
+            uint64_t mid = (lo + hi) / 2;
+            if (p[mid].bin < first)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (uint64_t k = lo; k < m->nonzero[i] && p[k].bin < last; k++)
+            m->histo[p[k].bin] += p[k].count;
+    }
+}
+
+// Read up to nr_elements 16-bit pixels of the stream (whole pairs for joint histograms). Returns the number read
+static unsigned int read_wave(T* A, FILE* stream, uint16_t* raw, unsigned int nr_elements, const Params p) {
+    unsigned int n = fread(raw, sizeof(uint16_t), nr_elements, stream);
+    if(p.bins_y)
+        n &= ~1;
+    T max = p.depth == 32 ? UINT32_MAX : (1u << p.depth) - 1;
+    for(unsigned int y = 0; y < n; y++) {
+        A[y] = (unsigned int)ByteSwap16(raw[y]);
+        if(A[y] > max)
+            A[y] = max;
+    }
+    return n;
+}
+
+// Streaming input in waves of chunk elements per DPU. While the DPUs process a wave (DPU_ASYNCHRONOUS),
+// the host reads the next one into the other wave buffer. The DPUs add each wave to their histogram in
+// MRAM, which is retrieved once at the end. Returns the number of elements streamed
+static uint64_t stream_waves(struct dpu_set_t dpu_set, dpu_arguments_t *input_arguments, FILE *stream, uint16_t *raw, T **wave_buffer,
+    unsigned int chunk, unsigned int nr_of_dpus, const Params p, unsigned int bins, unsigned int kernel, unsigned int *histo_host, Timer *timer) {
+    struct dpu_set_t dpu;
+    unsigned int i;
+    uint64_t nr_elements = 0;
+    unsigned int nr_wave = read_wave(wave_buffer[0], stream, raw, chunk * nr_of_dpus, p);
+    for(unsigned int wave = 0; wave == 0 || nr_wave > 0; wave++) {
+        T *buffer = wave_buffer[wave % 2];
+
+        // Reference histogram of the wave (CPU)
+        start(timer, 0, wave);
+        histogram_host(histo_host, buffer, p, edges, nr_wave);
+        stop(timer, 0);
+
+        start(timer, 1, wave);
+        for(i = 0; i < nr_of_dpus; i++) {
+            unsigned int first = chunk * i;
+            unsigned int rows = first >= nr_wave ? 0 : (nr_wave - first < chunk ? nr_wave - first : chunk);
+            input_arguments[i].size = rows * sizeof(T);
+            input_arguments[i].transfer_size = chunk * sizeof(T);
+            input_arguments[i].bins = bins;
+            input_arguments[i].depth = p.depth;
+            input_arguments[i].kernel = kernel;
+            input_arguments[i].accumulate = wave > 0;
+            input_arguments[i].bins_y = p.bins_y;
+            input_arguments[i].edges = edges != NULL;
+        }
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
         }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, buffer + (uint64_t) chunk * i));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, chunk * sizeof(T), DPU_XFER_DEFAULT));
+        stop(timer, 1);
+        nr_elements += nr_wave;
+
+        // Launch kernel on DPUs, and read the next wave meanwhile
+        start(timer, 2, wave);
+        DPU_ASSERT(dpu_launch(dpu_set, DPU_ASYNCHRONOUS));
+        nr_wave = read_wave(wave_buffer[(wave + 1) % 2], stream, raw, chunk * nr_of_dpus, p);
+        DPU_ASSERT(dpu_sync(dpu_set));
+        stop(timer, 2);
     }
+    return nr_elements;
 }
 
 // Main of the Host Application
@@ -105,17 +265,56 @@ int main(int argc, char **argv) {
     const unsigned int input_size_8bytes = 
         ((input_size * sizeof(T)) % 8) != 0 ? roundup(input_size, 8) : input_size; // Input size per DPU (max.), 8-byte aligned
     const unsigned int input_size_dpu = divceil(input_size, nr_of_dpus); // Input size per DPU (max.)
-    const unsigned int input_size_dpu_8bytes = 
-        ((input_size_dpu * sizeof(T)) % 8) != 0 ? roundup(input_size_dpu, 8) : input_size_dpu; // Input size per DPU (max.), 8-byte aligned
+    const unsigned int input_size_dpu_8bytes = p.stream_file != NULL ? (p.chunk + 1) & ~1 : // A wave per DPU when streaming
+        (((input_size_dpu * sizeof(T)) % 8) != 0 ? roundup(input_size_dpu, 8) : input_size_dpu); // Input size per DPU (max.), 8-byte aligned
 
-    // Input/output allocation
-    A = malloc(input_size_dpu_8bytes * nr_of_dpus * sizeof(T));
+    const unsigned int bins = p.bins_y ? p.bins * p.bins_y : p.bins; // Bins of the (joint) histogram
+    const unsigned int bins_8bytes = (bins + 1) & ~1; // Histogram size per DPU, 8-byte aligned
+
+    // Histograms per tasklet in WRAM if they fit, otherwise in MRAM
+    unsigned int kernel = p.mode == MODE_MRAM ? kernel2 : kernel1;
+    if(p.mode == MODE_AUTO && (uint64_t) bins * sizeof(uint32_t) * NR_TASKLETS > WRAM_HISTO)
+        kernel = kernel2;
+    assert((kernel == kernel2 || (uint64_t) bins * sizeof(uint32_t) * NR_TASKLETS <= WRAM_HISTO) && "WRAM histograms do not fit in WRAM!");
+    assert((kernel == kernel2 || ((uint64_t) p.bins << p.depth) <= ((uint64_t) 1 << 32)) && "WRAM histograms compute bins in 32 bits!");
+    assert((uint64_t) input_size_dpu_8bytes * sizeof(T) + (uint64_t) bins_8bytes * sizeof(uint32_t) <= MRAM_CAPACITY && "Input and histogram do not fit in MRAM!");
+    assert((!p.premerge || (uint64_t) input_size_dpu_8bytes * sizeof(T) + (uint64_t) bins_8bytes * (sizeof(uint32_t) + sizeof(pair_t)) <= MRAM_CAPACITY) && "Packed histogram does not fit in MRAM!");
+
+    // Input/output allocation (two wave buffers when streaming)
+    A = malloc((p.stream_file != NULL ? 2 : 1) * (uint64_t) input_size_dpu_8bytes * nr_of_dpus * sizeof(T));
     T *bufferA = A;
-    histo_host = malloc(p.bins * sizeof(unsigned int));
-    histo = malloc(nr_of_dpus * p.bins * sizeof(unsigned int));
+    histo_host = malloc(bins * sizeof(unsigned int));
+    // With the pre-merge, only the merged histogram is needed, and the pairs are sized on retrieval
+    const uint64_t histo_size = p.premerge ? bins_8bytes : (uint64_t) nr_of_dpus * bins_8bytes;
+    histo = malloc(histo_size * sizeof(unsigned int));
+    uint64_t *nonzero = calloc(nr_of_dpus, sizeof(uint64_t));
+    uint64_t max_pairs = 0;
+
+    // Input stream
+    FILE *stream = NULL;
+    uint16_t *raw = NULL;
+    T *wave_buffer[2] = {A, A + (uint64_t) input_size_dpu_8bytes * nr_of_dpus};
+    uint64_t stream_elements = 0;
+    if(p.stream_file != NULL) {
+        stream = strcmp(p.stream_file, "-") == 0 ? stdin : fopen(p.stream_file, "rb");
+        if(stream == NULL) {
+            printf("%s does not exist\n", p.stream_file);
+            exit(1);
+        }
+        raw = malloc((uint64_t) input_size_dpu_8bytes * nr_of_dpus * sizeof(uint16_t));
+    }
 
     // Create an input file with arbitrary data
-    read_input(A, p);
+    if(stream == NULL)
+        read_input(A, p);
+
+    // Non-uniform bins, in WRAM of every DPU
+    if(p.edges != EDGES_UNIFORM) {
+        edges = malloc(2 * MAX_EDGES * sizeof(T));
+        create_edges(edges, p.bins, p.depth, p.edges);
+        create_edges(edges + MAX_EDGES, p.bins_y, p.depth, p.edges);
+        DPU_ASSERT(dpu_broadcast_to(dpu_set, "DPU_EDGES", 0, edges, 2 * MAX_EDGES * sizeof(T), DPU_XFER_DEFAULT));
+    }
     if(p.exp == 0){
         for(unsigned int j = 1; j < nr_of_dpus; j++){
             memcpy(&A[j * input_size_dpu_8bytes], &A[0], input_size_dpu_8bytes * sizeof(T));
@@ -126,69 +325,89 @@ int main(int argc, char **argv) {
             memcpy(&A[j * p.input_size], &A[0], p.input_size * sizeof(T));
     }
 
+    // Host threads
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+    merge_args_t merge_args = {histo, bins, bins_8bytes, nr_of_dpus, NULL, nonzero, 0};
+
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\tinput_size\t%u\n", NR_TASKLETS, BL, input_size);
+    printf("NR_TASKLETS\t%d\tBL\t%d\tinput_size\t%u\thistogram\t%s\tpre-merge\t%d\tbins\t%u\tedges\t%u\n", NR_TASKLETS, BL, input_size, kernel == kernel1 ? "wram" : "mram", p.premerge, bins, p.edges);
 
     // Loop over main kernel
     for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
-        memset(histo_host, 0, p.bins * sizeof(unsigned int));
-        memset(histo, 0, nr_of_dpus * p.bins * sizeof(unsigned int));
-
-        // Compute output on CPU (performance comparison and verification purposes)
-        if(rep >= p.n_warmup)
-            start(&timer, 0, rep - p.n_warmup);
-        histogram_host(histo_host, A, p.bins, p.input_size, 1, nr_of_dpus);
-        if(rep >= p.n_warmup)
-            stop(&timer, 0);
+        memset(histo_host, 0, bins * sizeof(unsigned int));
+        memset(histo, 0, histo_size * sizeof(unsigned int));
 
-        printf("Load input data\n");
-        if(rep >= p.n_warmup)
-            start(&timer, 1, rep - p.n_warmup);
-        // Input arguments
-        unsigned int kernel = 0;
-        i = 0;
-	    dpu_arguments_t input_arguments[NR_DPUS];
-	    for(i=0; i<nr_of_dpus-1; i++) {
-	        input_arguments[i].size=input_size_dpu_8bytes * sizeof(T); 
-	        input_arguments[i].transfer_size=input_size_dpu_8bytes * sizeof(T); 
-	        input_arguments[i].bins=p.bins;
-	        input_arguments[i].kernel=kernel;
-	    }
-	    input_arguments[nr_of_dpus-1].size=(input_size_8bytes - input_size_dpu_8bytes * (NR_DPUS-1)) * sizeof(T); 
-	    input_arguments[nr_of_dpus-1].transfer_size=input_size_dpu_8bytes * sizeof(T); 
-	    input_arguments[nr_of_dpus-1].bins=p.bins;
-	    input_arguments[nr_of_dpus-1].kernel=kernel;
-
-        // Copy input arrays
-        i = 0;
-        DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
-        }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
-        DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + input_size_dpu_8bytes * i));
-        }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, input_size_dpu_8bytes * sizeof(T), DPU_XFER_DEFAULT));
-        if(rep >= p.n_warmup)
-            stop(&timer, 1);
-
-        printf("Run program on DPU(s) \n");
-        // Run DPU kernel
-        if(rep >= p.n_warmup) {
-            start(&timer, 2, rep - p.n_warmup);
-            #if ENERGY
-            DPU_ASSERT(dpu_probe_start(&probe));
-            #endif
+        dpu_arguments_t input_arguments[NR_DPUS];
+        if(stream != NULL) {
+            // Waves of the input stream, accumulated on the DPUs
+            printf("Stream input data\n");
+            stream_elements = stream_waves(dpu_set, input_arguments, stream, raw, wave_buffer, input_size_dpu_8bytes, nr_of_dpus,
+                p, bins, kernel, histo_host, &timer);
         }
+        else {
+            // Compute output on CPU (performance comparison and verification purposes)
+            if(rep >= p.n_warmup)
+                start(&timer, 0, rep - p.n_warmup);
+            histogram_host(histo_host, A, p, edges, p.input_size);
+            if(rep >= p.n_warmup)
+                stop(&timer, 0);
+
+            printf("Load input data\n");
+            if(rep >= p.n_warmup)
+                start(&timer, 1, rep - p.n_warmup);
+            // Input arguments
+            i = 0;
+            for(i=0; i<nr_of_dpus-1; i++) {
+                input_arguments[i].size=input_size_dpu_8bytes * sizeof(T); 
+                input_arguments[i].transfer_size=input_size_dpu_8bytes * sizeof(T); 
+                input_arguments[i].bins=bins;
+                input_arguments[i].depth=p.depth;
+                input_arguments[i].kernel=kernel;
+                input_arguments[i].accumulate=0;
+                input_arguments[i].bins_y=p.bins_y;
+                input_arguments[i].edges=edges != NULL;
+            }
+            input_arguments[nr_of_dpus-1].size=(input_size_8bytes - input_size_dpu_8bytes * (NR_DPUS-1)) * sizeof(T); 
+            input_arguments[nr_of_dpus-1].transfer_size=input_size_dpu_8bytes * sizeof(T); 
+            input_arguments[nr_of_dpus-1].bins=bins;
+            input_arguments[nr_of_dpus-1].depth=p.depth;
+            input_arguments[nr_of_dpus-1].kernel=kernel;
+            input_arguments[nr_of_dpus-1].accumulate=0;
+            input_arguments[nr_of_dpus-1].bins_y=p.bins_y;
+            input_arguments[nr_of_dpus-1].edges=edges != NULL;
+
+            // Copy input arrays
+            i = 0;
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + input_size_dpu_8bytes * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, input_size_dpu_8bytes * sizeof(T), DPU_XFER_DEFAULT));
+            if(rep >= p.n_warmup)
+                stop(&timer, 1);
+
+            printf("Run program on DPU(s) \n");
+            // Run DPU kernel
+            if(rep >= p.n_warmup) {
+                start(&timer, 2, rep - p.n_warmup);
+                #if ENERGY
+                DPU_ASSERT(dpu_probe_start(&probe));
+                #endif
+            }
  
-        DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
-        if(rep >= p.n_warmup) {
-            stop(&timer, 2);
-            #if ENERGY
-            DPU_ASSERT(dpu_probe_stop(&probe));
-            #endif
+            DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
+            if(rep >= p.n_warmup) {
+                stop(&timer, 2);
+                #if ENERGY
+                DPU_ASSERT(dpu_probe_stop(&probe));
+                #endif
+            }
         }
 
 #if PRINT
@@ -203,25 +422,66 @@ int main(int argc, char **argv) {
         }
 #endif
 
+        if(p.premerge) {
+            printf("Pre-merge on DPU(s)\n");
+            if(rep >= p.n_warmup)
+                start(&timer, 5, rep - p.n_warmup);
+            for(i = 0; i < nr_of_dpus; i++)
+                input_arguments[i].kernel = kernel3;
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
+            DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
+            if(rep >= p.n_warmup)
+                stop(&timer, 5);
+        }
+
         printf("Retrieve results\n");
         i = 0;
         if(rep >= p.n_warmup)
             start(&timer, 3, rep - p.n_warmup);
         // PARALLEL RETRIEVE TRANSFER
-        DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, histo + p.bins * i));
+        if(p.premerge) {
+            // Packed histograms, as many pairs as the fullest DPU
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, &nonzero[i]));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, "DPU_RESULTS", 0, sizeof(dpu_results_t), DPU_XFER_DEFAULT));
+            uint64_t nr_pairs = 0;
+            for(i = 0; i < nr_of_dpus; i++)
+                if(nonzero[i] > nr_pairs)
+                    nr_pairs = nonzero[i];
+            if(nr_pairs > max_pairs) {
+                free(pairs);
+                pairs = malloc(nr_pairs * nr_of_dpus * sizeof(pair_t));
+                max_pairs = nr_pairs;
+            }
+            if(nr_pairs > 0) {
+                DPU_FOREACH(dpu_set, dpu, i) {
+                    DPU_ASSERT(dpu_prepare_xfer(dpu, pairs + max_pairs * i));
+                }
+                DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu_8bytes * sizeof(T) + bins_8bytes * sizeof(unsigned int), nr_pairs * sizeof(pair_t), DPU_XFER_DEFAULT));
+            }
         }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu_8bytes * sizeof(T), p.bins * sizeof(unsigned int), DPU_XFER_DEFAULT));
-
-        // Final histogram merging
-        for(i = 1; i < nr_of_dpus; i++){
-            for(unsigned int j = 0; j < p.bins; j++){
-                histo[j] += histo[j + i * p.bins];
-            }			
+        else {
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, histo + (uint64_t) bins_8bytes * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu_8bytes * sizeof(T), bins_8bytes * sizeof(unsigned int), DPU_XFER_DEFAULT));
         }
         if(rep >= p.n_warmup)
             stop(&timer, 3);
 
+        // Final histogram merging
+        if(rep >= p.n_warmup)
+            start(&timer, 4, rep - p.n_warmup);
+        merge_args.pairs = pairs;
+        merge_args.max_pairs = max_pairs;
+        pool_run(&pool, p.premerge ? merge_pairs : merge_histograms, &merge_args);
+        if(rep >= p.n_warmup)
+            stop(&timer, 4);
+
     }
 
     // Print timing results
@@ -233,6 +493,15 @@ int main(int argc, char **argv) {
     print(&timer, 2, p.n_reps);
     printf("DPU-CPU ");
     print(&timer, 3, p.n_reps);
+    printf("Inter-DPU ");
+    print(&timer, 4, p.n_reps);
+    if(p.premerge) {
+        printf("DPU pre-merge ");
+        print(&timer, 5, p.n_reps);
+    }
+    if(stream != NULL)
+        printf("\nStreamed elements\t%lu\tWaves\t%lu\n", (unsigned long) stream_elements,
+            (unsigned long) (stream_elements == 0 ? 1 : divceil(stream_elements, (uint64_t) input_size_dpu_8bytes * nr_of_dpus)));
 
     #if ENERGY
     double energy;
@@ -243,7 +512,7 @@ int main(int argc, char **argv) {
     // Check output
     bool status = true;
     if(p.exp == 1) 
-        for (unsigned int j = 0; j < p.bins; j++) {
+        for (unsigned int j = 0; j < bins; j++) {
             if(histo_host[j] != histo[j]){ 
                 status = false;
 #if PRINT
@@ -252,7 +521,7 @@ int main(int argc, char **argv) {
             }
         }
     else if(p.exp == 2) 
-        for (unsigned int j = 0; j < p.bins; j++) {
+        for (unsigned int j = 0; j < bins; j++) {
             if(dpu_s * histo_host[j] != histo[j]){ 
                 status = false;
 #if PRINT
@@ -261,7 +530,7 @@ int main(int argc, char **argv) {
             }
         }
     else
-        for (unsigned int j = 0; j < p.bins; j++) {
+        for (unsigned int j = 0; j < bins; j++) {
             if(nr_of_dpus * histo_host[j] != histo[j]){ 
                 status = false;
 #if PRINT
@@ -279,6 +548,13 @@ int main(int argc, char **argv) {
     free(A);
     free(histo_host);
     free(histo);
+    free(raw);
+    if(stream != NULL && stream != stdin)
+        fclose(stream);
+    free(pairs);
+    free(nonzero);
+    free(edges);
+    pool_free(&pool);
     DPU_ASSERT(dpu_free(dpu_set));
 	
     return status ? 0 : -1;
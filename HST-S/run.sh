@@ -15,3 +15,56 @@ do
 		done
 	done
 done
+
+# Histograms in MRAM (random 24-bit input)
+for i in 1 
+do
+	for b in 65536 262144 1048576 4194304 8388608
+	do
+    	for k in 1 2 4 8 16
+	    do
+            NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
+            wait
+            ./bin/host_code -w 2 -e 5 -b ${b} -d 24 -x 1 -i 262144 > profile/HSTS_MRAM_${b}_tl${k}_dpu${i}.txt
+            wait
+            make clean
+            wait
+		done
+	done
+done
+
+# Streaming input in waves
+for i in 1 
+do
+	for c in 4096 16384 65536 262144
+	do
+    	for k in 1 2 4 8 16
+	    do
+            NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
+            wait
+            ./bin/host_code -b 256 -s ./input/image_VanHateren.iml -c ${c} > profile/HSTS_STREAM_${c}_tl${k}_dpu${i}.txt
+            wait
+            make clean
+            wait
+		done
+	done
+done
+
+# Non-uniform bins (logarithmic and random edges) and joint histograms of pixel pairs
+for i in 1 
+do
+	for g in 0 1 2
+	do
+    	for k in 1 2 4 8 16
+	    do
+            NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
+            wait
+            ./bin/host_code -w 2 -e 5 -b 256 -g ${g} -x 1 > profile/HSTS_EDGES_${g}_tl${k}_dpu${i}.txt
+            wait
+            ./bin/host_code -w 2 -e 5 -b 64 -y 64 -g ${g} -x 1 > profile/HSTS_JOINT_64x64_${g}_tl${k}_dpu${i}.txt
+            wait
+            make clean
+            wait
+		done
+	done
+done
@@ -20,17 +20,56 @@
 #define DEPTH 12
 #define ByteSwap16(n) (((((unsigned int)n) << 8) & 0xFF00) | ((((unsigned int)n) >> 8) & 0x00FF))
 
+// WRAM (bytes, all tasklets together) for the histograms of kernel1. Larger histograms live in MRAM
+#define WRAM_HISTO 32768
+// Write-back cache of MRAM histogram lines (2 bins, one 8-byte MRAM word) of each tasklet
+#define LINES 64
+
 // Structures used by both the host and the dpu to communicate information 
 typedef struct {
     uint32_t size;
     uint32_t transfer_size;
     uint32_t bins;
+    uint32_t depth; // Bits of the input values
+    uint32_t accumulate; // Add to the histogram in MRAM (streaming waves after the first)
+    uint32_t bins_y; // Bins of the second column of a joint histogram of column pairs (0: single column). bins is the product
+    uint32_t edges; // Non-uniform bins, given by their lower edges in DPU_EDGES
 	enum kernels {
-	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel1 = 0, // Histogram per tasklet in WRAM
+	    kernel2 = 1, // Histogram in MRAM, bin ranges owned by tasklets
+	    kernel3 = 2, // Pre-merge: pack the non-empty bins of the DPU histogram (second launch)
+	    nr_kernels = 3,
 	} kernel;
 } dpu_arguments_t;
 
+typedef struct {
+    uint64_t nonzero; // Non-empty bins packed by kernel3
+} dpu_results_t;
+
+// Non-empty bin of a packed histogram
+typedef struct {
+    uint32_t bin;
+    uint32_t count;
+} pair_t;
+#define PAIRS (BLOCK_SIZE / sizeof(pair_t)) // Pairs in a block
+
+// Bin of value d
+#define BIN(d, bins, depth) ((uint32_t) (((uint64_t) (d) * (bins)) >> (depth)))
+
+// Non-uniform bins: lower edges of the bins of each column (second column at MAX_EDGES), padded with
+// UINT32_MAX up to the next power of two
+#define MAX_EDGES 256
+#define EDGES_UNIFORM 0
+#define EDGES_LOG 1
+#define EDGES_RANDOM 2
+
+// Histogram placement
+#define MODE_AUTO 0
+#define MODE_WRAM 1
+#define MODE_MRAM 2
+
+#define MRAM_CAPACITY (64 << 20)
+
 #ifndef ENERGY
 #define ENERGY 0
 #endif
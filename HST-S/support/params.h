@@ -11,6 +11,14 @@ typedef struct Params {
     const char *file_name;
     int  exp;
     int  dpu_s;
+    unsigned int   depth;
+    unsigned int   mode;
+    unsigned int   n_threads;
+    int  premerge;
+    const char *stream_file;
+    unsigned int   chunk;
+    unsigned int   edges;
+    unsigned int   bins_y;
 }Params;
 
 static void usage() {
@@ -22,11 +30,19 @@ static void usage() {
         "\n    -w <W>    # of untimed warmup iterations (default=1)"
         "\n    -e <E>    # of timed repetition iterations (default=3)"
         "\n    -x <X>    Weak (0) or strong (1, 2) scaling (default=0)"
+        "\n    -t <T>    # of host threads for the merge of the DPU histograms (default=4)"
         "\n"
         "\nBenchmark-specific options:"
         "\n    -i <I>    input size (default=1536*1024 elements)"
         "\n    -b <B>    histogram size (default=256 bins)"
         "\n    -f <F>    input image file (default=../input/image_VanHateren.iml)"
+        "\n    -d <D>    bits of the input values; above 12, random values instead of the image (default=12)"
+        "\n    -m <M>    histogram: 0 automatic, 1 per tasklet in WRAM, 2 in MRAM partitioned by bin range (default=0)"
+        "\n    -p <P>    pre-merge: the DPUs pack their non-empty bins before retrieval (default=0)"
+        "\n    -s <S>    stream 16-bit pixels from file S (- for stdin) instead of the image; a single timed run"
+        "\n    -c <C>    elements per DPU in each wave of the stream (default=65536)"
+        "\n    -g <G>    bins: 0 uniform, 1 logarithmic edges, 2 random edges (default=0)"
+        "\n    -y <Y>    joint histogram of pixel pairs, with Y bins for the second pixel (default=0, single pixels)"
         "\n");
 }
 
@@ -39,9 +55,17 @@ struct Params input_params(int argc, char **argv) {
     p.exp           = 0;
     p.file_name     = "./input/image_VanHateren.iml";
     p.dpu_s         = 64;
+    p.depth         = DEPTH;
+    p.mode          = MODE_AUTO;
+    p.n_threads     = 4;
+    p.premerge      = 0;
+    p.stream_file   = NULL;
+    p.chunk         = 65536;
+    p.edges         = EDGES_UNIFORM;
+    p.bins_y        = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hi:b:w:e:f:x:z:")) >= 0) {
+    while((opt = getopt(argc, argv, "hi:b:w:e:f:x:z:d:m:t:p:s:c:g:y:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
@@ -54,6 +78,14 @@ struct Params input_params(int argc, char **argv) {
         case 'f': p.file_name     = optarg; break;
         case 'x': p.exp           = atoi(optarg); break;
         case 'z': p.dpu_s         = atoi(optarg); break;
+        case 'd': p.depth         = atoi(optarg); break;
+        case 'm': p.mode          = atoi(optarg); break;
+        case 't': p.n_threads     = atoi(optarg); break;
+        case 'p': p.premerge      = atoi(optarg); break;
+        case 's': p.stream_file   = optarg; break;
+        case 'c': p.chunk         = atoi(optarg); break;
+        case 'g': p.edges         = atoi(optarg); break;
+        case 'y': p.bins_y        = atoi(optarg); break;
         default:
             fprintf(stderr, "\nUnrecognized option!\n");
             usage();
@@ -61,6 +93,18 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    assert(p.n_threads > 0 && "Invalid # of host threads!");
+    assert(p.chunk > 0 && "Invalid wave size!");
+    if(p.stream_file != NULL) { // The stream is consumed once, and its histogram is the total
+        p.n_warmup = 0;
+        p.n_reps = 1;
+        p.exp = 1;
+    }
+    assert(p.depth >= DEPTH && p.depth <= 32 && "Invalid depth!");
+    assert(p.edges <= EDGES_RANDOM && "Invalid bin edges!");
+    assert((p.edges == EDGES_UNIFORM || (p.bins <= MAX_EDGES && p.bins_y <= MAX_EDGES)) && "Too many non-uniform bins!");
+    assert((p.edges == EDGES_UNIFORM || ((uint64_t) p.bins <= (1ull << p.depth) && (uint64_t) p.bins_y <= (1ull << p.depth))) && "More non-uniform bins than values!");
+    assert((p.bins_y == 0 || (p.input_size % 2 == 0 && p.chunk % 2 == 0)) && "Joint histograms need pixel pairs!");
 
     return p;
 }
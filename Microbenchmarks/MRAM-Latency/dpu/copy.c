@@ -19,15 +19,16 @@ __host dpu_results_t DPU_RESULTS[NR_TASKLETS];
 BARRIER_INIT(my_barrier, NR_TASKLETS);
 
 extern int main_kernel1(void);
+extern int main_kernel2(void);
 
-int (*kernels[nr_kernels])(void) = {main_kernel1};
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2};
 
 int main(void) { 
     // Kernel
     return kernels[DPU_INPUT_ARGUMENTS.kernel](); 
 }
 
-// main_kernel1
+// main_kernel1: timed reads
 int main_kernel1() {
     unsigned int tasklet_id = me();
 #if PRINT
@@ -43,41 +44,77 @@ int main_kernel1() {
     barrier_wait(&my_barrier);
 
     uint32_t input_size_dpu = DPU_INPUT_ARGUMENTS.size / sizeof(T);
+    uint32_t block_size_log2 = DPU_INPUT_ARGUMENTS.block_size_log2;
+    uint32_t block_size = 1 << block_size_log2;
 
     dpu_results_t *result = &DPU_RESULTS[tasklet_id];
     result->cycles = 0;
 
     // Address of the current processing block in MRAM
-    uint32_t mram_base_addr_A = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << BLOCK_SIZE_LOG2));
-    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << BLOCK_SIZE_LOG2) + input_size_dpu * sizeof(T));
+    uint32_t mram_base_addr_A = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2));
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2) + input_size_dpu * sizeof(T));
 
     // Initialize a local cache to store the MRAM block
-    T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
+    T *cache_A = (T *) mem_alloc(block_size);
 
-    for(unsigned int byte_index = 0; byte_index < input_size_dpu * sizeof(T); byte_index += BLOCK_SIZE * NR_TASKLETS){
+    for(unsigned int byte_index = 0; byte_index < input_size_dpu * sizeof(T); byte_index += block_size * NR_TASKLETS){
         __mram_ptr void const* address_A = (__mram_ptr void const*)(mram_base_addr_A + byte_index);
         __mram_ptr void* address_B = (__mram_ptr void*)(mram_base_addr_B + byte_index);
-#ifdef READ
         // Barrier
         timer_start(&cycles); // START TIMER
-#endif
         // Load cache with current MRAM block
-        mram_read(address_A, cache_A, BLOCK_SIZE);
-#ifdef READ
+        mram_read(address_A, cache_A, block_size);
         // Barrier
         result->cycles += timer_stop(&cycles); // STOP TIMER
+
+        // Write cache to current MRAM block
+        mram_write(cache_A, address_B, block_size);
+    }
+
+    return 0;
+}
+
+// main_kernel2: timed writes
+int main_kernel2() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
 #endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+
+        perfcounter_config(COUNT_CYCLES, true);
+    }
+    perfcounter_cycles cycles;
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t input_size_dpu = DPU_INPUT_ARGUMENTS.size / sizeof(T);
+    uint32_t block_size_log2 = DPU_INPUT_ARGUMENTS.block_size_log2;
+    uint32_t block_size = 1 << block_size_log2;
+
+    dpu_results_t *result = &DPU_RESULTS[tasklet_id];
+    result->cycles = 0;
+
+    // Address of the current processing block in MRAM
+    uint32_t mram_base_addr_A = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2));
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2) + input_size_dpu * sizeof(T));
+
+    // Initialize a local cache to store the MRAM block
+    T *cache_A = (T *) mem_alloc(block_size);
+
+    for(unsigned int byte_index = 0; byte_index < input_size_dpu * sizeof(T); byte_index += block_size * NR_TASKLETS){
+        __mram_ptr void const* address_A = (__mram_ptr void const*)(mram_base_addr_A + byte_index);
+        __mram_ptr void* address_B = (__mram_ptr void*)(mram_base_addr_B + byte_index);
+        // Load cache with current MRAM block
+        mram_read(address_A, cache_A, block_size);
 
-#ifdef WRITE
         // Barrier
         timer_start(&cycles); // START TIMER
-#endif
         // Write cache to current MRAM block
-        mram_write(cache_A, address_B, BLOCK_SIZE);
-#ifdef WRITE
+        mram_write(cache_A, address_B, block_size);
         // Barrier
         result->cycles += timer_stop(&cycles); // STOP TIMER
-#endif
     }
 
     return 0;
@@ -1,21 +1,8 @@
 #!/bin/bash
 
-for i in 3 4 5 6 7 8 9 10 11
-do
-	for j in 1 
-	do
-		NR_DPUS=1 NR_TASKLETS=$j BL=$i OP=READ make all
-		wait
-		./bin/host_code -w 0 -e 1 -i 2097152 > profile/read_tl${j}_bl${i}.txt
-		wait
-		make clean 
-		wait
-
-		NR_DPUS=1 NR_TASKLETS=$j BL=$i OP=WRITE make all
-		wait
-		./bin/host_code -w 0 -e 1 -i 2097152 > profile/write_tl${j}_bl${i}.txt
-		wait
-		make clean 
-		wait
-        done
-done
+# One build, then all transfer sizes and operations in a single run
+NR_DPUS=1 SWEEP_TASKLETS="1" make sweep
+wait
+./bin/host_code -w 0 -e 1 -i 2097152 -t 1 -b 3,4,5,6,7,8,9,10,11 -o READ,WRITE -c > profile/mram_latency.csv
+wait
+make clean
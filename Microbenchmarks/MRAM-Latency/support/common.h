@@ -4,17 +4,22 @@
 // Structures used by both the host and the dpu to communicate information 
 typedef struct {
     uint32_t size;
+    uint32_t block_size_log2; // Transfer size between MRAM and WRAM
 	enum kernels {
-	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel1 = 0, // Timed MRAM reads
+	    kernel2 = 1, // Timed MRAM writes
+	    nr_kernels = 2,
 	} kernel;
 } dpu_arguments_t;
 
+// Names of the kernels (-o)
+#define KERNEL_NAMES {"READ", "WRITE"}
+
 typedef struct {
     uint64_t cycles;
 } dpu_results_t;
 
-// Transfer size between MRAM and WRAM
+// Transfer size between MRAM and WRAM (default of -b)
 #ifdef BL
 #define BLOCK_SIZE_LOG2 BL
 #define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
@@ -23,6 +28,8 @@ typedef struct {
 #define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
 #define BL BLOCK_SIZE_LOG2
 #endif
+#define MIN_BLOCK_SIZE_LOG2 3
+#define MAX_BLOCK_SIZE_LOG2 11
 
 // Data type
 #define T uint64_t
@@ -0,0 +1,200 @@
+/*
+* STREAM Copy, Copy (WRAM), Add, Scale and Triad
+*
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <defs.h>
+#include <mram.h>
+#include <alloc.h>
+#include <perfcounter.h>
+#include <barrier.h>
+
+#include "../support/common.h"
+#include "../support/cyclecount.h"
+
+__host dpu_arguments_t DPU_INPUT_ARGUMENTS;
+__host dpu_results_t DPU_RESULTS[NR_TASKLETS];
+
+// Copy
+static void copyw_dpu(T *bufferB, T *bufferA, uint32_t block_size) {
+
+    #pragma unroll
+    for (unsigned int i = 0; i < block_size / sizeof(T); i++){
+        bufferB[i] = bufferA[i];
+    }
+
+}
+
+// Add
+static void add_dpu(T *bufferC, T *bufferA, T *bufferB, uint32_t block_size) {
+
+    #pragma unroll
+    for (unsigned int i = 0; i < block_size / sizeof(T); i++){
+        bufferC[i] = bufferA[i] + bufferB[i];
+    }
+
+}
+
+// Scale
+static void scale_dpu(T *bufferB, T *bufferA, T scalar, uint32_t block_size) {
+
+    #pragma unroll
+    for (unsigned int i = 0; i < block_size / sizeof(T); i++){
+        bufferB[i] = scalar * bufferA[i];
+    }
+
+}
+
+// Triad
+static void triad_dpu(T *bufferC, T *bufferA, T *bufferB, T scalar, uint32_t block_size) {
+
+    #pragma unroll
+    for (unsigned int i = 0; i < block_size / sizeof(T); i++){
+        bufferC[i] = bufferA[i] + scalar * bufferB[i];
+    }
+
+}
+
+// Bytes of the block at offset, partial or empty at the end of an input that does not divide evenly among the tasklets
+static uint32_t block_bytes(uint32_t size, uint32_t offset, uint32_t block_size) {
+    return offset >= size ? 0 : (size - offset < block_size ? size - offset : block_size);
+}
+
+// Barrier
+BARRIER_INIT(my_barrier, NR_TASKLETS);
+
+extern int main_kernel1(void);
+extern int main_kernel2(void);
+
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2, main_kernel2, main_kernel2, main_kernel2};
+
+int main(void) {
+    // Kernel
+    return kernels[DPU_INPUT_ARGUMENTS.kernel]();
+}
+
+// main_kernel1: copy from MRAM to MRAM
+int main_kernel1() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+
+        perfcounter_config(COUNT_CYCLES, true);
+    }
+    perfcounter_cycles cycles;
+    // Barrier
+    barrier_wait(&my_barrier);
+    timer_start(&cycles); // START TIMER
+
+    uint32_t input_size_dpu = DPU_INPUT_ARGUMENTS.size / sizeof(T);
+    uint32_t block_size_log2 = DPU_INPUT_ARGUMENTS.block_size_log2;
+    uint32_t block_size = 1 << block_size_log2;
+
+    dpu_results_t *result = &DPU_RESULTS[tasklet_id];
+    result->cycles = 0;
+
+    // Address of the current processing block in MRAM
+    uint32_t mram_base_addr_A = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2));
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2) + input_size_dpu * sizeof(T));
+
+    // Initialize a local cache to store the MRAM block
+    T *cache_A = (T *) mem_alloc(block_size);
+
+    for(unsigned int byte_index = 0; (tasklet_id << block_size_log2) + byte_index < input_size_dpu * sizeof(T); byte_index += block_size * NR_TASKLETS){
+        uint32_t l = block_bytes(input_size_dpu * sizeof(T), (tasklet_id << block_size_log2) + byte_index, block_size);
+
+        // Load cache with current MRAM block
+        mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, l);
+
+        // Write cache to current MRAM block
+        mram_write(cache_A, (__mram_ptr void*)(mram_base_addr_B + byte_index), l);
+
+    }
+
+    result->cycles = timer_stop(&cycles); // STOP TIMER
+    return 0;
+}
+
+// main_kernel2: copy, add, scale and triad on WRAM blocks
+int main_kernel2() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+
+        perfcounter_config(COUNT_CYCLES, true);
+    }
+    perfcounter_cycles cycles;
+    const uint32_t wram = DPU_INPUT_ARGUMENTS.wram;
+    // Barrier
+    barrier_wait(&my_barrier);
+    if(!wram)
+        timer_start(&cycles); // START TIMER
+
+    const unsigned int kernel = DPU_INPUT_ARGUMENTS.kernel;
+    uint32_t input_size_dpu = DPU_INPUT_ARGUMENTS.size / sizeof(T);
+    uint32_t block_size_log2 = DPU_INPUT_ARGUMENTS.block_size_log2;
+    uint32_t block_size = 1 << block_size_log2;
+
+    T scalar = (T)input_size_dpu; // Simply use this number as a scalar
+
+    dpu_results_t *result = &DPU_RESULTS[tasklet_id];
+    result->cycles = 0;
+
+    // Address of the current processing block in MRAM
+    // Copy and scale write B, add and triad read B and write C
+    const bool two_inputs = kernel == kernel3 || kernel == kernel5;
+    uint32_t mram_base_addr_A = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2));
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2) + input_size_dpu * sizeof(T));
+    uint32_t mram_base_addr_C = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2) + (two_inputs ? 2 : 1) * input_size_dpu * sizeof(T));
+
+    // Initialize a local cache to store the MRAM block
+    T *cache_A = (T *) mem_alloc(block_size);
+    T *cache_B = (T *) mem_alloc(block_size);
+
+    // Every tasklet runs the same number of iterations (the barriers of the WRAM timing), the last ones may be empty
+    for(unsigned int byte_index = 0; byte_index < input_size_dpu * sizeof(T); byte_index += block_size * NR_TASKLETS){
+        uint32_t l = block_bytes(input_size_dpu * sizeof(T), (tasklet_id << block_size_log2) + byte_index, block_size);
+
+        // Load cache with current MRAM block
+        if(l > 0)
+            mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, l);
+        if(two_inputs && l > 0)
+            mram_read((__mram_ptr void const*)(mram_base_addr_B + byte_index), cache_B, l);
+
+        if(wram){
+            // Barrier
+            barrier_wait(&my_barrier);
+            timer_start(&cycles); // START TIMER
+        }
+
+        switch(kernel){
+        case kernel2: copyw_dpu(cache_B, cache_A, l); break;
+        case kernel3: add_dpu(cache_B, cache_A, cache_B, l); break;
+        case kernel4: scale_dpu(cache_B, cache_A, scalar, l); break;
+        default: triad_dpu(cache_B, cache_A, cache_B, scalar, l); break;
+        }
+
+        if(wram){
+            result->cycles += timer_stop(&cycles); // STOP TIMER
+            // Barrier
+            barrier_wait(&my_barrier);
+        }
+
+        // Write cache to current MRAM block
+        if(l > 0)
+            mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_C + byte_index), l);
+
+    }
+
+    if(!wram)
+        result->cycles = timer_stop(&cycles); // STOP TIMER
+    return 0;
+}
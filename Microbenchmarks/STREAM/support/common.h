@@ -4,17 +4,27 @@
 // Structures used by both the host and the dpu to communicate information 
 typedef struct {
     uint32_t size;
+    uint32_t block_size_log2; // Transfer size between MRAM and WRAM
+    uint32_t wram; // Time only the computation on WRAM blocks
 	enum kernels {
-	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel1 = 0, // Copy (MRAM to MRAM)
+	    kernel2 = 1, // Copy through WRAM
+	    kernel3 = 2, // Add
+	    kernel4 = 3, // Scale
+	    kernel5 = 4, // Triad
+	    nr_kernels = 5,
 	} kernel;
 } dpu_arguments_t;
 
+// Names of the kernels (-o) and of the timed memories (-m)
+#define KERNEL_NAMES {"copy", "copyw", "add", "scale", "triad"}
+#define MEM_NAMES {"MRAM", "WRAM"}
+
 typedef struct {
     uint64_t cycles;
 } dpu_results_t;
 
-// Transfer size between MRAM and WRAM
+// Transfer size between MRAM and WRAM (default of -b)
 #ifdef BL
 #define BLOCK_SIZE_LOG2 BL
 #define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
@@ -23,6 +33,10 @@ typedef struct {
 #define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
 #define BL BLOCK_SIZE_LOG2
 #endif
+#define MIN_BLOCK_SIZE_LOG2 3
+#define MAX_BLOCK_SIZE_LOG2 11
+// WRAM left for the two caches of all tasklets
+#define WRAM_BUDGET (48 << 10)
 
 // Data type
 #define T uint64_t
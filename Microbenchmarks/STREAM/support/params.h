@@ -3,11 +3,23 @@
 
 #include "common.h"
 
+// Values of a swept parameter
+#define MAX_LIST 32
+
 typedef struct Params {
     unsigned int   input_size;
     int   n_warmup;
     int   n_reps;
     int  exp;
+    int  csv;
+    unsigned int   tasklets[MAX_LIST];
+    unsigned int   nr_tasklets;
+    unsigned int   bl[MAX_LIST];
+    unsigned int   nr_bl;
+    unsigned int   ops[MAX_LIST];
+    unsigned int   nr_ops;
+    unsigned int   mems[MAX_LIST];
+    unsigned int   nr_mems;
 }Params;
 
 static void usage() {
@@ -19,21 +31,60 @@ static void usage() {
         "\n    -w <W>    # of untimed warmup iterations (default=1)"
         "\n    -e <E>    # of timed repetition iterations (default=3)"
         "\n    -x <X>    Weak (0) or strong (1) scaling (default=0)"
+        "\n    -t <T>    # of tasklets, one DPU binary each (make sweep) (default=NR_TASKLETS)"
+        "\n    -c        one CSV line per configuration"
         "\n"
         "\nBenchmark-specific options:"
         "\n    -i <I>    input size (default=8K elements)"
+        "\n    -b <B>    log2 of the MRAM-WRAM transfer size (default=BL)"
+        "\n    -o <O>    operation: copy, copyw, add, scale, triad (default=copy)"
+        "\n    -m <M>    timed memory: MRAM (whole kernel), WRAM (computation only) (default=MRAM)"
+        "\n"
+        "\n    -t, -b, -o and -m take comma-separated lists: all their combinations run in turn"
         "\n");
 }
 
+// Comma-separated list of numbers, or of names (their index in names)
+static unsigned int parse_list(unsigned int *list, char *arg, const char *const *names, unsigned int nr_names) {
+    unsigned int n = 0;
+    for(char *token = strtok(arg, ","); token != NULL; token = strtok(NULL, ",")) {
+        assert(n < MAX_LIST && "Too many values!");
+        unsigned int k = 0;
+        if(names == NULL)
+            k = atoi(token);
+        else
+            while(k < nr_names && strcmp(token, names[k]) != 0)
+                k++;
+        if(k == nr_names) {
+            fprintf(stderr, "\nUnrecognized value %s!\n", token);
+            usage();
+            exit(0);
+        }
+        list[n++] = k;
+    }
+    return n;
+}
+
 struct Params input_params(int argc, char **argv) {
+    static const char *const kernel_names[nr_kernels] = KERNEL_NAMES;
+    static const char *const mem_names[2] = MEM_NAMES;
     struct Params p;
     p.input_size    = 8 << 10;
     p.n_warmup      = 1;
     p.n_reps        = 3;
     p.exp           = 0;
+    p.csv           = 0;
+    p.tasklets[0]   = NR_TASKLETS;
+    p.nr_tasklets   = 1;
+    p.bl[0]         = BL;
+    p.nr_bl         = 1;
+    p.ops[0]        = kernel1;
+    p.nr_ops        = 1;
+    p.mems[0]       = 0;
+    p.nr_mems       = 1;
 
     int opt;
-    while((opt = getopt(argc, argv, "hi:w:e:x:")) >= 0) {
+    while((opt = getopt(argc, argv, "hi:w:e:x:t:cb:o:m:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
@@ -43,6 +94,11 @@ struct Params input_params(int argc, char **argv) {
         case 'w': p.n_warmup      = atoi(optarg); break;
         case 'e': p.n_reps        = atoi(optarg); break;
         case 'x': p.exp           = atoi(optarg); break;
+        case 't': p.nr_tasklets   = parse_list(p.tasklets, optarg, NULL, 0); break;
+        case 'c': p.csv           = 1; break;
+        case 'b': p.nr_bl         = parse_list(p.bl, optarg, NULL, 0); break;
+        case 'o': p.nr_ops        = parse_list(p.ops, optarg, kernel_names, nr_kernels); break;
+        case 'm': p.nr_mems       = parse_list(p.mems, optarg, mem_names, 2); break;
         default:
             fprintf(stderr, "\nUnrecognized option!\n");
             usage();
@@ -50,6 +106,8 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    for(unsigned int i = 0; i < p.nr_bl; i++)
+        assert(p.bl[i] >= MIN_BLOCK_SIZE_LOG2 && p.bl[i] <= MAX_BLOCK_SIZE_LOG2 && "Invalid transfer size!");
 
     return p;
 }
@@ -17,19 +17,18 @@
 #include "../support/timer.h"
 #include "../support/params.h"
 
-// Define the DPU Binary path as DPU_BINARY here
+// Define the DPU Binary path as DPU_BINARY here, one binary per # of tasklets
 #ifndef DPU_BINARY
-#define DPU_BINARY "./bin/dpu_code"
+#define DPU_BINARY "./bin/dpu_code_tl%u"
 #endif
 
 // Create input arrays
-static void read_input(T* A, T* B, T* C, unsigned int nr_elements) {
+static void read_input(T* A, unsigned int nr_elements, bool verbose) {
     srand(0);
-    printf("nr_elements\t%u\t", nr_elements);
+    if(verbose)
+        printf("nr_elements\t%u\t", nr_elements);
     for (unsigned int i = 0; i < nr_elements; i++) {
         A[i] = (T) (rand());
-        B[i] = A[i];
-        C[i] = A[i];
     }
 }
 
@@ -45,76 +44,72 @@ static T* A;
 static T* B;
 static T* C;
 
-// Main of the Host Application
-int main(int argc, char **argv) {
-
-    struct Params p = input_params(argc, argv);
-
-    struct dpu_set_t dpu_set, dpu;
-    uint32_t nr_of_dpus;
-    
-    // Allocate DPUs and load binary
-    DPU_ASSERT(dpu_alloc(NR_DPUS, NULL, &dpu_set));
-    DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-    DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-    printf("Allocated %d DPU(s)\n", nr_of_dpus);
+// Run one configuration on the loaded binary: the stride, the block size and the kernel are input arguments
+static bool run_config(struct dpu_set_t dpu_set, uint32_t nr_of_dpus, struct Params *p, unsigned int input_size,
+    unsigned int nr_tasklets, unsigned int stride, unsigned int bl, unsigned int kernel) {
 
+    struct dpu_set_t dpu;
     unsigned int i = 0;
     double cc = 0;
     double cc_min = 0;
-    const unsigned int input_size = p.exp == 0 ? p.input_size * nr_of_dpus : p.input_size;
-
-    // Input/output allocation
-    A = malloc(input_size * sizeof(T));
-    B = malloc(input_size * sizeof(T));
-    C = malloc(input_size * sizeof(T));
+    const unsigned int input_size_dpu = input_size / nr_of_dpus;
+    assert((input_size_dpu * sizeof(T)) % ((kernel == kernel1 ? nr_tasklets << bl : nr_tasklets) * sizeof(T)) == 0 && "Input size!");
     T *bufferA = A;
     T *bufferB = B;
-
-    // Create an input file with arbitrary data
-    read_input(A, B, C, input_size);
+    static const char *const kernel_names[nr_kernels] = KERNEL_NAMES;
 
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\n", NR_TASKLETS, BL);
+    if(!p->csv)
+        printf("NR_TASKLETS\t%d\tBL\t%d\tOP\t%s\tSTRIDE\t%u\n", nr_tasklets, bl, kernel_names[kernel], stride);
+
+    // Initialize the output (and its reference) with values other than the input, so that only the elements at the stride match it
+    for (i = 0; i < input_size; i++) {
+        bufferB[i] = ~bufferA[i];
+        C[i] = ~bufferA[i];
+    }
+    i = 0;
+    DPU_FOREACH (dpu_set, dpu) {
+        DPU_ASSERT(dpu_copy_to(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), bufferB + input_size_dpu * i, input_size_dpu * sizeof(T)));
+        i++;
+    }
 
     // Loop over main kernel
-    for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
+    for(int rep = 0; rep < p->n_warmup + p->n_reps; rep++) {
 
         // Compute output on CPU (performance comparison and verification purposes)
-        if(rep >= p.n_warmup)
-            start(&timer, 0, rep - p.n_warmup);
-        stride_host(C, A, input_size, p.stride);
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
+            start(&timer, 0, rep - p->n_warmup);
+        stride_host(C, A, input_size, stride);
+        if(rep >= p->n_warmup)
             stop(&timer, 0);
 
-        printf("Load input data\n");
-        if(rep >= p.n_warmup)
-            start(&timer, 1, rep - p.n_warmup);
+        if(!p->csv)
+            printf("Load input data\n");
+        if(rep >= p->n_warmup)
+            start(&timer, 1, rep - p->n_warmup);
         // Input arguments
-        const unsigned int input_size_dpu = input_size / nr_of_dpus;
-        unsigned int kernel = 0;
-        dpu_arguments_t input_arguments = {input_size_dpu * sizeof(T), p.stride, kernel};
+        dpu_arguments_t input_arguments = {input_size_dpu * sizeof(T), stride, bl, kernel};
         DPU_ASSERT(dpu_copy_to(dpu_set, "DPU_INPUT_ARGUMENTS", 0, (const void *)&input_arguments, sizeof(input_arguments)));
         // Copy input arrays
         i = 0;
         DPU_FOREACH (dpu_set, dpu) {
             DPU_ASSERT(dpu_copy_to(dpu, DPU_MRAM_HEAP_POINTER_NAME, 0, bufferA + input_size_dpu * i, input_size_dpu * sizeof(T)));
-#ifdef COARSECOARSE
-            DPU_ASSERT(dpu_copy_to(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), bufferB + input_size_dpu * i, input_size_dpu * sizeof(T)));
-#endif
+            if(kernel == kernel1)
+                DPU_ASSERT(dpu_copy_to(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), bufferB + input_size_dpu * i, input_size_dpu * sizeof(T)));
             i++;
         }
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
             stop(&timer, 1);
 
-        printf("Run program on DPU(s) \n");
+        if(!p->csv)
+            printf("Run program on DPU(s) \n");
         // Run DPU kernel
-        if(rep >= p.n_warmup)
-            start(&timer, 2, rep - p.n_warmup);
+        if(rep >= p->n_warmup)
+            start(&timer, 2, rep - p->n_warmup);
         DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
             stop(&timer, 2);
 
 #if PRINT
@@ -129,9 +124,10 @@ int main(int argc, char **argv) {
         }
 #endif
 
-        printf("Retrieve results\n");
-        if(rep >= p.n_warmup)
-            start(&timer, 3, rep - p.n_warmup);
+        if(!p->csv)
+            printf("Retrieve results\n");
+        if(rep >= p->n_warmup)
+            start(&timer, 3, rep - p->n_warmup);
         dpu_results_t results[nr_of_dpus];
         i = 0;
         DPU_FOREACH (dpu_set, dpu) {
@@ -141,7 +137,7 @@ int main(int argc, char **argv) {
 #if PERF
             results[i].cycles = 0;
             // Retrieve tasklet timings
-            for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
+            for (unsigned int each_tasklet = 0; each_tasklet < nr_tasklets; each_tasklet++) {
                 dpu_results_t result;
                 result.cycles = 0;
                 DPU_ASSERT(dpu_copy_from(dpu, "DPU_RESULTS", each_tasklet * sizeof(dpu_results_t), &result, sizeof(dpu_results_t)));
@@ -151,14 +147,14 @@ int main(int argc, char **argv) {
 #endif
             i++;
         }
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
             stop(&timer, 3);
 
 #if PERF
         uint64_t max_cycles = 0;
         uint64_t min_cycles = 0xFFFFFFFFFFFFFFFF;
         // Print performance results
-        if(rep >= p.n_warmup){
+        if(rep >= p->n_warmup){
             i = 0;
             DPU_FOREACH(dpu_set, dpu) {
                 if(results[i].cycles > max_cycles)
@@ -173,17 +169,6 @@ int main(int argc, char **argv) {
 #endif
 
     }
-    printf("DPU cycles  = %g cc\n", cc / p.n_reps);
-
-    // Print timing results
-    printf("CPU ");
-    print(&timer, 0, p.n_reps);
-    printf("CPU-DPU ");
-    print(&timer, 1, p.n_reps);
-    printf("DPU Kernel ");
-    print(&timer, 2, p.n_reps);
-    printf("DPU-CPU ");
-    print(&timer, 3, p.n_reps);
 
     // Check output
     bool status = true;
@@ -195,12 +180,77 @@ int main(int argc, char **argv) {
 #endif
         }
     }
+
+    if(p->csv) {
+        printf("%u,%u,%s,%u,%u,%g,%f,%f,%f,%s\n", nr_tasklets, bl, kernel_names[kernel], stride, input_size, cc / p->n_reps,
+            timer.time[1] / (1000 * p->n_reps), timer.time[2] / (1000 * p->n_reps), timer.time[3] / (1000 * p->n_reps),
+            status ? "OK" : "ERROR");
+        return status;
+    }
+
+    printf("DPU cycles  = %g cc\n", cc / p->n_reps);
+
+    // Print timing results
+    printf("CPU ");
+    print(&timer, 0, p->n_reps);
+    printf("CPU-DPU ");
+    print(&timer, 1, p->n_reps);
+    printf("DPU Kernel ");
+    print(&timer, 2, p->n_reps);
+    printf("DPU-CPU ");
+    print(&timer, 3, p->n_reps);
+
     if (status) {
         printf("[" ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "] Outputs are equal\n");
     } else {
         printf("[" ANSI_COLOR_RED "ERROR" ANSI_COLOR_RESET "] Outputs differ!\n");
     }
 
+    return status;
+}
+
+// Main of the Host Application
+int main(int argc, char **argv) {
+
+    struct Params p = input_params(argc, argv);
+
+    struct dpu_set_t dpu_set;
+    uint32_t nr_of_dpus;
+    
+    // Allocate DPUs
+    DPU_ASSERT(dpu_alloc(NR_DPUS, NULL, &dpu_set));
+    DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
+    if(!p.csv)
+        printf("Allocated %d DPU(s)\n", nr_of_dpus);
+
+    const unsigned int input_size = p.exp == 0 ? p.input_size * nr_of_dpus : p.input_size;
+
+    // Input/output allocation
+    A = malloc(input_size * sizeof(T));
+    B = malloc(input_size * sizeof(T));
+    C = malloc(input_size * sizeof(T));
+
+    // Create an input file with arbitrary data
+    read_input(A, input_size, !p.csv);
+
+    if(p.csv)
+        printf("tasklets,bl,op,stride,input_size,cycles,cpu_dpu_ms,kernel_ms,dpu_cpu_ms,status\n");
+
+    // Sweep: one binary per # of tasklets, the rest of the parameters at run time
+    bool status = true;
+    for(unsigned int t = 0; t < p.nr_tasklets; t++) {
+        char binary[64];
+        snprintf(binary, sizeof(binary), DPU_BINARY, p.tasklets[t]);
+        DPU_ASSERT(dpu_load(dpu_set, binary, NULL));
+        for(unsigned int b = 0; b < p.nr_bl; b++)
+            for(unsigned int o = 0; o < p.nr_ops; o++) {
+                if(p.ops[o] == kernel2 && b > 0)
+                    continue; // FINEFINE does not depend on the block size
+                for(unsigned int s = 0; s < p.nr_strides; s++)
+                    status &= run_config(dpu_set, nr_of_dpus, &p, input_size, p.tasklets[t], p.stride[s], p.bl[b], p.ops[o]);
+            }
+    }
+
     // Deallocation
     free(A);
     free(B);
@@ -1,20 +1,8 @@
 #!/bin/bash
 
-for i in COARSECOARSE FINEFINE
-do
-	for j in 1 
-	do 	
-        for k in 1 2 4 8 16
-        do 	
-            for l in 1 2 4 8 16 32 64 128 256 512 1024 2048 4096
-            do 	
-                NR_DPUS=$j NR_TASKLETS=$k BL=10 OP=$i make all
-                wait
-                ./bin/host_code -w 0 -e 1 -i 2097152 -s ${l} >& profile/${i}_${j}_tl${k}_s${l}.txt
-                wait
-                make clean
-                wait
-            done
-        done
-	done
-done
+# One build, then all access patterns, # of tasklets and strides in a single run
+NR_DPUS=1 BL=10 SWEEP_TASKLETS="1 2 4 8 16" make sweep
+wait
+./bin/host_code -w 0 -e 1 -i 2097152 -t 1,2,4,8,16 -b 10 -o COARSECOARSE,FINEFINE -s 1,2,4,8,16,32,64,128,256,512,1024,2048,4096 -c > profile/strided_1.csv
+wait
+make clean
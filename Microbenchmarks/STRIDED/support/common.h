@@ -5,17 +5,22 @@
 typedef struct {
     uint32_t size;
     uint32_t stride;
+    uint32_t block_size_log2; // Transfer size between MRAM and WRAM
 	enum kernels {
-	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel1 = 0, // Coarse-grained DMA, fine-grained WRAM accesses
+	    kernel2 = 1, // Fine-grained DMA
+	    nr_kernels = 2,
 	} kernel;
 } dpu_arguments_t;
 
+// Names of the kernels (-o)
+#define KERNEL_NAMES {"COARSECOARSE", "FINEFINE"}
+
 typedef struct {
     uint64_t cycles;
 } dpu_results_t;
 
-// Transfer size between MRAM and WRAM
+// Transfer size between MRAM and WRAM (default of -b)
 #ifdef BL
 #define BLOCK_SIZE_LOG2 BL
 #define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
@@ -24,6 +29,8 @@ typedef struct {
 #define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
 #define BL BLOCK_SIZE_LOG2
 #endif
+#define MIN_BLOCK_SIZE_LOG2 3
+#define MAX_BLOCK_SIZE_LOG2 11
 
 // Data type
 #define T uint64_t
@@ -17,10 +17,10 @@ __host dpu_arguments_t DPU_INPUT_ARGUMENTS;
 __host dpu_results_t DPU_RESULTS[NR_TASKLETS];
 
 // Copy
-static void copy_pattern_dpu(T *bufferC, T *bufferB, uint32_t *bufferA) {
+static void copy_pattern_dpu(T *bufferC, T *bufferB, uint32_t *bufferA, uint32_t block_size) {
 
     #pragma unroll
-    for (unsigned int i = 0; i < (BLOCK_SIZE >> DIV); i++){
+    for (unsigned int i = 0; i < (block_size >> DIV); i++){
 		
         uint32_t address = bufferA[i];
         bufferC[address] = bufferB[address];
@@ -53,59 +53,60 @@ int main_kernel1() {
         perfcounter_config(COUNT_CYCLES, true);
     }
     perfcounter_cycles cycles;
+    const uint32_t wram = DPU_INPUT_ARGUMENTS.wram;
     // Barrier
     barrier_wait(&my_barrier);
-#ifndef WRAM
-    timer_start(&cycles); // START TIMER
-#endif
+    if(!wram)
+        timer_start(&cycles); // START TIMER
 
     uint32_t input_size_dpu = DPU_INPUT_ARGUMENTS.size;
+    uint32_t block_size_log2 = DPU_INPUT_ARGUMENTS.block_size_log2;
+    uint32_t block_size = 1 << block_size_log2;
 
     dpu_results_t *result = &DPU_RESULTS[tasklet_id];
     result->cycles = 0;
 
-    const uint32_t A_SIZE = (BLOCK_SIZE >> DIV) << 2;
+    const uint32_t A_SIZE = (block_size >> DIV) << 2;
     // Address of the current processing block in MRAM
     uint32_t mram_base_addr_A = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id * A_SIZE));
-    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << BLOCK_SIZE_LOG2) + input_size_dpu * sizeof(uint32_t));
-    uint32_t mram_base_addr_C = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << BLOCK_SIZE_LOG2) + input_size_dpu * (sizeof(uint32_t) + sizeof(T)));
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2) + input_size_dpu * sizeof(uint32_t));
+    uint32_t mram_base_addr_C = (uint32_t)(DPU_MRAM_HEAP_POINTER + (tasklet_id << block_size_log2) + input_size_dpu * (sizeof(uint32_t) + sizeof(T)));
 
     // Initialize a local cache to store the MRAM block
     uint32_t *cache_A = (uint32_t *) mem_alloc(A_SIZE);
-    T *cache_B = (T *) mem_alloc(BLOCK_SIZE);
-    T *cache_C = (T *) mem_alloc(BLOCK_SIZE);
+    T *cache_B = (T *) mem_alloc(block_size);
+    T *cache_C = (T *) mem_alloc(block_size);
 
     uint32_t A_byte_index = 0; 
-    for(unsigned int byte_index = 0; byte_index < (input_size_dpu << DIV); byte_index += BLOCK_SIZE * NR_TASKLETS){
+    for(unsigned int byte_index = 0; byte_index < (input_size_dpu << DIV); byte_index += block_size * NR_TASKLETS){
 
         // Load cache with current MRAM block
         mram_read((__mram_ptr void const*)(mram_base_addr_A + A_byte_index), cache_A, A_SIZE);
-        mram_read((__mram_ptr void const*)(mram_base_addr_B + byte_index), cache_B, BLOCK_SIZE);
-        mram_read((__mram_ptr void const*)(mram_base_addr_C + byte_index), cache_C, BLOCK_SIZE); // Clean cache_C
+        mram_read((__mram_ptr void const*)(mram_base_addr_B + byte_index), cache_B, block_size);
+        mram_read((__mram_ptr void const*)(mram_base_addr_C + byte_index), cache_C, block_size); // Clean cache_C
 
-#ifdef WRAM
-        // Barrier
-        barrier_wait(&my_barrier);
-        timer_start(&cycles); // START TIMER
-#endif
+        if(wram){
+            // Barrier
+            barrier_wait(&my_barrier);
+            timer_start(&cycles); // START TIMER
+        }
 
         // Copy
-        copy_pattern_dpu(cache_C, cache_B, cache_A);
+        copy_pattern_dpu(cache_C, cache_B, cache_A, block_size);
 
-#ifdef WRAM
-        result->cycles += timer_stop(&cycles); // STOP TIMER
-        // Barrier
-        barrier_wait(&my_barrier);
-#endif
+        if(wram){
+            result->cycles += timer_stop(&cycles); // STOP TIMER
+            // Barrier
+            barrier_wait(&my_barrier);
+        }
 
         // Write cache to current MRAM block
-        mram_write(cache_C, (__mram_ptr void*)(mram_base_addr_C + byte_index), BLOCK_SIZE);
+        mram_write(cache_C, (__mram_ptr void*)(mram_base_addr_C + byte_index), block_size);
 
         A_byte_index += A_SIZE * NR_TASKLETS;
     }
 
-#ifndef WRAM
-    result->cycles = timer_stop(&cycles); // STOP TIMER
-#endif
+    if(!wram)
+        result->cycles = timer_stop(&cycles); // STOP TIMER
     return 0;
 }
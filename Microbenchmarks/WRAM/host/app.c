@@ -17,9 +17,9 @@
 #include "../support/timer.h"
 #include "../support/params.h"
 
-// Define the DPU Binary path as DPU_BINARY here
+// Define the DPU Binary path as DPU_BINARY here, one binary per # of tasklets
 #ifndef DPU_BINARY
-#define DPU_BINARY "./bin/dpu_code"
+#define DPU_BINARY "./bin/dpu_code_tl%u"
 #endif
 
 // Pointer declaration
@@ -29,29 +29,30 @@ static T* C;
 static T* C2;
 
 // Create input arrays
-#ifdef strided
-static void read_input(unsigned int* A, T* B, unsigned int nr_elements, unsigned int stride) {
-#else
-static void read_input(unsigned int* A, T* B, unsigned int nr_elements) {
-#endif
+static void read_input(T* B, unsigned int nr_elements, bool verbose) {
     srand(0);
-    printf("nr_elements\t%u\t", nr_elements);
+    if(verbose)
+        printf("nr_elements\t%u\t", nr_elements);
     for (unsigned int i = 0; i < nr_elements; i++) {
-#ifdef streaming
-        A[i] = i % (BLOCK_SIZE >> DIV);
-#elif strided
-        A[i] = ((i>0 ? A[i-1]:0) + stride) % (BLOCK_SIZE >> DIV);
-#else
-        A[i] = ((unsigned int)rand()) % (BLOCK_SIZE >> DIV);
-#endif
         B[i] = (T)(rand());
-        C[i] = 0;
+    }
+}
+
+// Create the indices of the access pattern within each block
+static void create_pattern(unsigned int* A, unsigned int nr_elements, unsigned int pattern, unsigned int wram_size, unsigned int stride) {
+    srand(0);
+    for (unsigned int i = 0; i < nr_elements; i++) {
+        if(pattern == 0) // streaming
+            A[i] = i % wram_size;
+        else if(pattern == 1) // strided
+            A[i] = ((i>0 ? A[i-1]:0) + stride) % wram_size;
+        else // random
+            A[i] = ((unsigned int)rand()) % wram_size;
     }
 }
 
 // Compute output in the host
-static void copy_host(T* C, T* B, unsigned int* A, unsigned int nr_elements) {
-    unsigned int wram_size = BLOCK_SIZE >> DIV;
+static void copy_host(T* C, T* B, unsigned int* A, unsigned int nr_elements, unsigned int wram_size) {
     for (unsigned int i = 0; i < nr_elements / wram_size; i++) {
         for (unsigned int j = 0; j < wram_size; j++) {
             unsigned int address = A[i * wram_size + j];
@@ -60,63 +61,50 @@ static void copy_host(T* C, T* B, unsigned int* A, unsigned int nr_elements) {
     }
 }
 
-// Main of the Host Application
-int main(int argc, char **argv) {
-
-    struct Params p = input_params(argc, argv);
-
-    struct dpu_set_t dpu_set, dpu;
-    uint32_t nr_of_dpus;
-    
-    // Allocate DPUs and load binary
-    DPU_ASSERT(dpu_alloc(NR_DPUS, NULL, &dpu_set));
-    DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-    DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-    printf("Allocated %d DPU(s)\n", nr_of_dpus);
+// Run one configuration on the loaded binary: the block size and the timed memory are input arguments
+static bool run_config(struct dpu_set_t dpu_set, uint32_t nr_of_dpus, struct Params *p, unsigned int input_size,
+    unsigned int nr_tasklets, unsigned int bl, unsigned int pattern, unsigned int stride, unsigned int wram) {
 
+    struct dpu_set_t dpu;
     unsigned int i = 0;
     double cc = 0;
     double cc_min = 0;
-    const unsigned int input_size = p.exp == 0 ? p.input_size * nr_of_dpus : p.input_size;
-
-    // Input/output allocation
-    A = malloc(input_size * sizeof(unsigned int));
+    const unsigned int input_size_dpu = input_size / nr_of_dpus;
+    assert((input_size_dpu << DIV) % (nr_tasklets << bl) == 0 && "Input size!");
     unsigned int *bufferA = A;
-    B = malloc(input_size * sizeof(T));
     T *bufferB = B;
-    C = malloc(input_size * sizeof(T));
     T *bufferC = C;
-    C2 = malloc(input_size * sizeof(T));
-
-    // Create an input file with arbitrary data
-#ifdef strided
-    read_input(A, B, input_size, p.stride);
-#else
-    read_input(A, B, input_size);
-#endif
+    const unsigned int wram_size = (1 << bl) >> DIV;
+    static const char *const pattern_names[3] = PATTERN_NAMES;
+    static const char *const mem_names[2] = MEM_NAMES;
 
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\n", NR_TASKLETS, BL);
+    if(!p->csv)
+        printf("NR_TASKLETS\t%d\tBL\t%d\tOP\t%s\tSTRIDE\t%u\tMEM\t%s\n", nr_tasklets, bl, pattern_names[pattern], stride, mem_names[wram]);
+
+    // Indices of this pattern, and a clean output
+    create_pattern(A, input_size, pattern, wram_size, stride);
+    memset(C, 0, input_size * sizeof(T));
+    memset(C2, 0, input_size * sizeof(T));
 
     // Loop over main kernel
-    for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
+    for(int rep = 0; rep < p->n_warmup + p->n_reps; rep++) {
 
         // Compute output on CPU (performance comparison and verification purposes)
-        if(rep >= p.n_warmup)
-            start(&timer, 0, rep - p.n_warmup);
-        copy_host(C2, B, A, input_size);
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
+            start(&timer, 0, rep - p->n_warmup);
+        copy_host(C2, B, A, input_size, wram_size);
+        if(rep >= p->n_warmup)
             stop(&timer, 0);
 
-        printf("Load input data\n");
-        if(rep >= p.n_warmup)
-            start(&timer, 1, rep - p.n_warmup);
+        if(!p->csv)
+            printf("Load input data\n");
+        if(rep >= p->n_warmup)
+            start(&timer, 1, rep - p->n_warmup);
         // Input arguments
-        const unsigned int input_size_dpu = input_size / nr_of_dpus;
-        unsigned int kernel = 0;
-        dpu_arguments_t input_arguments = {input_size_dpu, kernel};
+        dpu_arguments_t input_arguments = {input_size_dpu, bl, wram, kernel1};
         DPU_ASSERT(dpu_copy_to(dpu_set, "DPU_INPUT_ARGUMENTS", 0, (const void *)&input_arguments, sizeof(input_arguments)));
         // Copy input arrays
         i = 0;
@@ -126,15 +114,16 @@ int main(int argc, char **argv) {
             DPU_ASSERT(dpu_copy_to(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * (sizeof(unsigned int) + sizeof(T)), bufferC + input_size_dpu * i, input_size_dpu * sizeof(T)));
             i++;
         }
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
             stop(&timer, 1);
 
-        printf("Run program on DPU(s) \n");
+        if(!p->csv)
+            printf("Run program on DPU(s) \n");
         // Run DPU kernel
-        if(rep >= p.n_warmup)
-            start(&timer, 2, rep - p.n_warmup);
+        if(rep >= p->n_warmup)
+            start(&timer, 2, rep - p->n_warmup);
         DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
             stop(&timer, 2);
 
 #if PRINT
@@ -149,9 +138,10 @@ int main(int argc, char **argv) {
         }
 #endif
 
-        printf("Retrieve results\n");
-        if(rep >= p.n_warmup)
-            start(&timer, 3, rep - p.n_warmup);
+        if(!p->csv)
+            printf("Retrieve results\n");
+        if(rep >= p->n_warmup)
+            start(&timer, 3, rep - p->n_warmup);
         dpu_results_t results[nr_of_dpus];
         i = 0;
         DPU_FOREACH (dpu_set, dpu) {
@@ -161,7 +151,7 @@ int main(int argc, char **argv) {
 #if PERF
             results[i].cycles = 0;
             // Retrieve tasklet timings
-            for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
+            for (unsigned int each_tasklet = 0; each_tasklet < nr_tasklets; each_tasklet++) {
                 dpu_results_t result;
                 result.cycles = 0;
                 DPU_ASSERT(dpu_copy_from(dpu, "DPU_RESULTS", each_tasklet * sizeof(dpu_results_t), &result, sizeof(dpu_results_t)));
@@ -171,14 +161,14 @@ int main(int argc, char **argv) {
 #endif
             i++;
         }
-        if(rep >= p.n_warmup)
+        if(rep >= p->n_warmup)
             stop(&timer, 3);
 
 #if PERF
         uint64_t max_cycles = 0;
         uint64_t min_cycles = 0xFFFFFFFFFFFFFFFF;
         // Print performance results
-        if(rep >= p.n_warmup){
+        if(rep >= p->n_warmup){
             i = 0;
             DPU_FOREACH(dpu_set, dpu) {
                 if(results[i].cycles > max_cycles)
@@ -193,17 +183,6 @@ int main(int argc, char **argv) {
 #endif
 
     }
-    printf("DPU cycles  = %g cc\n", cc / p.n_reps);
-
-    // Print timing results
-    printf("CPU ");
-    print(&timer, 0, p.n_reps);
-    printf("CPU-DPU ");
-    print(&timer, 1, p.n_reps);
-    printf("DPU Kernel ");
-    print(&timer, 2, p.n_reps);
-    printf("DPU-CPU ");
-    print(&timer, 3, p.n_reps);
 
     // Check output
     bool status = true;
@@ -215,12 +194,81 @@ int main(int argc, char **argv) {
 #endif
         }
     }
+
+    if(p->csv) {
+        printf("%u,%u,%s,%u,%s,%u,%g,%f,%f,%f,%s\n", nr_tasklets, bl, pattern_names[pattern], stride, mem_names[wram], input_size, cc / p->n_reps,
+            timer.time[1] / (1000 * p->n_reps), timer.time[2] / (1000 * p->n_reps), timer.time[3] / (1000 * p->n_reps),
+            status ? "OK" : "ERROR");
+        return status;
+    }
+
+    printf("DPU cycles  = %g cc\n", cc / p->n_reps);
+
+    // Print timing results
+    printf("CPU ");
+    print(&timer, 0, p->n_reps);
+    printf("CPU-DPU ");
+    print(&timer, 1, p->n_reps);
+    printf("DPU Kernel ");
+    print(&timer, 2, p->n_reps);
+    printf("DPU-CPU ");
+    print(&timer, 3, p->n_reps);
+
     if (status) {
         printf("[" ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "] Outputs are equal\n");
     } else {
         printf("[" ANSI_COLOR_RED "ERROR" ANSI_COLOR_RESET "] Outputs differ!\n");
     }
 
+    return status;
+}
+
+// Main of the Host Application
+int main(int argc, char **argv) {
+
+    struct Params p = input_params(argc, argv);
+
+    struct dpu_set_t dpu_set;
+    uint32_t nr_of_dpus;
+    
+    // Allocate DPUs
+    DPU_ASSERT(dpu_alloc(NR_DPUS, NULL, &dpu_set));
+    DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
+    if(!p.csv)
+        printf("Allocated %d DPU(s)\n", nr_of_dpus);
+
+    const unsigned int input_size = p.exp == 0 ? p.input_size * nr_of_dpus : p.input_size;
+
+    // Input/output allocation
+    A = malloc(input_size * sizeof(unsigned int));
+    B = malloc(input_size * sizeof(T));
+    C = malloc(input_size * sizeof(T));
+    C2 = malloc(input_size * sizeof(T));
+
+    // Create an input file with arbitrary data
+    read_input(B, input_size, !p.csv);
+
+    if(p.csv)
+        printf("tasklets,bl,op,stride,mem,input_size,cycles,cpu_dpu_ms,kernel_ms,dpu_cpu_ms,status\n");
+
+    // Sweep: one binary per # of tasklets, the rest of the parameters at run time
+    bool status = true;
+    for(unsigned int t = 0; t < p.nr_tasklets; t++) {
+        char binary[64];
+        snprintf(binary, sizeof(binary), DPU_BINARY, p.tasklets[t]);
+        DPU_ASSERT(dpu_load(dpu_set, binary, NULL));
+        for(unsigned int b = 0; b < p.nr_bl; b++) {
+            if(p.tasklets[t] * ((((1u << p.bl[b]) >> DIV) << 2) + (2u << p.bl[b])) > WRAM_BUDGET) {
+                fprintf(stderr, "Skipping %u tasklets with BL %u: caches do not fit in WRAM\n", p.tasklets[t], p.bl[b]);
+                continue;
+            }
+            for(unsigned int o = 0; o < p.nr_ops; o++)
+                for(unsigned int s = 0; s < (p.ops[o] == 1 ? p.nr_strides : 1); s++) // Only strided uses the stride
+                    for(unsigned int m = 0; m < p.nr_mems; m++)
+                        status &= run_config(dpu_set, nr_of_dpus, &p, input_size, p.tasklets[t], p.bl[b], p.ops[o], p.stride[s], p.mems[m]);
+        }
+    }
+
     // Deallocation
     free(A);
     free(B);
@@ -1,37 +1,8 @@
 #!/bin/bash
 
-# WRAM
-for i in streaming random
-do
-	for j in 1 
-	do 	
-        for k in 1 2 4 8 16  
-        do 	
-            NR_DPUS=$j NR_TASKLETS=$k BL=10 MEM=WRAM OP=$i make all
-            wait
-            ./bin/host_code -w 0 -e 1 -i 2097152 >& profile/${i}_${j}_tl${k}_s1_WRAM.txt
-            wait
-            make clean
-            wait
-        done
-	done
-done
-
-for i in strided 
-do
-	for j in 1 
-	do 	
-        for k in 1 2 4 8 16  
-        do 	
-            for l in 1 2 4 8 16 32 64
-            do 	
-                NR_DPUS=$j NR_TASKLETS=$k BL=10 MEM=WRAM OP=$i make all
-                wait
-                ./bin/host_code -w 0 -e 1 -i 2097152 -s ${l} >& profile/${i}_${j}_tl${k}_s${l}_WRAM.txt
-                wait
-                make clean
-                wait
-	        done
-        done
-	done
-done
+# One build, then all access patterns, # of tasklets and strides in a single run
+NR_DPUS=1 BL=10 SWEEP_TASKLETS="1 2 4 8 16" make sweep
+wait
+./bin/host_code -w 0 -e 1 -i 2097152 -t 1,2,4,8,16 -b 10 -o streaming,strided,random -s 1,2,4,8,16,32,64 -m WRAM -c > profile/wram_1.csv
+wait
+make clean
@@ -4,17 +4,23 @@
 // Structures used by both the host and the dpu to communicate information 
 typedef struct {
     uint32_t size;
+    uint32_t block_size_log2; // Transfer size between MRAM and WRAM
+    uint32_t wram; // Time only the accesses to WRAM blocks
 	enum kernels {
 	    kernel1 = 0,
 	    nr_kernels = 1,
 	} kernel;
 } dpu_arguments_t;
 
+// Access patterns generated by the host (-o) and timed memories (-m)
+#define PATTERN_NAMES {"streaming", "strided", "random"}
+#define MEM_NAMES {"MRAM", "WRAM"}
+
 typedef struct {
     uint64_t cycles;
 } dpu_results_t;
 
-// Transfer size between MRAM and WRAM
+// Transfer size between MRAM and WRAM (default of -b)
 #ifdef BL
 #define BLOCK_SIZE_LOG2 BL
 #define BLOCK_SIZE (1 << BLOCK_SIZE_LOG2)
@@ -32,6 +38,10 @@ typedef struct {
 #define T int64_t
 #define DIV 3 // Shift right to divide by sizeof(T)
 #endif
+#define MIN_BLOCK_SIZE_LOG2 (DIV + 1) // Block of indices of at least 8 bytes
+#define MAX_BLOCK_SIZE_LOG2 11
+// WRAM left for the caches of all tasklets
+#define WRAM_BUDGET (48 << 10)
 
 #define PERF 1 // Use perfcounters?
 #define PRINT 0
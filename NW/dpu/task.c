@@ -17,8 +17,238 @@ __host dpu_arguments_t DPU_INPUT_ARGUMENTS;
 // Barrier
 BARRIER_INIT(my_barrier, NR_TASKLETS);
 
-// main
-int main() {
+extern int main_kernel1(void);
+extern int main_kernel2(void);
+extern int main_kernel3(void);
+extern int main_kernel4(void);
+
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2, main_kernel3, main_kernel4};
+
+int main(void) { 
+    // Kernel
+    return kernels[DPU_INPUT_ARGUMENTS.kernel](); 
+}
+
+// MRAM-WRAM transfers larger than 2048 bytes
+static void mram_read_large(uint32_t addr, void *cache, uint32_t bytes) {
+    for (uint32_t done = 0; done < bytes; done += 2048) {
+        uint32_t transfer = (bytes - done > 2048) ? 2048 : bytes - done;
+        mram_read((__mram_ptr void const *) (addr + done), (void *) ((uint8_t *) cache + done), transfer);
+    }
+}
+
+static void mram_write_large(void *cache, uint32_t addr, uint32_t bytes) {
+    for (uint32_t done = 0; done < bytes; done += 2048) {
+        uint32_t transfer = (bytes - done > 2048) ? 2048 : bytes - done;
+        mram_write((void *) ((uint8_t *) cache + done), (__mram_ptr void *) (addr + done), transfer);
+    }
+}
+
+// CIGAR entries are merged in WRAM and flushed to MRAM two at a time
+typedef struct {
+    uint32_t *cache;
+    uint32_t addr;
+    uint32_t n_ops;
+} cigar_writer_t;
+
+static void cigar_emit(cigar_writer_t *writer, uint32_t op, uint32_t length) {
+    if (length == 0)
+        return;
+    if (writer->n_ops > 0 && (writer->cache[(writer->n_ops - 1) & 1] & 3) == op) {
+        writer->cache[(writer->n_ops - 1) & 1] += (length << 2);
+        return;
+    }
+    if (writer->n_ops > 0 && (writer->n_ops & 1) == 0) // Previous two entries are final
+        mram_write(writer->cache, (__mram_ptr void *) (writer->addr + (writer->n_ops - 2) * sizeof(uint32_t)), 2 * sizeof(uint32_t));
+    writer->cache[writer->n_ops & 1] = (length << 2) | op;
+    writer->n_ops++;
+}
+
+static void cigar_flush(cigar_writer_t *writer) {
+    if (writer->n_ops > 0)
+        mram_write(writer->cache, (__mram_ptr void *) (writer->addr + ((writer->n_ops - 1) & ~1) * sizeof(uint32_t)), 2 * sizeof(uint32_t));
+}
+
+// Last row of the alignment of a[0..len_a) and b[0..len_b), or of both reversed sequences
+static void nw_last_row(int32_t *row, uint8_t *a, uint32_t len_a, uint8_t *b, uint32_t len_b, int32_t penalty, int reverse) {
+    int step = reverse ? -1 : 1;
+    uint8_t *a_ptr = reverse ? a + len_a - 1 : a;
+    for (uint32_t j = 0; j <= len_b; j++)
+        row[j] = -(int32_t) j * penalty;
+    for (uint32_t i = 1; i <= len_a; i++, a_ptr += step) {
+        int *ref = blosum62[*a_ptr];
+        uint8_t *b_ptr = reverse ? b + len_b - 1 : b;
+        int32_t diag = row[0];
+        row[0] = -(int32_t) i * penalty;
+        for (uint32_t j = 1; j <= len_b; j++, b_ptr += step) {
+            int32_t up = row[j];
+            row[j] = maximum(diag + ref[*b_ptr], row[j - 1] - penalty, up - penalty);
+            diag = up;
+        }
+    }
+}
+
+typedef struct {
+    uint32_t a0;
+    uint32_t len_a;
+    uint32_t b0;
+    uint32_t len_b;
+} subproblem_t;
+
+// Linear-space traceback (Hirschberg). The right half of each split is solved first,
+// so that CIGAR entries come out from the last cell, as in the full traceback
+static int32_t hirschberg(cigar_writer_t *writer, subproblem_t *stack, int32_t *forward, int32_t *backward,
+                          uint8_t *seq_a, uint32_t len_a, uint8_t *seq_b, uint32_t len_b, int32_t penalty) {
+    int32_t score = 0;
+    uint32_t top = 0;
+    stack[top++] = (subproblem_t) {0, len_a, 0, len_b};
+    for (uint32_t iter = 0; top > 0; iter++) {
+        subproblem_t sub = stack[--top];
+        uint8_t *a = seq_a + sub.a0;
+        uint8_t *b = seq_b + sub.b0;
+        int32_t sub_score;
+        if (sub.len_a == 0) {
+            cigar_emit(writer, CIGAR_I, sub.len_b);
+            sub_score = -(int32_t) sub.len_b * penalty;
+        } else if (sub.len_b == 0) {
+            cigar_emit(writer, CIGAR_D, sub.len_a);
+            sub_score = -(int32_t) sub.len_a * penalty;
+        } else if (sub.len_a == 1) {
+            // Align the single element of a to its best element of b, or to a gap
+            int *ref = blosum62[a[0]];
+            uint32_t k_best = 0;
+            for (uint32_t k = 1; k < sub.len_b; k++)
+                if (ref[b[k]] > ref[b[k_best]])
+                    k_best = k;
+            sub_score = ref[b[k_best]] - (int32_t) (sub.len_b - 1) * penalty;
+            if (sub_score >= -(int32_t) (sub.len_b + 1) * penalty) {
+                cigar_emit(writer, CIGAR_I, sub.len_b - 1 - k_best);
+                cigar_emit(writer, CIGAR_M, 1);
+                cigar_emit(writer, CIGAR_I, k_best);
+            } else {
+                cigar_emit(writer, CIGAR_I, sub.len_b);
+                cigar_emit(writer, CIGAR_D, 1);
+                sub_score = -(int32_t) (sub.len_b + 1) * penalty;
+            }
+        } else {
+            // Split a in halves, and b where forward + backward scores are maximum
+            uint32_t mid = sub.len_a / 2;
+            nw_last_row(forward, a, mid, b, sub.len_b, penalty, 0);
+            nw_last_row(backward, a + mid, sub.len_a - mid, b, sub.len_b, penalty, 1);
+            uint32_t k_best = 0;
+            sub_score = forward[0] + backward[sub.len_b];
+            for (uint32_t k = 1; k <= sub.len_b; k++) {
+                if (forward[k] + backward[sub.len_b - k] > sub_score) {
+                    sub_score = forward[k] + backward[sub.len_b - k];
+                    k_best = k;
+                }
+            }
+            stack[top++] = (subproblem_t) {sub.a0, mid, sub.b0, k_best};
+            stack[top++] = (subproblem_t) {sub.a0 + mid, sub.len_a - mid, sub.b0 + k_best, sub.len_b - k_best};
+        }
+        if (iter == 0)
+            score = sub_score;
+    }
+    cigar_flush(writer);
+    return score;
+}
+
+// Per-tasklet maximum of the local alignment kernel
+nw_max_t tasklet_max[NR_TASKLETS];
+
+// Sub-block computation of the linear-gap global kernel
+static void sub_block_linear(int32_t *cache_input, int32_t *cache_ref, int32_t penalty) {
+    for (uint32_t i = 1; i < BL_IN + 1; i++) {
+        for (uint32_t j = 1; j < BL_IN + 1; j++) {
+            cache_input[i*(BL_IN+2) + j] = maximum(cache_input[(i-1)*(BL_IN+2) + j - 1] + cache_ref[(i-1)*BL_IN + j-1],
+                                    cache_input[i*(BL_IN+2) + j - 1] - penalty,
+                                    cache_input[(i-1)*(BL_IN+2) + j] - penalty);
+        }
+    }
+}
+
+// Sub-block computation of the affine-gap global kernel (Gotoh). Each cell holds {H, E, F}
+static void sub_block_affine(int32_t *cache_input, int32_t *cache_ref, int32_t gap_open, int32_t gap_extend) {
+    for (uint32_t i = 1; i < BL_IN + 1; i++) {
+        for (uint32_t j = 1; j < BL_IN + 1; j++) {
+            int32_t *cell = cache_input + (i*(BL_IN+2) + j) * AFFINE_CELL;
+            int32_t *w = cell - AFFINE_CELL;
+            int32_t *n = cell - (BL_IN+2) * AFFINE_CELL;
+            int32_t *nw = n - AFFINE_CELL;
+            int32_t e = w[1] - gap_extend;
+            if (w[0] - gap_open - gap_extend > e)
+                e = w[0] - gap_open - gap_extend;
+            int32_t f = n[2] - gap_extend;
+            if (n[0] - gap_open - gap_extend > f)
+                f = n[0] - gap_open - gap_extend;
+            cell[0] = maximum(nw[0] + cache_ref[(i-1)*BL_IN + j-1], e, f);
+            cell[1] = e;
+            cell[2] = f;
+        }
+    }
+}
+
+// Sub-block computation of the local kernel (Smith-Waterman), keeping track of the maximum score
+static void sub_block_local(int32_t *cache_input, int32_t *cache_ref, int32_t penalty, nw_max_t *max, uint32_t row, uint32_t col) {
+    for (uint32_t i = 1; i < BL_IN + 1; i++) {
+        for (uint32_t j = 1; j < BL_IN + 1; j++) {
+            int32_t h = maximum(cache_input[(i-1)*(BL_IN+2) + j - 1] + cache_ref[(i-1)*BL_IN + j-1],
+                                cache_input[i*(BL_IN+2) + j - 1] - penalty,
+                                cache_input[(i-1)*(BL_IN+2) + j] - penalty);
+            if (h < 0)
+                h = 0;
+            cache_input[i*(BL_IN+2) + j] = h;
+            if (h > max->score) {
+                max->score = h;
+                max->cell = (row + i) * (BL+1) + col + j;
+            }
+        }
+    }
+}
+
+// Move a sub-block from MRAM to WRAM, compute it, and move it back
+static void sub_block(enum kernels kernel, uint32_t cell, uint32_t mram_base_addr_input_itemsets, uint32_t mram_base_addr_ref,
+                      int32_t *cache_input, int32_t *cache_ref, int t_index_x, int t_index_y) {
+    // Move input from MRAM to WRAM
+    uint32_t addr_input = mram_base_addr_input_itemsets + (t_index_x * (BL+2) * BL_IN * cell * sizeof(int32_t)) + (t_index_y * BL_IN * cell * sizeof(int32_t));
+    uint32_t cache_input_offset = (BL_IN+2) * cell;
+    mram_read((__mram_ptr void const *) addr_input, (void *) cache_input, (BL_IN+2) * cell * sizeof(int32_t)); 
+    addr_input += ((BL+2) * cell * sizeof(int32_t));
+    for (int i = 1; i < BL_IN + 1; i++) {
+        mram_read((__mram_ptr void const *) addr_input, (void *) (cache_input + cache_input_offset), (2) * cell * sizeof(int32_t)); 
+        cache_input_offset += (BL_IN+2) * cell; 
+        addr_input += ((BL+2) * cell * sizeof(int32_t));
+    }
+
+    uint32_t addr_ref = mram_base_addr_ref + (t_index_x * BL * BL_IN * sizeof(int32_t)) +  (t_index_y * BL_IN * sizeof(int32_t));
+    cache_input_offset = 0;
+    for (int i = 0; i < BL_IN; i++) {
+        mram_read((__mram_ptr void const *) addr_ref, (void *) (cache_ref + cache_input_offset), (BL_IN) * sizeof(int32_t)); 
+        cache_input_offset += BL_IN; 
+        addr_ref += (BL * sizeof(int32_t));
+    }
+
+    // Computation
+    if (kernel == kernel3)
+        sub_block_affine(cache_input, cache_ref, DPU_INPUT_ARGUMENTS.gap_open, DPU_INPUT_ARGUMENTS.penalty);
+    else if (kernel == kernel4)
+        sub_block_local(cache_input, cache_ref, DPU_INPUT_ARGUMENTS.penalty, &tasklet_max[me()], t_index_x * BL_IN, t_index_y * BL_IN);
+    else
+        sub_block_linear(cache_input, cache_ref, DPU_INPUT_ARGUMENTS.penalty);
+
+    // Move output from WRAM to MRAM
+    addr_input =  mram_base_addr_input_itemsets + (t_index_x * (BL+2) * BL_IN * cell * sizeof(int32_t)) + (t_index_y * BL_IN * cell * sizeof(int32_t));
+    cache_input_offset = (BL_IN+2) * cell;
+    addr_input += ((BL+2) * cell * sizeof(int32_t));
+    for (int i = 1; i < BL_IN + 1; i++) {
+        mram_write((cache_input + cache_input_offset), (__mram_ptr void *)  addr_input, (BL_IN+2) * cell * sizeof(int32_t)); 
+        cache_input_offset += (BL_IN+2) * cell; 
+        addr_input += ((BL+2) * cell * sizeof(int32_t));
+    }
+}
+
+// Wavefront: blocks of one anti-diagonal of the large matrix, with cell int32_t per matrix cell
+static int wavefront(enum kernels kernel, uint32_t cell) {
     unsigned int tasklet_id = me();
     if (tasklet_id == 0){ // Initialize once the cycle counter
         mem_reset(); // Reset the heap
@@ -27,27 +257,31 @@ int main() {
     barrier_wait(&my_barrier);
     uint32_t nblocks = DPU_INPUT_ARGUMENTS.nblocks;
     uint32_t active_blocks = DPU_INPUT_ARGUMENTS.active_blocks;
-    uint32_t penalty = DPU_INPUT_ARGUMENTS.penalty;
 #if PRINT
     printf("tasklet_id = %d, nblocks = %d \n", tasklet_id, nblocks);
 #endif
+    // Idle DPU in this diagonal
+    if (active_blocks == 0)
+        return 0;
 	
     uint32_t mram_base_addr_input_itemsets = (uint32_t) (DPU_MRAM_HEAP_POINTER);
-    uint32_t mram_base_addr_ref = (uint32_t) (DPU_MRAM_HEAP_POINTER + nblocks * (BL+1) * (BL+2) * sizeof(int32_t));
+    uint32_t mram_base_addr_ref = (uint32_t) (DPU_MRAM_HEAP_POINTER + nblocks * (BL+1) * (BL+2) * cell * sizeof(int32_t));
     if (nblocks != active_blocks)
-        mram_base_addr_ref = (uint32_t) (DPU_MRAM_HEAP_POINTER + active_blocks * (BL+1) * (BL+2) * sizeof(int32_t));
+        mram_base_addr_ref = (uint32_t) (DPU_MRAM_HEAP_POINTER + active_blocks * (BL+1) * (BL+2) * cell * sizeof(int32_t));
+    // Local kernel: maximum of each block, after the reference blocks
+    uint32_t mram_base_addr_max = (uint32_t) (DPU_MRAM_HEAP_POINTER + active_blocks * ((BL+1) * (BL+2) * cell + BL * BL) * sizeof(int32_t));
 
-    int32_t *cache_input = mem_alloc((BL_IN+1) * (BL_IN+2) * sizeof(int32_t));
+    int32_t *cache_input = mem_alloc((BL_IN+1) * (BL_IN+2) * cell * sizeof(int32_t));
     int32_t *cache_ref = mem_alloc(BL_IN * BL_IN * sizeof(int32_t));
+    nw_max_t *block_max = mem_alloc(sizeof(nw_max_t));
     uint32_t REP = BL/BL_IN;
     uint32_t chunks;
     uint32_t mod;
     uint32_t start;
-    uint32_t addr_input;
-    uint32_t addr_ref;
-    uint32_t cache_input_offset;
 
     for (uint32_t bl = 0; bl < nblocks; bl++) {
+        tasklet_max[tasklet_id].score = 0;
+        tasklet_max[tasklet_id].cell = 0;
 
         // Top-left computation
         for(uint32_t blk = 0; blk <= REP; blk++) {
@@ -69,45 +303,7 @@ int main() {
             for (uint32_t bl_indx = 0; bl_indx < chunks; bl_indx++) {
                 int t_index_x = start + bl_indx;
                 int t_index_y = blk - 1 - t_index_x; 
-                
-                // Move input from MRAM to WRAM
-                addr_input =  mram_base_addr_input_itemsets + (t_index_x * (BL+2) * BL_IN * sizeof(int32_t)) + (t_index_y * BL_IN * sizeof(int32_t));
-                cache_input_offset = (BL_IN+2);
-                mram_read((__mram_ptr void const *) addr_input, (void *) cache_input, (BL_IN+2) * sizeof(int32_t)); 
-                addr_input += ((BL+2) * sizeof(int32_t));
-                for (int i = 1; i < BL_IN + 1; i++) {
-                    mram_read((__mram_ptr void const *) addr_input, (void *) (cache_input + cache_input_offset), (2) * sizeof(int32_t)); 
-                    cache_input_offset += (BL_IN+2); 
-                    addr_input += ((BL+2) * sizeof(int32_t));
-                }
-
-                addr_ref = mram_base_addr_ref + (t_index_x * BL * BL_IN * sizeof(int32_t)) +  (t_index_y * BL_IN * sizeof(int32_t));
-                cache_input_offset = 0;
-                for (int i = 0; i < BL_IN; i++) {
-                    mram_read((__mram_ptr void const *) addr_ref, (void *) (cache_ref + cache_input_offset), (BL_IN) * sizeof(int32_t)); 
-                    cache_input_offset += BL_IN; 
-                    addr_ref += (BL * sizeof(int32_t));
-                }
-
-                // Computation
-                for (uint32_t i = 1; i < BL_IN + 1; i++) {
-                    for (uint32_t j = 1; j < BL_IN + 1; j++) {
-                        cache_input[i*(BL_IN+2) + j] = maximum(cache_input[(i-1)*(BL_IN+2) + j - 1] + cache_ref[(i-1)*BL_IN + j-1],
-                                                cache_input[i*(BL_IN+2) + j - 1] - penalty,
-                                                cache_input[(i-1)*(BL_IN+2) + j] - penalty);
-                    }
-                }
-
-                // Move output from WRAM to MRAM
-                addr_input =  mram_base_addr_input_itemsets + (t_index_x * (BL+2) * BL_IN * sizeof(int32_t)) + (t_index_y * BL_IN * sizeof(int32_t));
-                cache_input_offset = (BL_IN+2);
-                addr_input += ((BL+2) * sizeof(int32_t));
-                for (int i = 1; i < BL_IN + 1; i++) {
-                    mram_write((cache_input + cache_input_offset), (__mram_ptr void *)  addr_input, (BL_IN+2) * sizeof(int32_t)); 
-                    cache_input_offset += (BL_IN+2); 
-                    addr_input += ((BL+2) * sizeof(int32_t));
-                }
-
+                sub_block(kernel, cell, mram_base_addr_input_itemsets, mram_base_addr_ref, cache_input, cache_ref, t_index_x, t_index_y);
             }
             
             barrier_wait(&my_barrier);
@@ -132,54 +328,159 @@ int main() {
             for (uint32_t bl_indx = 0; bl_indx < chunks; bl_indx++) {
                 int t_index_x = blk - 1 + start + bl_indx;
                 int t_index_y = REP + blk - 2 - t_index_x; 
+                sub_block(kernel, cell, mram_base_addr_input_itemsets, mram_base_addr_ref, cache_input, cache_ref, t_index_x, t_index_y);
+            }
+            
+            barrier_wait(&my_barrier);
 
-                // Move input from MRAM to WRAM
-                addr_input =  mram_base_addr_input_itemsets + (t_index_x * (BL+2) * BL_IN * sizeof(int32_t)) + (t_index_y * BL_IN * sizeof(int32_t));
-                cache_input_offset = (BL_IN+2);
-                mram_read((__mram_ptr void const *) addr_input, (void *) cache_input, (BL_IN+2) * sizeof(int32_t)); 
-                addr_input += ((BL+2) * sizeof(int32_t));
-                for (int i = 1; i < BL_IN + 1; i++) {
-                    mram_read((__mram_ptr void const *) addr_input, (void *) (cache_input + cache_input_offset), (2) * sizeof(int32_t)); 
-                    cache_input_offset += (BL_IN+2); 
-                    addr_input += ((BL+2) * sizeof(int32_t));
-                }
+        }
 
-                addr_ref = mram_base_addr_ref + (t_index_x * BL * BL_IN * sizeof(int32_t)) +  (t_index_y * BL_IN * sizeof(int32_t));
-                cache_input_offset = 0;
-                for (int i = 0; i < BL_IN; i++) {
-                    mram_read((__mram_ptr void const *) addr_ref, (void *) (cache_ref + cache_input_offset), (BL_IN) * sizeof(int32_t)); 
-                    cache_input_offset += BL_IN; 
-                    addr_ref += (BL * sizeof(int32_t));
-                }
+        // Local kernel: maximum of the block
+        if (kernel == kernel4) {
+            if (tasklet_id == 0) {
+                *block_max = tasklet_max[0];
+                for (uint32_t t = 1; t < NR_TASKLETS; t++)
+                    if (tasklet_max[t].score > block_max->score)
+                        *block_max = tasklet_max[t];
+                mram_write(block_max, (__mram_ptr void *) (mram_base_addr_max + bl * sizeof(nw_max_t)), sizeof(nw_max_t));
+            }
+            barrier_wait(&my_barrier);
+        }
+		
+        mram_base_addr_input_itemsets += ((BL+1) * (BL+2) * cell * sizeof(int32_t));
+        mram_base_addr_ref += (BL * BL * sizeof(int32_t)); 
+    }
+    return 0;
+}
 
+// Wavefront, linear-gap global alignment
+int main_kernel1() {
+    return wavefront(kernel1, 1);
+}
 
-                // Computation
-                for (int i = 1; i < BL_IN + 1; i++) {
-                    for (int j = 1; j < BL_IN + 1; j++) {
-                        cache_input[i*(BL_IN+2) + j] = maximum(cache_input[(i-1)*(BL_IN+2) + j - 1] + cache_ref[(i-1)*BL_IN + j-1],
-                                                cache_input[i*(BL_IN+2) + j - 1] - penalty,
-                                                cache_input[(i-1)*(BL_IN+2) + j] - penalty);
-                    }
-                }
+// Wavefront, affine-gap global alignment
+int main_kernel3() {
+    return wavefront(kernel3, AFFINE_CELL);
+}
 
-                // Move output from WRAM to MRAM
-                addr_input =  mram_base_addr_input_itemsets + (t_index_x * (BL+2) * BL_IN * sizeof(int32_t)) + (t_index_y * BL_IN * sizeof(int32_t));
-                cache_input_offset = (BL_IN+2);
-                addr_input += ((BL+2) * sizeof(int32_t));
-                for (int i = 1; i < BL_IN + 1; i++) {
-                    mram_write(cache_input + cache_input_offset, (__mram_ptr void *)  addr_input, (BL_IN+2) * sizeof(int32_t)); 
-                    cache_input_offset += (BL_IN+2); 
-                    addr_input += ((BL+2) * sizeof(int32_t));
-                }
+// Wavefront, local alignment
+int main_kernel4() {
+    return wavefront(kernel4, 1);
+}
 
+// Batch: independent pairs, one full alignment per tasklet at a time
+int main_kernel2() {
+    unsigned int tasklet_id = me();
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+    uint32_t npairs = DPU_INPUT_ARGUMENTS.nblocks;
+    uint32_t pairs_per_dpu = DPU_INPUT_ARGUMENTS.active_blocks;
+    int32_t penalty = DPU_INPUT_ARGUMENTS.penalty;
+    uint32_t max_len = DPU_INPUT_ARGUMENTS.max_len;
+    uint32_t cigar = DPU_INPUT_ARGUMENTS.cigar;
+#if PRINT
+    printf("tasklet_id = %d, npairs = %d \n", tasklet_id, npairs);
+#endif
+
+    uint32_t seq_bytes = BATCH_SEQ_BYTES(max_len);
+    uint32_t pair_bytes = BATCH_PAIR_BYTES(max_len);
+
+    // MRAM layout: pairs, results, CIGARs, per-tasklet traceback directions
+    uint32_t mram_base_addr_pairs = (uint32_t) (DPU_MRAM_HEAP_POINTER);
+    uint32_t mram_base_addr_results = mram_base_addr_pairs + pairs_per_dpu * pair_bytes;
+    uint32_t mram_base_addr_cigar = mram_base_addr_results + pairs_per_dpu * sizeof(nw_result_t);
+    uint32_t mram_base_addr_dir = mram_base_addr_cigar + (cigar != CIGAR_NONE ? pairs_per_dpu * BATCH_CIGAR_BYTES(max_len) : 0)
+                                  + tasklet_id * max_len * seq_bytes;
+
+    uint8_t *cache_pair = mem_alloc(pair_bytes);
+    int32_t *cache_rows = mem_alloc(2 * (max_len + 2) * sizeof(int32_t));
+    uint8_t *cache_dir = mem_alloc(seq_bytes);
+    nw_result_t *result = mem_alloc(sizeof(nw_result_t));
+    subproblem_t *stack = mem_alloc(BATCH_STACK * sizeof(subproblem_t));
+    cigar_writer_t writer;
+    writer.cache = mem_alloc(2 * sizeof(uint32_t));
+
+    for (uint32_t pair = tasklet_id; pair < npairs; pair += NR_TASKLETS) {
+
+        // Move pair from MRAM to WRAM
+        mram_read_large(mram_base_addr_pairs + pair * pair_bytes, cache_pair, pair_bytes);
+        uint32_t len_a = ((uint32_t *) cache_pair)[0];
+        uint32_t len_b = ((uint32_t *) cache_pair)[1];
+        uint8_t *seq_a = cache_pair + 2 * sizeof(uint32_t);
+        uint8_t *seq_b = seq_a + seq_bytes;
+
+        // Linear-space traceback, which also gives the score
+        if (cigar == CIGAR_LINEAR) {
+            writer.addr = mram_base_addr_cigar + pair * BATCH_CIGAR_BYTES(max_len);
+            writer.n_ops = 0;
+            result->score = hirschberg(&writer, stack, cache_rows, cache_rows + max_len + 2, seq_a, len_a, seq_b, len_b, penalty);
+            result->cigar_len = writer.n_ops;
+            mram_write(result, (__mram_ptr void *) (mram_base_addr_results + pair * sizeof(nw_result_t)), sizeof(nw_result_t));
+            continue;
+        }
+
+        // Computation, row by row
+        int32_t *prev = cache_rows;
+        int32_t *curr = cache_rows + max_len + 2;
+        for (uint32_t j = 0; j <= len_b; j++)
+            prev[j] = -(int32_t) j * penalty;
+        for (uint32_t i = 1; i <= len_a; i++) {
+            int *ref = blosum62[seq_a[i - 1]];
+            curr[0] = -(int32_t) i * penalty;
+            for (uint32_t j = 1; j <= len_b; j++) {
+                int32_t nw = prev[j - 1] + ref[seq_b[j - 1]];
+                int32_t w = curr[j - 1] - penalty;
+                curr[j] = maximum(nw, w, prev[j] - penalty);
+                cache_dir[j - 1] = traceback_op(curr[j], nw, w);
             }
-            
-            barrier_wait(&my_barrier);
+            if (cigar == CIGAR_FULL)
+                mram_write(cache_dir, (__mram_ptr void *) (mram_base_addr_dir + (i - 1) * seq_bytes), seq_bytes);
+            int32_t *tmp = prev;
+            prev = curr;
+            curr = tmp;
+        }
+        result->score = prev[len_b];
+        result->cigar_len = 0;
 
+        // Traceback, from the last cell to the first one
+        if (cigar == CIGAR_FULL) {
+            uint32_t *ops = (uint32_t *) cache_rows; // Score rows are not needed anymore
+            uint32_t n_ops = 0;
+            uint32_t row_in_cache = 0;
+            for (uint32_t i = len_a, j = len_b; i > 0 || j > 0;) {
+                uint32_t op;
+                if (i == 0)
+                    op = CIGAR_I;
+                else if (j == 0)
+                    op = CIGAR_D;
+                else {
+                    if (row_in_cache != i) {
+                        mram_read((__mram_ptr void const *) (mram_base_addr_dir + (i - 1) * seq_bytes), cache_dir, seq_bytes);
+                        row_in_cache = i;
+                    }
+                    op = cache_dir[j - 1];
+                }
+                if (n_ops > 0 && (ops[n_ops - 1] & 3) == op)
+                    ops[n_ops - 1] += (1 << 2);
+                else
+                    ops[n_ops++] = (1 << 2) | op;
+                if (op != CIGAR_I)
+                    i--;
+                if (op != CIGAR_D)
+                    j--;
+            }
+            result->cigar_len = n_ops;
+
+            // Move CIGAR (in reverse order) from WRAM to MRAM
+            if (n_ops > 0)
+                mram_write_large(ops, mram_base_addr_cigar + pair * BATCH_CIGAR_BYTES(max_len), roundup8(n_ops * sizeof(uint32_t)));
         }
-		
-        mram_base_addr_input_itemsets += ((BL+1) * (BL+2) * sizeof(int32_t));
-        mram_base_addr_ref += (BL * BL * sizeof(int32_t)); 
+
+        // Move result from WRAM to MRAM
+        mram_write(result, (__mram_ptr void *) (mram_base_addr_results + pair * sizeof(nw_result_t)), sizeof(nw_result_t));
     }
     return 0;
 }
@@ -16,6 +16,7 @@
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 #if ENERGY
 #include <dpu_probe.h>
@@ -94,10 +95,184 @@ static void traceback(int* traceback_output, int32_t *input_itemsets, int32_t *r
     return;
 }
 
+// Blocks (b_index_x, diag - b_index_x) of one anti-diagonal, with lo <= b_index_x <= hi,
+// that intersect the band |b_index_x - b_index_y| <= band
+static void band_blocks(unsigned int *first_block, unsigned int *nr_of_blocks, unsigned int diag, unsigned int lo, unsigned int hi, unsigned int band) {
+    unsigned int first = (diag > band) ? (diag - band + 1) / 2 : 0;
+    unsigned int last = (diag + band) / 2;
+    if (first < lo)
+        first = lo;
+    if (last > hi)
+        last = hi;
+    *first_block = first;
+    *nr_of_blocks = (last >= first) ? last - first + 1 : 0;
+}
+
+// Computation of one block in the host, with cell int32_t per matrix cell
+static void nw_host_block(int32_t *input_itemsets_l, int32_t *reference_l, unsigned int scoring, int32_t penalty, int32_t gap_open,
+                          nw_max_t *best, uint64_t row, uint64_t col, uint64_t max_cols) {
+    for (uint64_t i = 1; i < BL + 1; i++) {
+        for (uint64_t j = 1; j < BL + 1; j++) {
+            if (scoring == SCORING_AFFINE) {
+                int32_t *h = input_itemsets_l + (i*(BL + 1) + j) * AFFINE_CELL;
+                int32_t *w = h - AFFINE_CELL;
+                int32_t *n = h - (BL + 1) * AFFINE_CELL;
+                int32_t *nw = n - AFFINE_CELL;
+                int32_t e = w[1] - penalty;
+                if (w[0] - gap_open - penalty > e)
+                    e = w[0] - gap_open - penalty;
+                int32_t f = n[2] - penalty;
+                if (n[0] - gap_open - penalty > f)
+                    f = n[0] - gap_open - penalty;
+                h[0] = maximum(nw[0] + reference_l[(i-1)*BL + j - 1], e, f);
+                h[1] = e;
+                h[2] = f;
+                continue;
+            }
+            input_itemsets_l[i*(BL + 1) + j] = maximum(input_itemsets_l[(i-1)*(BL+1) + j - 1] + reference_l[(i-1)*BL + j - 1],
+                    input_itemsets_l[i*(BL+1) + j - 1] - penalty,
+                    input_itemsets_l[(i-1)*(BL+1) + j] - penalty);
+            if (scoring == SCORING_LOCAL) {
+                if (input_itemsets_l[i*(BL + 1) + j] < 0)
+                    input_itemsets_l[i*(BL + 1) + j] = 0;
+                if (input_itemsets_l[i*(BL + 1) + j] > best->score) {
+                    best->score = input_itemsets_l[i*(BL + 1) + j];
+                    best->cell = (row + i) * max_cols + col + j;
+                }
+            }
+        }
+    }
+}
+
+// Local kernel: retrieve the maximum of each block of one anti-diagonal and update the best cell
+static void local_max(struct dpu_set_t dpu_set, nw_max_t *block_max, nw_max_t *best, uint32_t nr_of_dpus, uint64_t max_cols,
+                      unsigned int diag, unsigned int first_block, unsigned int nr_of_blocks, unsigned int blocks_per_dpu) {
+    struct dpu_set_t dpu;
+    unsigned int i = 0;
+    DPU_FOREACH(dpu_set, dpu, i) {
+        DPU_ASSERT(dpu_prepare_xfer(dpu, block_max + i * blocks_per_dpu));
+    }
+    DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, blocks_per_dpu * ((BL+1) * (BL+2) + BL * BL) * sizeof(int32_t),
+                blocks_per_dpu * sizeof(nw_max_t), DPU_XFER_DEFAULT));
+
+    unsigned int chunks = nr_of_blocks / nr_of_dpus;
+    unsigned int rest_blocks = nr_of_blocks % nr_of_dpus;
+    unsigned int prev_block_index = 0;
+    for (i = 0; i < nr_of_dpus; i++) {
+        unsigned int nblocks = chunks + (i < rest_blocks);
+        for (unsigned int bl_indx = 0; bl_indx < nblocks; bl_indx++) {
+            nw_max_t *m = block_max + i * blocks_per_dpu + bl_indx;
+            if (m->score <= best->score)
+                continue;
+            uint64_t b_index_x = first_block + prev_block_index + bl_indx;
+            uint64_t b_index_y = diag - b_index_x;
+            best->score = m->score;
+            best->cell = (b_index_y * BL + m->cell / (BL+1)) * max_cols + b_index_x * BL + m->cell % (BL+1);
+        }
+        prev_block_index += nblocks;
+    }
+}
+
+// Blocks of one anti-diagonal staged on the host, blocks_per_dpu blocks per DPU
+typedef struct {
+    int32_t *matrix; // input_itemsets or reference
+    int32_t *buffer; // Staging buffer
+    uint64_t max_cols;
+    uint32_t cell;
+    unsigned int diag;
+    unsigned int first_block;
+    unsigned int nr_of_blocks;
+    unsigned int nr_of_dpus;
+    unsigned int blocks_per_dpu;
+} block_xfer_t;
+
+// Position in the staging buffer of the k-th block of the anti-diagonal
+static uint64_t block_slot(block_xfer_t *x, uint64_t k) {
+    uint64_t chunks = x->nr_of_blocks / x->nr_of_dpus;
+    uint64_t rest_blocks = x->nr_of_blocks % x->nr_of_dpus;
+    if (k < rest_blocks * (chunks + 1))
+        return (k / (chunks + 1)) * x->blocks_per_dpu + k % (chunks + 1);
+    k -= rest_blocks * (chunks + 1);
+    return (rest_blocks + k / chunks) * x->blocks_per_dpu + k % chunks;
+}
+
+// Itemsets: first row and first column of each block
+static void pack_itemsets(void *arg, unsigned int thread, unsigned int nr_threads) {
+    block_xfer_t *x = (block_xfer_t *) arg;
+    uint64_t first, last;
+    pool_range(x->nr_of_blocks, thread, nr_threads, &first, &last);
+    for (uint64_t k = first; k < last; k++) {
+        uint64_t b_index_x = x->first_block + k;
+        uint64_t b_index_y = x->diag - b_index_x;
+        int32_t *src = x->matrix + (b_index_y * (x->max_cols+1) * BL + b_index_x * BL) * x->cell;
+        int32_t *dst = x->buffer + block_slot(x, k) * (BL+1) * (BL+2) * x->cell;
+        memcpy(dst, src, (BL+2) * x->cell * sizeof(int32_t));
+        for (uint64_t bl = 1; bl < BL + 1; bl++)
+            memcpy(dst + bl * (BL+2) * x->cell, src + bl * (x->max_cols+1) * x->cell, x->cell * sizeof(int32_t));
+    }
+}
+
+// Itemsets: computed cells of each block
+static void unpack_itemsets(void *arg, unsigned int thread, unsigned int nr_threads) {
+    block_xfer_t *x = (block_xfer_t *) arg;
+    uint64_t first, last;
+    pool_range(x->nr_of_blocks, thread, nr_threads, &first, &last);
+    for (uint64_t k = first; k < last; k++) {
+        uint64_t b_index_x = x->first_block + k;
+        uint64_t b_index_y = x->diag - b_index_x;
+        int32_t *dst = x->matrix + (b_index_y * (x->max_cols+1) * BL + b_index_x * BL + 1) * x->cell;
+        int32_t *src = x->buffer + (block_slot(x, k) * (BL+1) * (BL+2) + 1) * x->cell;
+        for (uint64_t bl = 1; bl < BL + 1; bl++)
+            memcpy(dst + bl * (x->max_cols+1) * x->cell, src + bl * (BL+2) * x->cell, BL * x->cell * sizeof(int32_t));
+    }
+}
+
+// Reference: BL x BL scores of each block
+static void pack_reference(void *arg, unsigned int thread, unsigned int nr_threads) {
+    block_xfer_t *x = (block_xfer_t *) arg;
+    uint64_t first, last;
+    pool_range(x->nr_of_blocks, thread, nr_threads, &first, &last);
+    for (uint64_t k = first; k < last; k++) {
+        uint64_t b_index_x = x->first_block + k;
+        uint64_t b_index_y = x->diag - b_index_x;
+        int32_t *src = x->matrix + b_index_y * (x->max_cols - 1) * BL + b_index_x * BL;
+        int32_t *dst = x->buffer + block_slot(x, k) * BL * BL;
+        for (uint64_t bl = 0; bl < BL; bl++)
+            memcpy(dst + bl * BL, src + bl * (x->max_cols - 1), BL * sizeof(int32_t));
+    }
+}
+
+// Blocks of one anti-diagonal of the wavefront, within the band
+static void diagonal_blocks(block_xfer_t *x, unsigned int diag, unsigned int nr_diag_blocks, unsigned int band) {
+    unsigned int lo = (diag < nr_diag_blocks) ? 0 : diag - nr_diag_blocks + 1;
+    unsigned int hi = (diag < nr_diag_blocks) ? diag : nr_diag_blocks - 1;
+    x->diag = diag;
+    band_blocks(&x->first_block, &x->nr_of_blocks, diag, lo, hi, band);
+    x->blocks_per_dpu = (x->nr_of_blocks + x->nr_of_dpus - 1) / x->nr_of_dpus;
+}
+
+// Timers of one anti-diagonal: all diagonals, the longest diagonal and the short diagonals
+static void diagonal_start(Timer *timer, Timer *long_diagonal_timer, Timer *short_diagonal_timer, int i, int rep, unsigned int diag, bool longest, bool short_diagonal) {
+    start(timer, i, rep + diag);
+    if (longest)
+        start(long_diagonal_timer, i, rep);
+    if (short_diagonal)
+        start(short_diagonal_timer, i, 1);
+}
+
+static void diagonal_stop(Timer *timer, Timer *long_diagonal_timer, Timer *short_diagonal_timer, int i, bool longest, bool short_diagonal) {
+    stop(timer, i);
+    if (longest)
+        stop(long_diagonal_timer, i);
+    if (short_diagonal)
+        stop(short_diagonal_timer, i);
+}
+
 // Compute output in the host
-static void nw_host(int32_t *input_itemsets, int32_t *reference, uint64_t max_cols, unsigned int penalty) {
+static void nw_host(int32_t *input_itemsets, int32_t *reference, uint64_t max_cols, unsigned int penalty, unsigned int band,
+                    unsigned int scoring, unsigned int gap_open, uint32_t cell, nw_max_t *best) {
 
-    int32_t *input_itemsets_l = (int32_t *) malloc((BL + 1) * (BL + 1) * sizeof(int32_t));
+    int32_t *input_itemsets_l = (int32_t *) malloc((BL + 1) * (BL + 1) * cell * sizeof(int32_t));
     int32_t *reference_l = (int32_t *) malloc((BL * BL) * sizeof(int32_t));
 
 
@@ -105,6 +280,8 @@ static void nw_host(int32_t *input_itemsets, int32_t *reference, uint64_t max_co
     for (uint64_t blk = 1; blk <= (max_cols-1)/BL; blk++) {
         for (uint64_t b_index_x = 0; b_index_x < blk; b_index_x++) {
             uint64_t b_index_y = blk - 1 - b_index_x;
+            if (b_index_x > b_index_y + band || b_index_y > b_index_x + band) // Out of band
+                continue;
 
             for (uint64_t i = 0; i < BL; i++){
                 for (uint64_t j = 0; j < BL; j++) {
@@ -113,24 +290,14 @@ static void nw_host(int32_t *input_itemsets, int32_t *reference, uint64_t max_co
             }
 
             for (uint64_t i = 0; i < BL + 1; i++){
-                for (uint64_t j = 0; j < BL + 1; j++) {
-                    input_itemsets_l[i*(BL + 1) + j] = input_itemsets[max_cols*(b_index_y*BL + i) + b_index_x*BL + j];
-                }
+                memcpy(input_itemsets_l + i*(BL + 1)*cell, input_itemsets + (max_cols*(b_index_y*BL + i) + b_index_x*BL) * cell, (BL + 1) * cell * sizeof(int32_t));
             }
 
             // Computation
-            for (uint64_t i = 1; i < BL + 1; i++) {
-                for (uint64_t j = 1; j < BL + 1; j++) {
-                    input_itemsets_l[i*(BL + 1) + j] = maximum(input_itemsets_l[(i-1)*(BL+1) + j - 1] + reference_l[(i-1)*BL + j - 1],
-                            input_itemsets_l[i*(BL+1) + j - 1] - penalty,
-                            input_itemsets_l[(i-1)*(BL+1) + j] - penalty);
-                }
-            }
+            nw_host_block(input_itemsets_l, reference_l, scoring, penalty, gap_open, best, b_index_y*BL, b_index_x*BL, max_cols);
 
             for (uint64_t i = 0; i < BL; i++) {
-                for (uint64_t j = 0; j < BL; j++) {
-                    input_itemsets[max_cols*(b_index_y*BL + i + 1) + b_index_x*BL + j + 1] = input_itemsets_l[(i+1)*(BL+1) + j + 1];
-                }
+                memcpy(input_itemsets + (max_cols*(b_index_y*BL + i + 1) + b_index_x*BL + 1) * cell, input_itemsets_l + ((i+1)*(BL+1) + 1) * cell, BL * cell * sizeof(int32_t));
             }
 
         }
@@ -141,6 +308,8 @@ static void nw_host(int32_t *input_itemsets, int32_t *reference, uint64_t max_co
     for (uint64_t blk = 2; blk <= (max_cols-1)/BL; blk++) {
         for (uint64_t b_index_x = blk - 1; b_index_x < (max_cols-1)/BL; b_index_x++) {
             uint64_t b_index_y = (max_cols-1)/BL + blk - 2 - b_index_x;
+            if (b_index_x > b_index_y + band || b_index_y > b_index_x + band) // Out of band
+                continue;
 
             for (uint64_t i = 0; i < BL; i++){
                 for (uint64_t j = 0; j < BL; j++) {
@@ -149,24 +318,14 @@ static void nw_host(int32_t *input_itemsets, int32_t *reference, uint64_t max_co
             }
 
             for (uint64_t i = 0; i < BL + 1; i++){
-                for (uint64_t j = 0; j < BL + 1; j++) {
-                    input_itemsets_l[i*(BL + 1) + j] = input_itemsets[max_cols*(b_index_y*BL + i) + b_index_x*BL + j];
-                }
+                memcpy(input_itemsets_l + i*(BL + 1)*cell, input_itemsets + (max_cols*(b_index_y*BL + i) + b_index_x*BL) * cell, (BL + 1) * cell * sizeof(int32_t));
             }
 
             // Computation
-            for (uint64_t i = 1; i < BL + 1; i++) {
-                for (uint64_t j = 1; j < BL + 1; j++) {
-                    input_itemsets_l[i*(BL + 1) + j] = maximum(input_itemsets_l[(i-1)*(BL+1) + j - 1] + reference_l[(i-1)*BL + j - 1],
-                            input_itemsets_l[i*(BL+1) + j - 1] - penalty,
-                            input_itemsets_l[(i-1)*(BL+1) + j] - penalty);
-                }
-            }
+            nw_host_block(input_itemsets_l, reference_l, scoring, penalty, gap_open, best, b_index_y*BL, b_index_x*BL, max_cols);
 
             for (uint64_t i = 0; i < BL; i++) {
-                for (uint64_t j = 0; j < BL; j++) {
-                    input_itemsets[max_cols*(b_index_y*BL + i + 1) + b_index_x*BL + j + 1] = input_itemsets_l[(i+1)*(BL+1) + j + 1];
-                }
+                memcpy(input_itemsets + (max_cols*(b_index_y*BL + i + 1) + b_index_x*BL + 1) * cell, input_itemsets_l + ((i+1)*(BL+1) + 1) * cell, BL * cell * sizeof(int32_t));
             }
 
         }
@@ -179,12 +338,283 @@ static void nw_host(int32_t *input_itemsets, int32_t *reference, uint64_t max_co
     return;
 }
 
+// Compute output of the batch mode in the host
+static void nw_batch_host(nw_result_t *results, uint32_t *cigars, uint8_t *pairs, unsigned int n_pairs, unsigned int max_len, unsigned int penalty, unsigned int cigar) {
+
+    uint32_t seq_bytes = BATCH_SEQ_BYTES(max_len);
+    uint32_t pair_bytes = BATCH_PAIR_BYTES(max_len);
+    int32_t *rows = (int32_t *) malloc(2 * (max_len + 1) * sizeof(int32_t));
+    uint8_t *dir = (uint8_t *) malloc(max_len * max_len * sizeof(uint8_t));
+
+    for (unsigned int pair = 0; pair < n_pairs; pair++) {
+        uint8_t *record = pairs + (uint64_t) pair * pair_bytes;
+        uint32_t len_a = ((uint32_t *) record)[0];
+        uint32_t len_b = ((uint32_t *) record)[1];
+        uint8_t *seq_a = record + 2 * sizeof(uint32_t);
+        uint8_t *seq_b = seq_a + seq_bytes;
+
+        // Computation
+        int32_t *prev = rows;
+        int32_t *curr = rows + max_len + 1;
+        for (uint32_t j = 0; j <= len_b; j++)
+            prev[j] = -(int32_t) j * penalty;
+        for (uint32_t i = 1; i <= len_a; i++) {
+            curr[0] = -(int32_t) i * penalty;
+            for (uint32_t j = 1; j <= len_b; j++) {
+                int32_t nw = prev[j - 1] + blosum62[seq_a[i - 1]][seq_b[j - 1]];
+                int32_t w = curr[j - 1] - penalty;
+                curr[j] = maximum(nw, w, prev[j] - penalty);
+                dir[(i - 1) * max_len + j - 1] = traceback_op(curr[j], nw, w);
+            }
+            int32_t *tmp = prev;
+            prev = curr;
+            curr = tmp;
+        }
+        results[pair].score = prev[len_b];
+        results[pair].cigar_len = 0;
+
+        // Traceback
+        if (cigar) {
+            uint32_t *ops = cigars + (uint64_t) pair * 2 * max_len;
+            uint32_t n_ops = 0;
+            for (uint32_t i = len_a, j = len_b; i > 0 || j > 0;) {
+                uint32_t op;
+                if (i == 0)
+                    op = CIGAR_I;
+                else if (j == 0)
+                    op = CIGAR_D;
+                else
+                    op = dir[(i - 1) * max_len + j - 1];
+                if (n_ops > 0 && (ops[n_ops - 1] & 3) == op)
+                    ops[n_ops - 1] += (1 << 2);
+                else
+                    ops[n_ops++] = (1 << 2) | op;
+                if (op != CIGAR_I)
+                    i--;
+                if (op != CIGAR_D)
+                    j--;
+            }
+            results[pair].cigar_len = n_ops;
+        }
+    }
+
+    free(rows);
+    free(dir);
+    return;
+}
+
+// Score of the alignment described by a CIGAR, or NEG_INF if it does not cover both sequences
+static int32_t cigar_score(uint32_t *ops, uint32_t n_ops, uint8_t *record, unsigned int max_len, unsigned int penalty) {
+    uint32_t len_a = ((uint32_t *) record)[0];
+    uint32_t len_b = ((uint32_t *) record)[1];
+    uint8_t *seq_a = record + 2 * sizeof(uint32_t);
+    uint8_t *seq_b = seq_a + BATCH_SEQ_BYTES(max_len);
+    int32_t score = 0;
+    uint32_t i = 0, j = 0;
+    for (uint32_t k = n_ops; k > 0; k--) {
+        uint32_t op = ops[k - 1] & 3;
+        for (uint32_t l = 0; l < (ops[k - 1] >> 2); l++) {
+            if (op != CIGAR_I && i >= len_a)
+                return NEG_INF;
+            if (op != CIGAR_D && j >= len_b)
+                return NEG_INF;
+            if (op == CIGAR_M)
+                score += blosum62[seq_a[i]][seq_b[j]];
+            else
+                score -= penalty;
+            if (op != CIGAR_I)
+                i++;
+            if (op != CIGAR_D)
+                j++;
+        }
+    }
+    return (i == len_a && j == len_b) ? score : NEG_INF;
+}
+
+// CIGAR string of one alignment (entries are stored from the last cell)
+static void cigar_string(char *output, uint32_t *ops, uint32_t n_ops) {
+    const char op_chars[3] = {'M', 'I', 'D'};
+    output[0] = '\0';
+    for (uint32_t k = n_ops; k > 0; k--)
+        output += sprintf(output, "%u%c", ops[k - 1] >> 2, op_chars[ops[k - 1] & 3]);
+}
+
+// Batch mode: many independent pairs, each one aligned by a single tasklet
+static bool nw_batch(struct Params p, struct dpu_set_t dpu_set, uint32_t nr_of_dpus) {
+
+    struct dpu_set_t dpu;
+    unsigned int n_pairs = p.n_pairs;
+    unsigned int max_len = p.read_len;
+    unsigned int penalty = p.penalty;
+    unsigned int pairs_per_dpu = (n_pairs - 1) / nr_of_dpus + 1;
+    uint32_t pair_bytes = BATCH_PAIR_BYTES(max_len);
+    uint32_t cigar_bytes = BATCH_CIGAR_BYTES(max_len);
+    printf("Batch of %u pairs, max length %u, %u pairs per DPU\n", n_pairs, max_len, pairs_per_dpu);
+
+    uint64_t total_dpu_memory = (uint64_t) pairs_per_dpu * (pair_bytes + sizeof(nw_result_t));
+    if (p.cigar != CIGAR_NONE)
+        total_dpu_memory += (uint64_t) pairs_per_dpu * cigar_bytes;
+    if (p.cigar == CIGAR_FULL)
+        total_dpu_memory += (uint64_t) NR_TASKLETS * max_len * BATCH_SEQ_BYTES(max_len);
+    assert(total_dpu_memory <= DPU_CAPACITY && "Batch does not fit in MRAM!");
+    assert(NR_TASKLETS * BATCH_WRAM_BYTES(max_len) <= BATCH_WRAM_LIMIT && "Sequences do not fit in WRAM!");
+
+    uint64_t total_pairs = (uint64_t) nr_of_dpus * pairs_per_dpu;
+    uint8_t *pairs = (uint8_t *) calloc(total_pairs, pair_bytes);
+    nw_result_t *results = (nw_result_t *) malloc(total_pairs * sizeof(nw_result_t));
+    nw_result_t *results_host = (nw_result_t *) malloc(total_pairs * sizeof(nw_result_t));
+    uint32_t *cigars = NULL;
+    uint32_t *cigars_host = NULL;
+    if (p.cigar) {
+        cigars = (uint32_t *) malloc(total_pairs * cigar_bytes);
+        cigars_host = (uint32_t *) malloc(total_pairs * cigar_bytes);
+    }
+    dpu_arguments_t *input_args = (dpu_arguments_t *) malloc(nr_of_dpus * sizeof(dpu_arguments_t));
+
+    // Define random sequence pairs of slightly different lengths
+    srand(7);
+    for (unsigned int pair = 0; pair < n_pairs; pair++) {
+        uint8_t *record = pairs + (uint64_t) pair * pair_bytes;
+        uint32_t len_a = max_len - rand() % (max_len / 8 + 1);
+        uint32_t len_b = max_len - rand() % (max_len / 8 + 1);
+        ((uint32_t *) record)[0] = len_a;
+        ((uint32_t *) record)[1] = len_b;
+        uint8_t *seq_a = record + 2 * sizeof(uint32_t);
+        uint8_t *seq_b = seq_a + BATCH_SEQ_BYTES(max_len);
+        for (unsigned int i = 0; i < len_a; i++)
+            seq_a[i] = rand() % 10 + 1;
+        for (unsigned int j = 0; j < len_b; j++)
+            seq_b[j] = rand() % 10 + 1;
+    }
+
+    // Timer
+    Timer timer;
+
+    for (unsigned int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
+
+        // Computation on host CPU
+        if (rep >= p.n_warmup)
+            start(&timer, 0, rep - p.n_warmup);
+        nw_batch_host(results_host, cigars_host, pairs, n_pairs, max_len, penalty, p.cigar);
+        if (rep >= p.n_warmup)
+            stop(&timer, 0);
+
+        // Copy input arguments to DPUs
+        unsigned int i = 0;
+        DPU_FOREACH(dpu_set, dpu, i) {
+            unsigned int first_pair = i * pairs_per_dpu;
+            unsigned int npairs = 0;
+            if (first_pair < n_pairs)
+                npairs = (n_pairs - first_pair < pairs_per_dpu) ? n_pairs - first_pair : pairs_per_dpu;
+            input_args[i].nblocks = npairs;
+            input_args[i].active_blocks = pairs_per_dpu;
+            input_args[i].penalty = penalty;
+            input_args[i].max_len = max_len;
+            input_args[i].cigar = p.cigar;
+            input_args[i].kernel = kernel2;
+            DPU_ASSERT(dpu_prepare_xfer(dpu, input_args + i));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(dpu_arguments_t), DPU_XFER_DEFAULT));
+
+        // Copy pairs to DPUs
+        if (rep >= p.n_warmup)
+            start(&timer, 2, rep - p.n_warmup);
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, pairs + (uint64_t) i * pairs_per_dpu * pair_bytes));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, pairs_per_dpu * pair_bytes, DPU_XFER_DEFAULT));
+        if (rep >= p.n_warmup)
+            stop(&timer, 2);
+
+        // Launch kernel on DPUs
+        if (rep >= p.n_warmup)
+            start(&timer, 3, rep - p.n_warmup);
+        DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
+        if (rep >= p.n_warmup)
+            stop(&timer, 3);
+
+#if PRINT
+        // Display DPU Logs
+        DPU_FOREACH(dpu_set, dpu) {
+            DPU_ASSERT(dpulog_read_for_dpu(dpu.dpu, stdout));
+        }
+#endif
+
+        // Retrieve scores and CIGARs
+        if (rep >= p.n_warmup)
+            start(&timer, 4, rep - p.n_warmup);
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, results + (uint64_t) i * pairs_per_dpu));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, pairs_per_dpu * pair_bytes, pairs_per_dpu * sizeof(nw_result_t), DPU_XFER_DEFAULT));
+        if (p.cigar) {
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, cigars + (uint64_t) i * pairs_per_dpu * 2 * max_len));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, pairs_per_dpu * (pair_bytes + sizeof(nw_result_t)), pairs_per_dpu * cigar_bytes, DPU_XFER_DEFAULT));
+        }
+        if (rep >= p.n_warmup)
+            stop(&timer, 4);
+
+    }
+
+    // Print timing results
+    printf("CPU version ");
+    print(&timer, 0, p.n_reps);
+    printf("CPU-DPU ");
+    print(&timer, 2, p.n_reps);
+    printf("DPU Kernel ");
+    print(&timer, 3, p.n_reps);
+    printf("DPU-CPU ");
+    print(&timer, 4, p.n_reps);
+    printf("\n");
+    double dpu_seconds = (timer.time[2] + timer.time[3] + timer.time[4]) / (1000000.0 * p.n_reps);
+    printf("Alignments/s: CPU %f\tDPU Kernel %f\tDPU (with transfers) %f\n",
+        n_pairs / (timer.time[0] / (1000000.0 * p.n_reps)), n_pairs / (timer.time[3] / (1000000.0 * p.n_reps)), n_pairs / dpu_seconds);
+
+    // Check output
+    bool status = true;
+    for (uint64_t pair = 0; pair < n_pairs; pair++) {
+        if (results_host[pair].score != results[pair].score || (p.cigar == CIGAR_FULL && results_host[pair].cigar_len != results[pair].cigar_len)) {
+            status = false;
+#if PRINT
+            printf("%ld: %d %d\n", pair, results_host[pair].score, results[pair].score);
+#endif
+        } else if (p.cigar == CIGAR_FULL && memcmp(cigars_host + pair * 2 * max_len, cigars + pair * 2 * max_len, results[pair].cigar_len * sizeof(uint32_t)) != 0) {
+            status = false;
+        } else if (p.cigar == CIGAR_LINEAR && cigar_score(cigars + pair * 2 * max_len, results[pair].cigar_len, pairs + pair * pair_bytes, max_len, penalty) != results[pair].score) {
+            // Hirschberg may return a different optimal path
+            status = false;
+        }
+    }
+    if (p.cigar && n_pairs > 0) {
+        char *cigar_output = (char *) malloc(2 * max_len * 12 + 1);
+        cigar_string(cigar_output, cigars, results[0].cigar_len);
+        printf("Pair 0: score %d CIGAR %s\n", results[0].score, cigar_output);
+        free(cigar_output);
+    }
+
+    if (status) {
+        printf("[" ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "] Outputs are equal\n");
+    } else {
+        printf("[" ANSI_COLOR_RED "ERROR" ANSI_COLOR_RESET "] Outputs differ!\n");
+    }
+
+    free(pairs);
+    free(results);
+    free(results_host);
+    free(cigars);
+    free(cigars_host);
+    free(input_args);
+    return status;
+}
+
 // Main of the Host Application
 int main(int argc, char **argv) {
 
     struct Params p = input_params(argc, argv);
     struct dpu_set_t dpu_set, dpu;
-    uint32_t nr_of_dpus, max_dpus;
+    uint32_t nr_of_dpus;
 
 #if ENERGY
     struct dpu_probe_t probe;
@@ -197,16 +627,29 @@ int main(int argc, char **argv) {
     DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
     printf("Allocated %d DPU(s)\n", nr_of_dpus);
     printf("Allocated %d TASKLET(s) per DPU\n", NR_TASKLETS);
-#if DYNAMIC
-    max_dpus = nr_of_dpus;
-#endif
+
+    // Batch mode
+    if (p.n_pairs > 0) {
+        bool status = nw_batch(p, dpu_set, nr_of_dpus);
+        DPU_ASSERT(dpu_free(dpu_set));
+        return status ? 0 : -1;
+    }
 
     uint64_t max_rows = p.max_rows + 1;
     uint64_t max_cols = p.max_rows + 1;
     unsigned int penalty = p.penalty;
+    // Affine-gap scoring keeps {H, E, F} per cell
+    uint32_t cell = (p.scoring == SCORING_AFFINE) ? AFFINE_CELL : 1;
+    enum kernels kernel = (p.scoring == SCORING_AFFINE) ? kernel3 : (p.scoring == SCORING_LOCAL) ? kernel4 : kernel1;
+    // Band around the main diagonal, in blocks. Out-of-band blocks are not computed
+    unsigned int band_width = (max_cols-1)/BL;
+    if (p.band > 0) {
+        band_width = (p.band + BL - 1) / BL;
+        printf("Band of %d cells (%d blocks)\n", p.band, band_width);
+    }
     int32_t *reference = (int32_t *) malloc(max_rows * max_cols * sizeof(int32_t));
-    int32_t *input_itemsets_host = (int32_t *) malloc(max_rows * max_cols * sizeof(int32_t));
-    int32_t *input_itemsets = (int32_t *) malloc((max_rows+1) * (max_cols+1) * sizeof(int32_t));
+    int32_t *input_itemsets_host = (int32_t *) malloc(max_rows * max_cols * cell * sizeof(int32_t));
+    int32_t *input_itemsets = (int32_t *) malloc((max_rows+1) * (max_cols+1) * cell * sizeof(int32_t));
     dpu_arguments_t *input_args = (dpu_arguments_t *) malloc(nr_of_dpus * sizeof(dpu_arguments_t));
     printf("Max size %d\n", p.max_rows);
 
@@ -216,14 +659,27 @@ int main(int argc, char **argv) {
     memset(traceback_output, 0, (max_rows + max_cols) * sizeof(int32_t));
     memset(traceback_output_host, 0, (max_rows + max_cols) * sizeof(int32_t));
 
-    // This array is used for dummy/stale CPU-DPU transfers
-    int32_t *dummy = (int32_t *) malloc(nr_of_dpus * (BL+2) * sizeof(int32_t));
-    unsigned int blocks_per_dpu;
-    unsigned int mram_offset = 0;
+    // Staging buffers of the blocks of one anti-diagonal (the reference is double-buffered)
+    uint64_t max_blocks_per_dpu = ((max_cols-1)/BL + nr_of_dpus - 1) / nr_of_dpus;
+    int32_t *itemsets_buffer = (int32_t *) malloc(nr_of_dpus * max_blocks_per_dpu * (BL+1) * (BL+2) * cell * sizeof(int32_t));
+    int32_t *reference_buffer[2];
+    reference_buffer[0] = (int32_t *) malloc(nr_of_dpus * max_blocks_per_dpu * BL * BL * sizeof(int32_t));
+    reference_buffer[1] = (int32_t *) malloc(nr_of_dpus * max_blocks_per_dpu * BL * BL * sizeof(int32_t));
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+    // Local kernel: maximum of each block, and best cell of the DPU and CPU versions
+    nw_max_t *block_max = (nw_max_t *) malloc(nr_of_dpus * ((max_cols-1)/BL / nr_of_dpus + 1) * sizeof(nw_max_t));
+    nw_max_t best = {0, 0};
+    nw_max_t best_host = {0, 0};
 
     // Timer
     Timer timer; 
     Timer long_diagonal_timer; 
+    // Diagonals with fewer blocks than DPUs (the DPU set used to be re-allocated for them)
+    Timer short_diagonal_timer;
+    for (unsigned int t = 0; t < 6; t++)
+        short_diagonal_timer.time[t] = 0.0;
+    timer.time[5] = 0.0; // Single diagonals have no reference to stage
 #if ENERGY
     double tacc_energy, tacc_time, tavg_time;
     double tavg_energy=0;
@@ -233,52 +689,71 @@ int main(int argc, char **argv) {
 
         // Initializing inputs are needed at each iteration
         // Initialize input itemsets
+        // Cells of out-of-band blocks keep NEG_INF
+        int32_t init = (p.band > 0) ? NEG_INF : 0;
         for(unsigned int i = 0; i < max_rows; i++) {
-            for (unsigned int j = 0; j < max_cols; j++) {
-                input_itemsets_host[i * max_cols + j] = 0; 
+            for (unsigned int j = 0; j < max_cols * cell; j++) {
+                input_itemsets_host[i * max_cols * cell + j] = (i > 0 && j >= cell) ? init : 0; 
             }
         }
 
         for(unsigned int i = 0; i <= max_rows; i++) {
-            for (unsigned int j = 0; j <= max_cols; j++) {
-                input_itemsets[i * (max_cols+1) + j] = 0; 
+            for (unsigned int j = 0; j < (max_cols+1) * cell; j++) {
+                input_itemsets[i * (max_cols+1) * cell + j] = (i > 0 && j >= cell) ? init : 0; 
             }
         }
 
         // Define random sequences
         srand(7);
         for (unsigned int i = 1; i < max_rows; i++) {
-            input_itemsets_host[i * max_cols] = rand() % 10 + 1;
+            input_itemsets_host[i * max_cols * cell] = rand() % 10 + 1;
         }
 
         for (unsigned int j = 1; j < max_cols; j++) {
-            input_itemsets_host[j] = rand() % 10 + 1;
+            input_itemsets_host[j * cell] = rand() % 10 + 1;
         }   
 
         for (unsigned int i = 0; i < max_rows-1; i++) {
             for (unsigned int j = 0; j < max_cols-1; j++) {
-                reference[i * (max_cols-1) + j] = blosum62[input_itemsets[(i+1) * max_cols]][input_itemsets[j+1]];
+                reference[i * (max_cols-1) + j] = blosum62[input_itemsets_host[(i+1) * max_cols * cell]][input_itemsets_host[(j+1) * cell]];
             }
         }
 
-        for (unsigned int i = 1; i < max_rows; i++) {
-            input_itemsets_host[i * max_cols] = -i * penalty;
-            input_itemsets[i * (max_cols+1)] = -i * penalty;
+        // First row and column: gap penalties (global), or zero (local)
+        // Affine-gap: H = E (row) or F (column) = -(gap_open + k * penalty), the other gap matrix is NEG_INF
+        for (unsigned int k = 1; k < max_rows; k++) {
+            int32_t h = 0;
+            if (p.scoring == SCORING_LINEAR)
+                h = -k * penalty;
+            else if (p.scoring == SCORING_AFFINE)
+                h = -(int32_t) (p.gap_open + k * penalty);
+            for (unsigned int c = 0; c < cell; c++) {
+                // c = 0: H, c = 1: E, c = 2: F
+                int32_t row_value = (c == 2) ? NEG_INF : h;
+                int32_t col_value = (c == 1) ? NEG_INF : h;
+                input_itemsets_host[k * max_cols * cell + c] = col_value;
+                input_itemsets[k * (max_cols+1) * cell + c] = col_value;
+                input_itemsets_host[k * cell + c] = row_value;
+                input_itemsets[k * cell + c] = row_value;
+            }
         }
-
-        for (unsigned int j = 1; j < max_cols; j++) {
-            input_itemsets_host[j] = -j * penalty;
-            input_itemsets[j] = -j * penalty;
+        for (unsigned int c = 1; c < cell; c++) {
+            input_itemsets_host[c] = NEG_INF;
+            input_itemsets[c] = NEG_INF;
         }
+        best.score = 0;
+        best.cell = 0;
+        best_host.score = 0;
+        best_host.cell = 0;
 
         if (rep >= p.n_warmup)
             start(&timer, 0, rep - p.n_warmup);
         // Computation on host CPU
-        nw_host(input_itemsets_host, reference, max_cols, penalty);
+        nw_host(input_itemsets_host, reference, max_cols, penalty, band_width, p.scoring, p.gap_open, cell, &best_host);
 
         // Print host output
 #if PRINT_FILE
-        if (rep >= p.n_warmup) {
+        if (rep >= p.n_warmup && p.scoring == SCORING_LINEAR) {
             char *host_file = "./bin/host_output.txt";
             traceback(traceback_output_host, host_file, input_itemsets_host, reference, max_rows, max_cols, penalty);
         }
@@ -286,209 +761,109 @@ int main(int argc, char **argv) {
         if (rep >= p.n_warmup)
             stop(&timer, 0);
 
-        // Top-left computation on DPUs
-        for (unsigned int blk = 1; blk <= (max_cols-1)/BL; blk++) {
-#if DYNAMIC 
-            // If nr_of_blocks are lower than max_dpus,
-            // set nr_of_dpus to be equal with nr_of_blocks
-            unsigned nr_of_blocks = blk;
-            if (nr_of_blocks < max_dpus) {
-                DPU_ASSERT(dpu_free(dpu_set));
-                DPU_ASSERT(dpu_alloc(nr_of_blocks, NULL, &dpu_set));
-                DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-                DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-            } else if (nr_of_dpus == max_dpus) {
-                ;
-            } else {
-                DPU_ASSERT(dpu_free(dpu_set));
-                DPU_ASSERT(dpu_alloc(max_dpus, NULL, &dpu_set));
-                DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-                DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-            }
+        // Wavefront computation on DPUs, one anti-diagonal of blocks at a time.
+        // The DPU set is allocated once. If nr_of_blocks is lower than nr_of_dpus,
+        // the DPUs without blocks are masked out with nblocks = active_blocks = 0
+        unsigned int nr_diag_blocks = (max_cols-1)/BL;
+        int itemsets_timer = (nr_diag_blocks == 1) ? 2 : 1;
+        int timer_rep = rep - p.n_warmup;
+        block_xfer_t itemsets_xfer = {input_itemsets, itemsets_buffer, max_cols, cell, 0, 0, 0, nr_of_dpus, 0};
+        block_xfer_t reference_xfer = {reference, reference_buffer[0], max_cols, 1, 0, 0, 0, nr_of_dpus, 0};
+        block_xfer_t next_reference_xfer = reference_xfer;
+        diagonal_blocks(&next_reference_xfer, 0, nr_diag_blocks, band_width);
+        for (unsigned int diag = 0; diag + 1 < 2 * nr_diag_blocks; diag++) {
+            diagonal_blocks(&itemsets_xfer, diag, nr_diag_blocks, band_width);
+            unsigned int first_block = itemsets_xfer.first_block;
+            unsigned int nr_of_blocks = itemsets_xfer.nr_of_blocks;
+            unsigned int blocks_per_dpu = itemsets_xfer.blocks_per_dpu;
+            bool timed = rep >= p.n_warmup;
+            bool longest = diag + 1 == nr_diag_blocks;
+            bool short_diagonal = nr_of_blocks < nr_of_dpus;
 #if PRINT
-            printf("Allocated %d DPU(s) for %d (%d) blocks\n", nr_of_dpus, nr_of_blocks, blk);
-#endif
+            printf("Scheduled %d blocks onto %d DPU(s)\n", nr_of_blocks, nr_of_dpus);
 #endif
 
             // Copy data to DPUs
-            unsigned int i=0;
+            unsigned int i = 0;
             DPU_FOREACH(dpu_set, dpu, i) {
-                unsigned int blocks_per_dpu = blk / nr_of_dpus;
-                unsigned int active_blocks_per_dpu = blk / nr_of_dpus;
-                unsigned int rest_blocks = blk % nr_of_dpus;
-                if(i < rest_blocks)
-                    blocks_per_dpu++;
-
-                if(rest_blocks != 0)
-                    active_blocks_per_dpu++;
+                unsigned int nblocks = nr_of_blocks / nr_of_dpus;
+                if (i < nr_of_blocks % nr_of_dpus)
+                    nblocks++;
 
                 // Copy input arguments to dpu
-                input_args[i].nblocks = blocks_per_dpu;
-                input_args[i].active_blocks = active_blocks_per_dpu;
+                input_args[i].nblocks = nblocks;
+                input_args[i].active_blocks = (nblocks == 0) ? 0 : blocks_per_dpu; // Idle DPU in this diagonal
                 input_args[i].penalty = penalty;
+                input_args[i].max_len = 0;
+                input_args[i].cigar = 0;
+                input_args[i].gap_open = p.gap_open;
+                input_args[i].kernel = kernel;
                 DPU_ASSERT(dpu_prepare_xfer(dpu, input_args + i));
             } 
             DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(dpu_arguments_t), DPU_XFER_DEFAULT));
 
-            // Copy itemsets to DPUs
-            blocks_per_dpu = blk / nr_of_dpus;
-            if (blk % nr_of_dpus != 0)
-                blocks_per_dpu++;
-            mram_offset = 0;
-
-
-            if (rep >= p.n_warmup) {
-                if ((max_cols-1)/BL == 1) 
-                    start(&timer, 2, rep - p.n_warmup + blk - 1);
-                else 
-                    start(&timer, 1, rep - p.n_warmup + blk - 1);
-                
-                // Timer for longest diagonal
-                if (blk == ((max_cols-1)/BL)) {
-                    if ((max_cols-1)/BL == 1) 
-                        start(&long_diagonal_timer, 2, rep - p.n_warmup);
-                    else 
-                        start(&long_diagonal_timer, 1, rep - p.n_warmup);
-                }
-            }
-
+            // Copy itemsets to DPUs: first row and first column of the blocks, staged by the host threads
+            if (timed)
+                diagonal_start(&timer, &long_diagonal_timer, &short_diagonal_timer, itemsets_timer, timer_rep, diag, longest, short_diagonal);
 #if PRINT
             uint64_t total_dpu_memory = 0;
-            total_dpu_memory = (uint64_t) blocks_per_dpu * (BL+1) * (BL+2) * sizeof(int32_t) + (uint64_t) blocks_per_dpu * BL * BL * sizeof(int32_t);
-            printf("Total memory allocated in each DPU %u bytes\n", total_dpu_memory);
+            total_dpu_memory = (uint64_t) blocks_per_dpu * (BL+1) * (BL+2) * cell * sizeof(int32_t) + (uint64_t) blocks_per_dpu * BL * BL * sizeof(int32_t);
+            printf("Total memory allocated in each DPU %lu bytes\n", total_dpu_memory);
 #endif
-            for (unsigned int bl_indx = 0; bl_indx < blocks_per_dpu; bl_indx++) {
-                for (unsigned int bl = 0; bl < BL + 1; bl++) {
-
-                    i = 0;
-                    DPU_FOREACH(dpu_set, dpu, i) {
-                        unsigned int chunks = blk / nr_of_dpus;
-                        unsigned int prev_block_index = 0;
-                        unsigned int rest_blocks = blk % nr_of_dpus;
-                        if (rest_blocks > 0) {
-                            if (i >= rest_blocks) {
-                                prev_block_index = rest_blocks * (chunks + 1) + (i - rest_blocks) * chunks;
-                            } else {
-                                prev_block_index = i * (chunks + 1);
-                            }
-                        } else {
-                            prev_block_index = i * blocks_per_dpu; 
-                        }
-
-                        uint64_t input_itemsets_offset = 0;  
-                        int32_t *dpu_pointer;  
-                        if (i + bl_indx * nr_of_dpus >= blk) {
-                            dpu_pointer = dummy;
-                            input_itemsets_offset = 0;  
-                        } else {
-                            uint64_t b_index_x =  prev_block_index + bl_indx;
-                            uint64_t b_index_y = blk - 1 - b_index_x;
-                            dpu_pointer = input_itemsets;
-                            input_itemsets_offset = b_index_y * (max_cols+1) * BL + b_index_x * BL + bl * (max_cols + 1);  
-                        }
-
-                        DPU_ASSERT(dpu_prepare_xfer(dpu, dpu_pointer + input_itemsets_offset));
-                    }
-
-                    if (bl == 0) 
-                        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, (BL+2) * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    else
-                        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, 2 * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    mram_offset += ((BL+2) * sizeof(int32_t));
-
-                }
-            }
-            if (rep >= p.n_warmup) {
-                if ((max_cols-1)/BL == 1) 
-                    stop(&timer, 2);
-                else
-                    stop(&timer, 1);
-                // Timer for longest diagonal
-                if (blk == ((max_cols-1)/BL)) {
-                    if ((max_cols-1)/BL == 1) 
-                        stop(&long_diagonal_timer, 2);
-                    else 
-                        stop(&long_diagonal_timer, 1);
-                }
-            }
-
-
-            if (rep >= p.n_warmup) {
-                start(&timer, 2, rep - p.n_warmup + blk - 1);
-                // Timer for longest diagonal
-                if (blk == ((max_cols-1)/BL)) {
-                    start(&long_diagonal_timer, 2, rep - p.n_warmup);
-                }
-            }
-            // Copy reference to DPUs
-            mram_offset = blocks_per_dpu * (BL+1) * (BL+2) * sizeof(int32_t); 
-            for (unsigned int bl_indx = 0; bl_indx < blocks_per_dpu; bl_indx++) {
-                for (unsigned int bl = 0; bl < BL; bl++) {
-
-                    i = 0;
-                    DPU_FOREACH(dpu_set, dpu, i) {
-                        unsigned int chunks = blk / nr_of_dpus;
-                        unsigned int prev_block_index = 0;
-                        unsigned int rest_blocks = blk % nr_of_dpus;
-                        if (rest_blocks > 0) {
-                            if (i >= rest_blocks) {
-                                prev_block_index = rest_blocks * (chunks + 1) + (i - rest_blocks) * chunks;
-                            } else {
-                                prev_block_index = i * (chunks + 1);
-                            }
-                        } else {
-                            prev_block_index = i * blocks_per_dpu; 
-                        }
-
-                        uint64_t reference_offset = 0;  
-                        int32_t *dpu_pointer;  
-                        if (i + bl_indx * nr_of_dpus >= blk) {
-                            dpu_pointer = dummy;
-                            reference_offset = 0;  
-                        } else {
-                            uint64_t b_index_x =  prev_block_index + bl_indx;
-                            uint64_t b_index_y = blk - 1 - b_index_x;
-                            dpu_pointer = reference;
-                            reference_offset = b_index_y * (max_cols - 1) * BL + b_index_x * BL + bl * (max_cols - 1);  
-                        }
-
-                        DPU_ASSERT(dpu_prepare_xfer(dpu, dpu_pointer + reference_offset));
-                    }
-                    DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, BL * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    mram_offset += BL * sizeof(int32_t);
-
-                }
-            }
-            if (rep >= p.n_warmup) {
-                stop(&timer, 2);
-                if (blk == ((max_cols-1)/BL)) {
-                    stop(&long_diagonal_timer, 2);
-                }
+            uint64_t itemsets_bytes = (uint64_t) blocks_per_dpu * (BL+1) * (BL+2) * cell * sizeof(int32_t);
+            pool_run(&pool, pack_itemsets, &itemsets_xfer);
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, itemsets_buffer + i * itemsets_bytes / sizeof(int32_t)));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, itemsets_bytes, DPU_XFER_DEFAULT));
+            if (timed)
+                diagonal_stop(&timer, &long_diagonal_timer, &short_diagonal_timer, itemsets_timer, longest, short_diagonal);
+
+            // Copy reference to DPUs. Only the first diagonal is staged here,
+            // the next ones are staged while the DPUs compute the previous one
+            if (timed)
+                diagonal_start(&timer, &long_diagonal_timer, &short_diagonal_timer, 2, timer_rep, diag, longest, short_diagonal);
+            reference_xfer = next_reference_xfer;
+            if (diag == 0)
+                pool_run(&pool, pack_reference, &reference_xfer);
+            uint64_t reference_bytes = (uint64_t) blocks_per_dpu * BL * BL * sizeof(int32_t);
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, reference_xfer.buffer + i * reference_bytes / sizeof(int32_t)));
             }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, itemsets_bytes, reference_bytes, DPU_XFER_DEFAULT));
+            if (timed)
+                diagonal_stop(&timer, &long_diagonal_timer, &short_diagonal_timer, 2, longest, short_diagonal);
 
 #if ENERGY
-            if (rep >= p.n_warmup) {
+            if (timed) {
                 DPU_ASSERT(dpu_probe_start(&probe));
             }
 #endif
-            if (rep >= p.n_warmup) {
-                start(&timer, 3, rep - p.n_warmup + blk - 1);
-                // Timer for longest diagonal
-                if (blk == ((max_cols-1)/BL)) {
-                    start(&long_diagonal_timer, 3, rep - p.n_warmup);
-                }
-            }
-            // Launch kernel on DPUs
-            DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
-            if (rep >= p.n_warmup) {
-                stop(&timer, 3);
-                // Timer for longest diagonal
-                if (blk == ((max_cols-1)/BL)) {
-                    stop(&long_diagonal_timer, 3);
-                }
+            if (timed)
+                diagonal_start(&timer, &long_diagonal_timer, &short_diagonal_timer, 3, timer_rep, diag, longest, short_diagonal);
+            // Launch kernel on DPUs, and stage the reference of the next diagonal meanwhile.
+            // The pool threads pack while the DPUs run, so that the kernel timer stops at dpu_sync
+            // and does not include host work. The calling thread packs its share after the sync
+            DPU_ASSERT(dpu_launch(dpu_set, DPU_ASYNCHRONOUS));
+            bool stage_next = diag + 2 < 2 * nr_diag_blocks;
+            if (stage_next) {
+                if (timed)
+                    start(&timer, 5, timer_rep + diag);
+                next_reference_xfer.buffer = reference_buffer[(diag + 1) % 2];
+                diagonal_blocks(&next_reference_xfer, diag + 1, nr_diag_blocks, band_width);
+                pool_start(&pool, pack_reference, &next_reference_xfer);
+            }
+            DPU_ASSERT(dpu_sync(dpu_set));
+            if (timed)
+                diagonal_stop(&timer, &long_diagonal_timer, &short_diagonal_timer, 3, longest, short_diagonal);
+            if (stage_next) {
+                pack_reference(&next_reference_xfer, 0, pool.nr_threads);
+                pool_wait(&pool);
+                if (timed)
+                    stop(&timer, 5);
             }
 #if ENERGY
-            if (rep >= p.n_warmup) {
+            if (timed) {
                 DPU_ASSERT(dpu_probe_stop(&probe));
             }
 #endif
@@ -509,307 +884,24 @@ int main(int argc, char **argv) {
             }
 #endif
 
-            if (rep >= p.n_warmup) {
-                start(&timer, 4, rep - p.n_warmup + blk - 1);
-                // Timer for longest diagonal
-                if (blk == ((max_cols-1)/BL)) {
-                    start(&long_diagonal_timer, 4, rep - p.n_warmup);
-                }
-            }
+            if (timed)
+                diagonal_start(&timer, &long_diagonal_timer, &short_diagonal_timer, 4, timer_rep, diag, longest, short_diagonal);
             // Retrieve results
-            // Copy output result to Host CPU
-            mram_offset = 0;
-            for (unsigned int bl_indx = 0; bl_indx < blocks_per_dpu; bl_indx++) {
-                for (unsigned int bl = 0; bl < BL + 1; bl++) {
-
-                    i = 0;
-                    DPU_FOREACH(dpu_set, dpu, i) {
-                        unsigned int chunks = blk / nr_of_dpus;
-                        unsigned int prev_block_index = 0;
-                        unsigned int rest_blocks = blk % nr_of_dpus;
-                        if (rest_blocks > 0) {
-                            if (i >= rest_blocks) {
-                                prev_block_index = rest_blocks * (chunks + 1) + (i - rest_blocks) * chunks;
-                            } else {
-                                prev_block_index = i * (chunks + 1);
-                            }
-                        } else {
-                            prev_block_index = i * blocks_per_dpu; 
-                        }
-
-                        uint64_t input_itemsets_offset = 0;  
-                        int32_t *dpu_pointer;  
-                        if (i + bl_indx * nr_of_dpus >= blk) {
-                            dpu_pointer = dummy;
-                            input_itemsets_offset = 0;  
-                        } else {
-                            uint64_t b_index_x =  prev_block_index + bl_indx;
-                            uint64_t b_index_y = blk - 1 - b_index_x;
-                            dpu_pointer = input_itemsets;
-                            input_itemsets_offset = b_index_y * (max_cols+1) * BL + b_index_x * BL + bl * (max_cols + 1);  
-                        }
-
-                        if (bl == 0) // Skip the first row of the block
-                            continue;
-                        DPU_ASSERT(dpu_prepare_xfer(dpu, dpu_pointer + input_itemsets_offset));
-
-                    }
-                    if (bl == 0) {
-                        mram_offset += (BL+2) * sizeof(int32_t);
-                        continue;
-                    }
-                    DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, (BL+2) * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    mram_offset += (BL+2) * sizeof(int32_t);
-
-                }
-            }
-            if (rep >= p.n_warmup) {
-                stop(&timer, 4);
-                // Timer for longest diagonal
-                if (blk == ((max_cols-1)/BL)) {
-                    stop(&long_diagonal_timer, 4);
-                }
-            }
-        }
-
-
-        // Bottom-right computation on DPUs
-        for (unsigned int blk = 2; blk <= (max_cols-1)/BL; blk++) {
-#if DYNAMIC
-            // If nr_of_blocks are lower than max_dpus,
-            // set nr_of_dpus to be equal with nr_of_blocks
-            unsigned nr_of_blocks = (((max_cols-1)/BL) - blk + 1);
-            if (nr_of_blocks < max_dpus) {
-                DPU_ASSERT(dpu_free(dpu_set));
-                DPU_ASSERT(dpu_alloc(nr_of_blocks, NULL, &dpu_set));
-                DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-                DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-            } else if (nr_of_dpus == max_dpus) {
-                ;
-            } else {
-                DPU_ASSERT(dpu_free(dpu_set));
-                DPU_ASSERT(dpu_alloc(max_dpus, NULL, &dpu_set));
-                DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-                DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-            }
-#if PRINT
-            printf("Allocated %d DPU(s) for %d (%d) blocks\n", nr_of_dpus, nr_of_blocks, (((max_cols-1)/BL) - blk + 1));
-#endif
-#endif
-
-            // Copy data to DPUs
-            unsigned int i=0;
+            // Copy output result to Host CPU, and unpack the computed cells of the blocks
             DPU_FOREACH(dpu_set, dpu, i) {
-                unsigned int blocks_per_dpu = (((max_cols-1)/BL) - blk + 1) / nr_of_dpus;
-                unsigned int active_blocks_per_dpu = (((max_cols-1)/BL) - blk + 1) / nr_of_dpus;
-                unsigned int rest_blocks = (((max_cols-1)/BL) - blk + 1) % nr_of_dpus;
-                if(i < rest_blocks)
-                    blocks_per_dpu++;
-
-                if(rest_blocks != 0)
-                    active_blocks_per_dpu++;
-
-                // Copy input arguments to dpu
-                input_args[i].nblocks = blocks_per_dpu;
-                input_args[i].active_blocks = active_blocks_per_dpu;
-                input_args[i].penalty = penalty;
-                DPU_ASSERT(dpu_prepare_xfer(dpu, input_args + i));
-            } 
-            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(dpu_arguments_t), DPU_XFER_DEFAULT));
-
-            if (rep >= p.n_warmup)
-                start(&timer, 1, rep - p.n_warmup + blk - 1);
-            // Copy itemsets to DPUs
-            unsigned int blocks_per_dpu = (((max_cols-1)/BL) - blk + 1) / nr_of_dpus;
-            if ((((max_cols-1)/BL) - blk + 1) % nr_of_dpus != 0)
-                blocks_per_dpu++;
-#if PRINT
-            uint64_t total_dpu_memory = 0;
-            total_dpu_memory = (uint64_t) blocks_per_dpu * (BL+1) * (BL+2) * sizeof(int32_t) + (uint64_t) blocks_per_dpu * BL * BL * sizeof(int32_t);
-            printf("Total memory allocated in each DPU %u bytes\n", total_dpu_memory);
-#endif
-            unsigned int mram_offset = 0;
-            for (unsigned int bl_indx = 0; bl_indx < blocks_per_dpu; bl_indx++) {
-                for (unsigned int bl = 0; bl < BL + 1; bl++) {
-
-                    i = 0;
-                    DPU_FOREACH(dpu_set, dpu, i) {
-                        unsigned int chunks = (((max_cols-1)/BL) - blk + 1) / nr_of_dpus;
-                        unsigned int prev_block_index = 0;
-                        unsigned int rest_blocks = (((max_cols-1)/BL) - blk + 1) % nr_of_dpus;
-                        if (rest_blocks > 0) {
-                            if (i >= rest_blocks) {
-                                prev_block_index = rest_blocks * (chunks + 1) + (i - rest_blocks) * chunks;
-                            } else {
-                                prev_block_index = i * (chunks + 1);
-                            }
-                        } else {
-                            prev_block_index = i * blocks_per_dpu; 
-                        }
-
-                        uint64_t input_itemsets_offset = 0;  
-                        int32_t *dpu_pointer;  
-                        if (i + bl_indx * nr_of_dpus >= (((max_cols-1)/BL) - blk + 1)) {
-                            dpu_pointer = dummy;
-                            input_itemsets_offset = 0;  
-                        } else {
-                            uint64_t b_index_x = blk - 1 + prev_block_index + bl_indx;
-                            uint64_t b_index_y = (max_cols-1)/BL + blk - 2 - b_index_x;
-                            dpu_pointer = input_itemsets;
-                            input_itemsets_offset = b_index_y * (max_cols+1) * BL + b_index_x * BL + bl * (max_cols + 1);  
-                        }
-
-                        DPU_ASSERT(dpu_prepare_xfer(dpu, dpu_pointer + input_itemsets_offset));
-                    }
-
-                    if (bl == 0) 
-                        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, (BL+2) * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    else
-                        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, 2 * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    mram_offset += (BL+2) * sizeof(int32_t);
-
-                }
-            }
-            if (rep >= p.n_warmup)
-                stop(&timer, 1);
-
-
-            if (rep >= p.n_warmup)
-                start(&timer, 2, rep - p.n_warmup + blk - 1);
-            // Copy reference to DPUs
-            mram_offset = blocks_per_dpu * (BL+1) * (BL+2) * sizeof(int32_t); 
-            for (unsigned int bl_indx = 0; bl_indx < blocks_per_dpu; bl_indx++) {
-                for (unsigned int bl = 0; bl < BL; bl++) {
-
-                    i = 0;
-                    DPU_FOREACH(dpu_set, dpu, i) {
-                        unsigned int chunks = (((max_cols-1)/BL) - blk + 1) / nr_of_dpus;
-                        unsigned int prev_block_index = 0;
-                        unsigned int rest_blocks = (((max_cols-1)/BL) - blk + 1) % nr_of_dpus;
-                        if (rest_blocks > 0) {
-                            if (i >= rest_blocks) {
-                                prev_block_index = rest_blocks * (chunks + 1) + (i - rest_blocks) * chunks;
-                            } else {
-                                prev_block_index = i * (chunks + 1);
-                            }
-                        } else {
-                            prev_block_index = i * blocks_per_dpu; 
-                        }
-
-                        uint64_t reference_offset = 0;  
-                        int32_t *dpu_pointer;  
-                        if (i + bl_indx * nr_of_dpus >= (((max_cols-1)/BL) - blk + 1)) {
-                            dpu_pointer = dummy;
-                            reference_offset = 0;  
-                        } else {
-                            uint64_t b_index_x = blk - 1 + prev_block_index + bl_indx;
-                            uint64_t b_index_y = (max_cols-1)/BL + blk - 2 - b_index_x;
-                            dpu_pointer = reference;
-                            reference_offset = b_index_y * (max_cols - 1) * BL + b_index_x * BL + bl * (max_cols - 1);  
-                        }
-
-                        DPU_ASSERT(dpu_prepare_xfer(dpu, dpu_pointer + reference_offset));
-                    }
-
-                    DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, BL * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    mram_offset += BL * sizeof(int32_t);
-
-                }
-            }
-            if (rep >= p.n_warmup)
-                stop(&timer, 2);
-
-#if ENERGY
-            if (rep >= p.n_warmup) {
-                DPU_ASSERT(dpu_probe_start(&probe));
-            }
-#endif
-            if (rep >= p.n_warmup)
-                start(&timer, 3, rep - p.n_warmup + blk - 1); // Do not re-initialize the counter
-            // Launch kernel on DPUs
-            DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
-            if (rep >= p.n_warmup)
-                stop(&timer, 3);
-#if ENERGY
-            if (rep >= p.n_warmup) {
-                DPU_ASSERT(dpu_probe_stop(&probe));
-            }
-#endif
-
-#if ENERGY
-    	    double acc_energy, avg_energy, acc_time, avg_time;
-    	    DPU_ASSERT(dpu_probe_get(&probe, DPU_ENERGY, DPU_ACCUMULATE, &acc_energy));
-    	    DPU_ASSERT(dpu_probe_get(&probe, DPU_ENERGY, DPU_AVERAGE, &avg_energy));
-    	    DPU_ASSERT(dpu_probe_get(&probe, DPU_TIME, DPU_ACCUMULATE, &acc_time));
-    	    DPU_ASSERT(dpu_probe_get(&probe, DPU_TIME, DPU_AVERAGE, &avg_time));
-    	    tavg_energy += avg_energy;
-#endif
-
-#if PRINT
-            // Display DPU Logs
-            DPU_FOREACH(dpu_set, dpu) {
-                DPU_ASSERT(dpulog_read_for_dpu(dpu.dpu, stdout));
-            }
-#endif
-
-
-            if (rep >= p.n_warmup)
-                start(&timer, 4, rep - p.n_warmup + blk - 1);
-            // Retrieve results
-            // Copy output result to Host CPU
-            mram_offset = 0;
-            for (unsigned int bl_indx = 0; bl_indx < blocks_per_dpu; bl_indx++) {
-                for (unsigned int bl = 0; bl < BL + 1; bl++) {
-
-                    i = 0;
-                    DPU_FOREACH(dpu_set, dpu, i) {
-                        unsigned int chunks = (((max_cols-1)/BL) - blk + 1) / nr_of_dpus;
-                        unsigned int prev_block_index = 0;
-                        unsigned int rest_blocks = (((max_cols-1)/BL) - blk + 1) % nr_of_dpus;
-                        if (rest_blocks > 0) {
-                            if (i >= rest_blocks) {
-                                prev_block_index = rest_blocks * (chunks + 1) + (i - rest_blocks) * chunks;
-                            } else {
-                                prev_block_index = i * (chunks + 1);
-                            }
-                        } else {
-                            prev_block_index = i * blocks_per_dpu; 
-                        }
-
-                        uint64_t input_itemsets_offset = 0;  
-                        int32_t *dpu_pointer;  
-                        if (i + bl_indx * nr_of_dpus >= (((max_cols-1)/BL) - blk + 1)) {
-                            dpu_pointer = dummy;
-                            input_itemsets_offset = 0;  
-                        } else {
-                            uint64_t b_index_x = blk - 1 + prev_block_index + bl_indx;
-                            uint64_t b_index_y = (max_cols-1)/BL + blk - 2 - b_index_x;
-                            dpu_pointer = input_itemsets;
-                            input_itemsets_offset = b_index_y * (max_cols+1) * BL + b_index_x * BL + bl * (max_cols + 1);  
-                        }
-
-                        if (bl == 0) // Skip the first row of the block
-                            continue;
-                        DPU_ASSERT(dpu_prepare_xfer(dpu, dpu_pointer + input_itemsets_offset));
-
-                    }
-
-                    if (bl == 0) {
-                        mram_offset += (BL+2) * sizeof(int32_t);
-                        continue;
-                    }
-                    DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, mram_offset, (BL+2) * sizeof(int32_t), DPU_XFER_DEFAULT));
-                    mram_offset += (BL+2) * sizeof(int32_t);
-
-                }
-            }
-            if (rep >= p.n_warmup)
-                stop(&timer, 4);
-
-
+                DPU_ASSERT(dpu_prepare_xfer(dpu, itemsets_buffer + i * itemsets_bytes / sizeof(int32_t)));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, itemsets_bytes, DPU_XFER_DEFAULT));
+            pool_run(&pool, unpack_itemsets, &itemsets_xfer);
+            if (kernel == kernel4)
+                local_max(dpu_set, block_max, &best, nr_of_dpus, max_cols, diag, first_block, nr_of_blocks, blocks_per_dpu);
+            if (timed)
+                diagonal_stop(&timer, &long_diagonal_timer, &short_diagonal_timer, 4, longest, short_diagonal);
         }
 
-        // Traceback step
+        // Traceback step (linear-gap global scoring)
+        if (p.scoring != SCORING_LINEAR)
+            continue;
         if (rep >= p.n_warmup)
             start(&timer, 1, 1);
 #if PRINT_FILE
@@ -834,6 +926,8 @@ int main(int argc, char **argv) {
     print(&timer, 1, p.n_reps);
     printf("DPU-CPU ");
     print(&timer, 4, p.n_reps);
+    printf("Reference staging (overlapped with DPU Kernel) ");
+    print(&timer, 5, p.n_reps);
     printf("\n");
     printf("Longest Diagonal CPU-DPU ");
     print(&long_diagonal_timer, 2, p.n_reps);
@@ -844,6 +938,15 @@ int main(int argc, char **argv) {
     printf("Longest Diagonal DPU-CPU ");
     print(&long_diagonal_timer, 4, p.n_reps);
     printf("\n");
+    printf("Short Diagonals CPU-DPU ");
+    print(&short_diagonal_timer, 2, p.n_reps);
+    printf("Short Diagonals DPU Kernel ");
+    print(&short_diagonal_timer, 3, p.n_reps);
+    printf("Short Diagonals Inter-DPU ");
+    print(&short_diagonal_timer, 1, p.n_reps);
+    printf("Short Diagonals DPU-CPU ");
+    print(&short_diagonal_timer, 4, p.n_reps);
+    printf("\n");
     
 #if ENERGY
     printf("DPU Energy (J): %f \t ", tavg_energy / p.n_reps);
@@ -852,15 +955,22 @@ int main(int argc, char **argv) {
     // Check output
     bool status = true;
     for (uint64_t i = 1; i < max_rows; i++) {
-        for (uint64_t j = 1; j < max_cols; j++) {
-            if (input_itemsets_host[i*max_cols + j] != input_itemsets[i*(max_cols+1) + j]) {
+        for (uint64_t j = cell; j < max_cols * cell; j++) {
+            if (input_itemsets_host[i*max_cols*cell + j] != input_itemsets[i*(max_cols+1)*cell + j]) {
                 status = false;
 #if PRINT
-                printf("%ld (%ld, %ld): %d %d\n", i*max_cols + j, i, j, input_itemsets_host[i*max_cols + j], input_itemsets[i*(max_cols+1) + j]); 
+                printf("%ld (%ld, %ld): %d %d\n", i*max_cols*cell + j, i, j, input_itemsets_host[i*max_cols*cell + j], input_itemsets[i*(max_cols+1)*cell + j]); 
 #endif
             } 
         }
     }
+    if (p.scoring == SCORING_LOCAL) {
+        printf("Local alignment: score %d ending at (%u, %u)\n", best.score, best.cell / (unsigned int) max_cols, best.cell % (unsigned int) max_cols);
+        if (best.score != best_host.score)
+            status = false;
+    } else {
+        printf("Global alignment: score %d\n", input_itemsets[((max_rows-1)*(max_cols+1) + max_cols-1) * cell]);
+    }
     
     if (status) {
         printf("[" ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "] Outputs are equal\n");
@@ -873,6 +983,11 @@ int main(int argc, char **argv) {
     free(reference);
     free(traceback_output);
     free(traceback_output_host);
+    free(itemsets_buffer);
+    free(reference_buffer[0]);
+    free(reference_buffer[1]);
+    free(block_max);
+    pool_free(&pool);
     DPU_ASSERT(dpu_free(dpu_set));
     return status ? 0 : -1;
     return 0;
@@ -6,9 +6,38 @@ typedef struct {
     uint32_t nblocks;
     uint32_t active_blocks;
     uint32_t penalty;
+    uint32_t max_len; // Batch mode: maximum sequence length
+    uint32_t cigar; // Batch mode: CIGAR_NONE, CIGAR_FULL or CIGAR_LINEAR
+    uint32_t gap_open; // Affine-gap kernel: gap opening penalty (penalty is the extension)
+	enum kernels {
+	    kernel1 = 0, // Wavefront over one large matrix, linear-gap global
+	    kernel2 = 1, // Batch of independent pairs
+	    kernel3 = 2, // Wavefront, affine-gap global (Gotoh)
+	    kernel4 = 3, // Wavefront, local (Smith-Waterman)
+	    nr_kernels = 4,
+	} kernel;
     uint32_t dummy;
 } dpu_arguments_t;
 
+// Wavefront scoring schemes
+#define SCORING_LINEAR 0
+#define SCORING_AFFINE 1
+#define SCORING_LOCAL 2
+// Affine-gap kernel: int32_t per cell {H, E, F}. BL and BL_IN must be even
+#define AFFINE_CELL 3
+
+// Local kernel: maximum score of a block, and its cell (row * (BL+1) + column)
+typedef struct {
+    int32_t score;
+    uint32_t cell;
+} nw_max_t;
+
+// Batch mode: result of one alignment
+typedef struct {
+    int32_t score;
+    uint32_t cigar_len;
+} nw_result_t;
+
 #ifndef BL
 #define BL 16 
 #endif
@@ -32,6 +61,39 @@ int32_t maximum(int32_t a, int32_t b, int32_t c) {
         
 }
 
+// Batch mode: how CIGARs are computed
+#define CIGAR_NONE 0 // Only scores
+#define CIGAR_FULL 1 // Traceback directions stored in MRAM (quadratic space)
+#define CIGAR_LINEAR 2 // Hirschberg divide-and-conquer (linear space)
+
+// Batch mode: CIGAR operations, also used as traceback directions
+// Each CIGAR entry is (run length << 2) | op
+#define CIGAR_M 0 // Diagonal
+#define CIGAR_I 1 // Left (gap in the first sequence)
+#define CIGAR_D 2 // Up (gap in the second sequence)
+
+// Traceback direction of a cell, diagonal > left > up on ties
+uint8_t traceback_op(int32_t best, int32_t nw, int32_t w) {
+    if (best == nw)
+        return CIGAR_M;
+    if (best == w)
+        return CIGAR_I;
+    return CIGAR_D;
+}
+
+#define roundup8(n) (((n) + 7) & ~7)
+
+// Batch mode: MRAM/WRAM footprints
+// A pair is stored as {len_a, len_b, seq_a[max_len], seq_b[max_len]}
+#define BATCH_SEQ_BYTES(max_len) roundup8(max_len)
+#define BATCH_PAIR_BYTES(max_len) (2 * sizeof(uint32_t) + 2 * BATCH_SEQ_BYTES(max_len))
+#define BATCH_CIGAR_BYTES(max_len) (2 * (max_len) * sizeof(uint32_t))
+#define BATCH_STACK 32 // Hirschberg subproblems, enough for log2(max_len) levels
+// Pair, two score rows (reused as CIGAR buffer), one direction row and Hirschberg stack per tasklet
+#define BATCH_WRAM_BYTES(max_len) (BATCH_PAIR_BYTES(max_len) + 2 * ((max_len) + 2) * sizeof(int32_t) + BATCH_SEQ_BYTES(max_len) \
+                                   + BATCH_STACK * 4 * sizeof(uint32_t) + 2 * sizeof(uint32_t))
+#define BATCH_WRAM_LIMIT (48 << 10)
+
 #define DPU_CAPACITY (64 << 20) // A DPU's capacity is 64 MiB
 
 #define ANSI_COLOR_RED     "\x1b[31m"
@@ -39,6 +101,7 @@ int32_t maximum(int32_t a, int32_t b, int32_t c) {
 #define ANSI_COLOR_RESET   "\x1b[0m"
 
 #define LIMIT -999
+#define NEG_INF (-(1 << 28)) // Score of the cells outside the band
 
 int blosum62[24][24] = {
     { 4, -1, -2, -2,  0, -1, -1,  0, -2, -1, -1, -1, -1, -2, -1,  1,  0, -3, -2,  0, -2, -1,  0, -4},
@@ -67,7 +130,6 @@ int blosum62[24][24] = {
     {-4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,  1}
 };
 
-#define DYNAMIC 1
 #define PRINT 0
 #define PRINT_FILE 0
 #ifndef ENERGY
@@ -6,6 +6,13 @@
 typedef struct Params {
     unsigned int   max_rows;
     unsigned int   penalty;
+    unsigned int   band;
+    unsigned int   scoring;
+    unsigned int   gap_open;
+    unsigned int   n_pairs;
+    unsigned int   read_len;
+    unsigned int   cigar;
+    unsigned int   n_threads;
     unsigned int   n_warmup;
     unsigned int   n_reps;
 } Params;
@@ -22,6 +29,15 @@ static void usage() {
             "\nBenchmark-specific options:"
             "\n    -n <N>    size of sequence: length of the sequence"
             "\n    -p <P>    penalty: a positive integer"
+            "\n    -t <T>    # of host threads staging the blocks of each diagonal (default=4)"
+            "\n    -d <D>    band: only blocks within D cells of the main diagonal are computed (default=0, full matrix)"
+            "\n    -s <S>    scoring: linear-gap global (0), affine-gap global (1) or linear-gap local (2) (default=0)"
+            "\n    -o <O>    gap opening penalty of the affine-gap scoring, -p is the extension penalty (default=3)"
+            "\n"
+            "\nBatch mode options:"
+            "\n    -b <B>    # of independent sequence pairs (default=0, single-pair wavefront)"
+            "\n    -l <L>    maximum length of each sequence in a pair (default=128)"
+            "\n    -c <C>    only scores (0), CIGAR strings with full traceback (1) or with linear-space traceback (2) (default=0)"
             "\n");
 }
 
@@ -31,9 +47,16 @@ struct Params input_params(int argc, char **argv) {
     p.n_reps        = 3;
     p.max_rows      = 256;
     p.penalty       = 1;
+    p.band          = 0;
+    p.n_threads     = 4;
+    p.scoring       = SCORING_LINEAR;
+    p.gap_open      = 3;
+    p.n_pairs       = 0;
+    p.read_len      = 128;
+    p.cigar         = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hw:e:n:p:")) >= 0) {
+    while((opt = getopt(argc, argv, "hw:e:n:p:t:d:s:o:b:l:c:")) >= 0) {
         switch(opt) {
             case 'h':
                 usage();
@@ -43,6 +66,13 @@ struct Params input_params(int argc, char **argv) {
             case 'e': p.n_reps        = atoi(optarg); break;
             case 'n': p.max_rows      = atoi(optarg); break;
             case 'p': p.penalty       = atoi(optarg); break;
+            case 't': p.n_threads     = atoi(optarg); break;
+            case 'd': p.band          = atoi(optarg); break;
+            case 's': p.scoring       = atoi(optarg); break;
+            case 'o': p.gap_open      = atoi(optarg); break;
+            case 'b': p.n_pairs       = atoi(optarg); break;
+            case 'l': p.read_len      = atoi(optarg); break;
+            case 'c': p.cigar         = atoi(optarg); break;
             default:
                       fprintf(stderr, "\nUnrecognized option!\n");
                       usage();
@@ -50,6 +80,11 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    assert(p.cigar <= 2 && "Invalid CIGAR mode!");
+    assert(p.scoring <= SCORING_LOCAL && "Invalid scoring!");
+    assert((p.n_pairs == 0 || p.scoring == SCORING_LINEAR) && "Batch mode only supports linear-gap global scoring!");
+    assert((p.scoring != SCORING_AFFINE || BL % 2 == 0) && "Affine-gap scoring needs an even BL!");
+    assert(p.read_len > 0 && BATCH_SEQ_BYTES(p.read_len) <= 2048 && "Invalid sequence length!");
 
     return p;
 }
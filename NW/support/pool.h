@@ -0,0 +1,117 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <pthread.h>
+
+// Host thread pool. pool_run() executes job(arg, thread, nr_threads) on all threads
+// (the calling thread is thread 0) and returns when every thread has finished
+typedef void (*pool_job_t)(void *arg, unsigned int thread, unsigned int nr_threads);
+
+typedef struct Pool {
+    unsigned int    nr_threads;
+    pthread_t       *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t  start_cond;
+    pthread_cond_t  done_cond;
+    pool_job_t      job;
+    void            *arg;
+    unsigned int    generation;
+    unsigned int    pending;
+    int             exit;
+} Pool;
+
+typedef struct {
+    Pool         *pool;
+    unsigned int thread;
+} pool_worker_t;
+
+static void *pool_worker(void *ptr) {
+    pool_worker_t *worker = (pool_worker_t *) ptr;
+    Pool *pool = worker->pool;
+    unsigned int thread = worker->thread;
+    unsigned int generation = 0;
+    free(worker);
+    while (1) {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->generation == generation && !pool->exit)
+            pthread_cond_wait(&pool->start_cond, &pool->mutex);
+        if (pool->exit) {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        pool->job(pool->arg, thread, pool->nr_threads);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done_cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+void pool_init(Pool *pool, unsigned int nr_threads) {
+    pool->nr_threads = nr_threads > 0 ? nr_threads : 1;
+    pool->threads = (pthread_t *) malloc(pool->nr_threads * sizeof(pthread_t));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->exit = 0;
+    for (unsigned int t = 1; t < pool->nr_threads; t++) {
+        pool_worker_t *worker = (pool_worker_t *) malloc(sizeof(pool_worker_t));
+        worker->pool = pool;
+        worker->thread = t;
+        pthread_create(&pool->threads[t], NULL, pool_worker, worker);
+    }
+}
+
+// pool_start() hands the job to threads 1..nr_threads-1 and returns. The caller runs
+// job(arg, 0, nr_threads) itself and then waits for the others with pool_wait()
+void pool_start(Pool *pool, pool_job_t job, void *arg) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->job = job;
+    pool->arg = arg;
+    pool->pending = pool->nr_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void pool_wait(Pool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void pool_run(Pool *pool, pool_job_t job, void *arg) {
+    pool_start(pool, job, arg);
+    job(arg, 0, pool->nr_threads);
+    pool_wait(pool);
+}
+
+void pool_free(Pool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->exit = 1;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (unsigned int t = 1; t < pool->nr_threads; t++)
+        pthread_join(pool->threads[t], NULL);
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->start_cond);
+    pthread_cond_destroy(&pool->done_cond);
+}
+
+// Range [*first, *last) of n items assigned to one thread
+static inline void pool_range(uint64_t n, unsigned int thread, unsigned int nr_threads, uint64_t *first, uint64_t *last) {
+    uint64_t chunk = n / nr_threads;
+    uint64_t rest = n % nr_threads;
+    *first = thread * chunk + (thread < rest ? thread : rest);
+    *last = *first + chunk + (thread < rest);
+}
+
+#endif
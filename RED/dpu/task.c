@@ -18,23 +18,110 @@ __host dpu_arguments_t DPU_INPUT_ARGUMENTS;
 __host dpu_results_t DPU_RESULTS[NR_TASKLETS];
 
 // Array for communication between adjacent tasklets
-T message[NR_TASKLETS];
+red_t message[NR_TASKLETS];
+uint32_t message_rows[NR_TASKLETS];
+uint32_t message_partial_rows;
 
-// Reduction in each tasklet
-static T reduction(T *input, unsigned int l_size){
-    T output = 0;
+// Reduction in each tasklet: all aggregates of the operator in one pass over the block
+static void reduction(red_t *output, T *input, unsigned int l_size, uint32_t index){
     for (unsigned int j = 0; j < l_size; j++){
-        output += input[j];
+        red_element(output, input[j], index + j);
+    }
+}
+
+// Reduction in each tasklet over runs, from row index on
+static void reduction_runs(red_t *output, run_t *input, unsigned int l_size, uint32_t index){
+    for (unsigned int j = 0; j < l_size; j++){
+        if(input[j].length > 0)
+            red_run(output, input[j].value, input[j].length, index);
+        index += input[j].length;
     }
-    return output;
 }
 
 // Barrier
 BARRIER_INIT(my_barrier, NR_TASKLETS);
 
+// Reduce the local counts of all tasklets into the result of tasklet 0
+static void reduce_tasklets(red_t *l_count, dpu_results_t *result, unsigned int tasklet_id){
+    message[tasklet_id] = *l_count;
+
+#if PERF && PERF_SYNC // TIMER FOR SYNC PRIMITIVES
+    result->cycles = 0;
+    perfcounter_cycles cycles;
+    timer_start(&cycles); // START TIMER
+#endif
+#ifdef TREE // Tree-based reduction
+#ifdef BARRIER
+    // Barrier
+    barrier_wait(&my_barrier);
+#endif
+
+    #pragma unroll
+    for (unsigned int offset = 1; offset < NR_TASKLETS; offset <<= 1){
+
+        if((tasklet_id & (2*offset - 1)) == 0){
+#ifndef BARRIER
+            // Wait
+            handshake_wait_for(tasklet_id + offset);
+#endif
+            red_combine(&message[tasklet_id], &message[tasklet_id + offset]);
+        }
+
+#ifdef BARRIER
+        // Barrier
+        barrier_wait(&my_barrier);
+#else
+        else if ((tasklet_id & (offset - 1)) == 0){ // Ensure that wait and notify are in pair
+            // Notify
+            handshake_notify();
+        }
+#endif
+
+    }
+
+#else  // Single-thread reduction
+    // Barrier
+    barrier_wait(&my_barrier);
+    if(tasklet_id == 0)
+        #pragma unroll
+        for (unsigned int each_tasklet = 1; each_tasklet < NR_TASKLETS; each_tasklet++){
+            red_combine(&message[0], &message[each_tasklet]);
+        }
+#endif
+#if PERF && PERF_SYNC // TIMER FOR SYNC PRIMITIVES
+    result->cycles = timer_stop(&cycles); // STOP TIMER
+#endif
+
+    // Total count in this DPU
+    if(tasklet_id == 0){
+        result->t_count = message[tasklet_id];
+    }
+}
+
+// Handshake with adjacent tasklets. Returns the first row of the block of this tasklet
+static uint32_t handshake_rows(uint32_t l_rows, unsigned int tasklet_id){
+    uint32_t p_rows;
+    // Wait and read message
+    if(tasklet_id != 0){
+        handshake_wait_for(tasklet_id - 1);
+        p_rows = message_rows[tasklet_id];
+    }
+    else
+        p_rows = message_partial_rows;
+    // Write message and notify
+    if(tasklet_id < NR_TASKLETS - 1){
+        message_rows[tasklet_id + 1] = p_rows + l_rows;
+        handshake_notify();
+    }
+    else
+        message_partial_rows = p_rows + l_rows;
+    return p_rows;
+}
+
 extern int main_kernel1(void);
+extern int main_kernel2(void);
 
-int (*kernels[nr_kernels])(void) = {main_kernel1};
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2};
 
 int main(void) { 
     // Kernel
@@ -73,7 +160,8 @@ int main_kernel1() {
     T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
 	
     // Local count
-    T l_count = 0;
+    red_t l_count;
+    red_init(&l_count);
 
 #if !PERF_SYNC // COMMENT OUT TO COMPARE SYNC PRIMITIVES (Experiment in Appendix)
     for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
@@ -85,66 +173,81 @@ int main_kernel1() {
         mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, l_size_bytes);
 		
         // Reduction in each tasklet
-        l_count += reduction(cache_A, l_size_bytes >> DIV);
+        reduction(&l_count, cache_A, l_size_bytes >> DIV, byte_index >> DIV);
 
     }
 #endif
 
     // Reduce local counts
-    message[tasklet_id] = l_count;
+    reduce_tasklets(&l_count, result, tasklet_id);
 
-#if PERF && PERF_SYNC // TIMER FOR SYNC PRIMITIVES
-    result->cycles = 0;
-    perfcounter_cycles cycles;
-    timer_start(&cycles); // START TIMER
+#if PERF && !PERF_SYNC
+    result->cycles = timer_stop(&cycles); // STOP TIMER
 #endif
-#ifdef TREE // Tree-based reduction
-#ifdef BARRIER
+
+    return 0;
+}
+
+// main_kernel2: run-length encoded input. The host pads the runs of every DPU to the same number of
+// blocks per tasklet, so that all tasklets take part in the handshake of each round
+int main_kernel2() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+        message_partial_rows = 0;
+#if PERF
+        perfcounter_config(COUNT_CYCLES, true);
+#endif
+    }
     // Barrier
     barrier_wait(&my_barrier);
+
+    dpu_results_t *result = &DPU_RESULTS[tasklet_id];
+#if PERF && !PERF_SYNC
+    result->cycles = 0;
+    perfcounter_cycles cycles;
+    timer_start(&cycles); // START TIMER
 #endif
 
-    #pragma unroll
-    for (unsigned int offset = 1; offset < NR_TASKLETS; offset <<= 1){
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size; // Runs per DPU in bytes
 
-        if((tasklet_id & (2*offset - 1)) == 0){
-#ifndef BARRIER
-            // Wait
-            handshake_wait_for(tasklet_id + offset);
-#endif
-            message[tasklet_id] += message[tasklet_id + offset];
+    // Address of the current processing block in MRAM
+    uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
+    uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
+
+    // Initialize a local cache to store the MRAM block
+    run_t *cache_A = (run_t *) mem_alloc(BLOCK_SIZE);
+
+    // Local count
+    red_t l_count;
+    red_init(&l_count);
+
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+
+        // Load cache with current MRAM block
+        mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, BLOCK_SIZE);
+
+        // Rows of the block, and first row after the preceding blocks
+        uint32_t l_rows = 0;
+        for (unsigned int j = 0; j < RUNS; j++){
+            l_rows += cache_A[j].length;
         }
+        uint32_t p_rows = handshake_rows(l_rows, tasklet_id);
 
-#ifdef BARRIER
         // Barrier
         barrier_wait(&my_barrier);
-#else
-        else if ((tasklet_id & (offset - 1)) == 0){ // Ensure that wait and notify are in pair
-            // Notify
-            handshake_notify();
-        }
-#endif
-
-    }
 
-#else  // Single-thread reduction
-    // Barrier
-    barrier_wait(&my_barrier);
-    if(tasklet_id == 0)
-        #pragma unroll
-        for (unsigned int each_tasklet = 1; each_tasklet < NR_TASKLETS; each_tasklet++){
-            message[0] += message[each_tasklet];
-        }
-#endif
-#if PERF && PERF_SYNC // TIMER FOR SYNC PRIMITIVES
-    result->cycles = timer_stop(&cycles); // STOP TIMER
-#endif
+        // Reduction in each tasklet
+        reduction_runs(&l_count, cache_A, RUNS, p_rows);
 
-    // Total count in this DPU
-    if(tasklet_id == 0){
-        result->t_count = message[tasklet_id];
     }
 
+    // Reduce local counts
+    reduce_tasklets(&l_count, result, tasklet_id);
+
 #if PERF && !PERF_SYNC
     result->cycles = timer_stop(&cycles); // STOP TIMER
 #endif
@@ -16,6 +16,7 @@
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 // Define the DPU Binary path as DPU_BINARY here
 #ifndef DPU_BINARY
@@ -28,25 +29,77 @@
 
 // Pointer declaration
 static T* A;
+static run_t* runs;
 
-// Create input arrays
-static void read_input(T* A, unsigned int nr_elements) {
+// Create input arrays. With run_length > 0, runs of 1 to 2 * run_length - 1 equal elements
+static void read_input(T* A, unsigned int nr_elements, unsigned int run_length) {
     srand(0);
     printf("nr_elements\t%u\t", nr_elements);
+    unsigned int left = 0;
+    T value = 0;
     for (unsigned int i = 0; i < nr_elements; i++) {
-        A[i] = (T)(rand());
+        if (run_length == 0) {
+            A[i] = (T)(rand());
+            continue;
+        }
+        if (left == 0) {
+            value = (T)(rand());
+            left = 1 + rand() % (2 * run_length - 1);
+        }
+        A[i] = value;
+        left--;
+    }
+}
+
+// Run-length encoding of A[first .. last - 1]. Returns the number of runs (runs may be NULL to count them)
+static unsigned int rle_host(run_t* runs, T* A, unsigned int first, unsigned int last) {
+    unsigned int nr_runs = 0;
+    for (unsigned int i = first; i < last; i++) {
+        if (i == first || A[i] != A[i - 1]) {
+            if (runs != NULL) {
+                runs[nr_runs].value = A[i];
+                runs[nr_runs].length = 0;
+            }
+            nr_runs++;
+        }
+        if (runs != NULL)
+            runs[nr_runs - 1].length++;
     }
+    return nr_runs;
 }
 
 // Compute output in the host
-static T reduction_host(T* A, unsigned int nr_elements) {
-    T count = 0;
+static red_t reduction_host(T* A, unsigned int nr_elements) {
+    red_t count;
+    red_init(&count);
     for (unsigned int i = 0; i < nr_elements; i++) {
-        count += A[i];
+        red_element(&count, A[i], i);
     }
     return count;
 }
 
+// Inter-DPU reduction: one host thread per rank reduces the results of its DPUs
+typedef struct {
+    dpu_results_t *results;
+    unsigned int  nr_results; // Results retrieved per DPU
+    unsigned int  *rank_first; // First DPU of each rank (nr_ranks + 1 entries)
+    unsigned int  dpu_elements; // Elements per DPU, to offset the indices of the results
+    red_t         *rank_count;
+} rank_args_t;
+
+static void reduction_rank(void *arg, unsigned int rank, unsigned int nr_ranks) {
+    rank_args_t *r = (rank_args_t *) arg;
+    red_t count;
+    red_init(&count);
+    for (unsigned int i = r->rank_first[rank]; i < r->rank_first[rank + 1]; i++) {
+        red_t t_count = r->results[i * r->nr_results].t_count;
+        red_offset(&t_count, r->dpu_elements * i);
+        red_combine(&count, &t_count);
+    }
+    r->rank_count[rank] = count;
+    (void) nr_ranks;
+}
+
 // Main of the Host Application
 int main(int argc, char **argv) {
 
@@ -66,6 +119,21 @@ int main(int argc, char **argv) {
     DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
     printf("Allocated %d DPU(s)\n", nr_of_dpus);
 
+    // DPUs of each rank, reduced by one host thread per rank
+    struct dpu_set_t rank;
+    uint32_t nr_of_ranks, each_rank;
+    DPU_ASSERT(dpu_get_nr_ranks(dpu_set, &nr_of_ranks));
+    unsigned int rank_first[nr_of_ranks + 1];
+    red_t rank_count[nr_of_ranks];
+    rank_first[0] = 0;
+    DPU_RANK_FOREACH(dpu_set, rank, each_rank) {
+        uint32_t nr_rank_dpus;
+        DPU_ASSERT(dpu_get_nr_dpus(rank, &nr_rank_dpus));
+        rank_first[each_rank + 1] = rank_first[each_rank] + nr_rank_dpus;
+    }
+    Pool pool;
+    pool_init(&pool, nr_of_ranks);
+
     unsigned int i = 0;
 #if PERF
     double cc = 0;
@@ -82,16 +150,39 @@ int main(int argc, char **argv) {
     // Input/output allocation
     A = malloc(input_size_dpu_8bytes * nr_of_dpus * sizeof(T));
     T *bufferA = A;
-    T count = 0;
-    T count_host = 0;
+    red_t count;
+    red_init(&count);
+    red_t count_host;
 
     // Create an input file with arbitrary data
-    read_input(A, input_size);
+    read_input(A, input_size, p.run_length);
+
+    // Run-length encoding of the rows of each DPU. The runs of all DPUs are padded with empty runs
+    // to the same number of blocks per tasklet
+    unsigned int runs_dpu = 0;
+    if(p.run_length > 0) {
+        for(i = 0; i < nr_of_dpus; i++) {
+            unsigned int first = input_size_dpu_8bytes * i;
+            unsigned int last = first + input_size_dpu_8bytes < input_size ? first + input_size_dpu_8bytes : input_size;
+            unsigned int nr_runs = first < input_size ? rle_host(NULL, A, first, last) : 0;
+            if(nr_runs > runs_dpu)
+                runs_dpu = nr_runs;
+        }
+        runs_dpu = (runs_dpu % (NR_TASKLETS * RUNS) != 0) ? roundup(runs_dpu, (NR_TASKLETS * RUNS)) : runs_dpu;
+        runs = calloc((uint64_t) runs_dpu * nr_of_dpus, sizeof(run_t));
+        for(i = 0; i < nr_of_dpus; i++) {
+            unsigned int first = input_size_dpu_8bytes * i;
+            unsigned int last = first + input_size_dpu_8bytes < input_size ? first + input_size_dpu_8bytes : input_size;
+            if(first < input_size)
+                rle_host(runs + (uint64_t) runs_dpu * i, A, first, last);
+        }
+        printf("Input (MB)\t%f\tRLE (MB)\t%f\n", (double) input_size_dpu_8bytes * nr_of_dpus * sizeof(T) / (1 << 20), (double) runs_dpu * nr_of_dpus * sizeof(run_t) / (1 << 20));
+    }
 
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\n", NR_TASKLETS, BL);
+    printf("NR_TASKLETS\t%d\tBL\t%d\tinput\t%s\n", NR_TASKLETS, BL, p.run_length > 0 ? "rle" : "plain");
 
     // Loop over main kernel
     for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
@@ -106,26 +197,38 @@ int main(int argc, char **argv) {
         printf("Load input data\n");
         if(rep >= p.n_warmup)
             start(&timer, 1, rep - p.n_warmup);
-        count = 0;
+        red_init(&count);
         // Input arguments
-        unsigned int kernel = 0;
-        dpu_arguments_t input_arguments[NR_DPUS];
+        unsigned int kernel = p.run_length > 0 ? kernel2 : kernel1;
+        dpu_arguments_t input_arguments[nr_of_dpus];
         for(i=0; i<nr_of_dpus-1; i++) {
             input_arguments[i].size=input_size_dpu_8bytes * sizeof(T); 
             input_arguments[i].kernel=kernel;
         }
         input_arguments[nr_of_dpus-1].size=(input_size_8bytes - input_size_dpu_8bytes * (NR_DPUS-1)) * sizeof(T); 
         input_arguments[nr_of_dpus-1].kernel=kernel;		
+        if(p.run_length > 0) {
+            for(i=0; i<nr_of_dpus; i++)
+                input_arguments[i].size=runs_dpu * sizeof(run_t);
+        }
         // Copy input arrays
         i = 0;
         DPU_FOREACH(dpu_set, dpu, i) {
             DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
         }
         DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
-        DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + input_size_dpu_8bytes * i));
+        if(p.run_length > 0) {
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, runs + (uint64_t) runs_dpu * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, runs_dpu * sizeof(run_t), DPU_XFER_DEFAULT));
+        }
+        else {
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + input_size_dpu_8bytes * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, input_size_dpu_8bytes * sizeof(T), DPU_XFER_DEFAULT));
         }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, input_size_dpu_8bytes * sizeof(T), DPU_XFER_DEFAULT));
         if(rep >= p.n_warmup)
             stop(&timer, 1);
 
@@ -159,49 +262,45 @@ int main(int argc, char **argv) {
 #endif
 
         printf("Retrieve results\n");
+#if PERF
         dpu_results_t results[nr_of_dpus];
-        T* results_count = malloc(nr_of_dpus * sizeof(T));
+        const unsigned int nr_results = NR_TASKLETS; // Cycles of all tasklets
+#else
+        const unsigned int nr_results = 1; // Tasklet 0 holds the result of the DPU
+#endif
+        dpu_results_t* results_retrieve = (dpu_results_t*)malloc(nr_of_dpus * nr_results * sizeof(dpu_results_t));
         if(rep >= p.n_warmup)
             start(&timer, 3, rep - p.n_warmup);
         i = 0;
         // PARALLEL RETRIEVE TRANSFER
-        dpu_results_t* results_retrieve[nr_of_dpus];
-
         DPU_FOREACH(dpu_set, dpu, i) {
-            results_retrieve[i] = (dpu_results_t*)malloc(NR_TASKLETS * sizeof(dpu_results_t));
-            DPU_ASSERT(dpu_prepare_xfer(dpu, results_retrieve[i]));
+            DPU_ASSERT(dpu_prepare_xfer(dpu, results_retrieve + i * nr_results));
         }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, "DPU_RESULTS", 0, NR_TASKLETS * sizeof(dpu_results_t), DPU_XFER_DEFAULT));
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, "DPU_RESULTS", 0, nr_results * sizeof(dpu_results_t), DPU_XFER_DEFAULT));
+        if(rep >= p.n_warmup)
+            stop(&timer, 3);
 
-        DPU_FOREACH(dpu_set, dpu, i) {
-            // Retrieve tasklet timings
-            for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
-                if(each_tasklet == 0)
-                    results[i].t_count = results_retrieve[i][each_tasklet].t_count;
-            }
-#if !PERF
-            free(results_retrieve[i]);
-#endif
-            // Sequential reduction
-            count += results[i].t_count;
-#if PRINT
-            printf("i=%d -- %lu\n", i, count);
-#endif
+        if(rep >= p.n_warmup)
+            start(&timer, 4, rep - p.n_warmup);
+        // Per-rank partials in parallel, then across ranks, with the same operator as the DPUs
+        rank_args_t rank_args = {results_retrieve, nr_results, rank_first, input_size_dpu_8bytes, rank_count};
+        pool_run(&pool, reduction_rank, &rank_args);
+        for(each_rank = 0; each_rank < nr_of_ranks; each_rank++) {
+            red_combine(&count, &rank_count[each_rank]);
         }
+        if(rep >= p.n_warmup)
+            stop(&timer, 4);
 
 #if PERF
         DPU_FOREACH(dpu_set, dpu, i) {
             results[i].cycles = 0;
             // Retrieve tasklet timings
             for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
-                if (results_retrieve[i][each_tasklet].cycles > results[i].cycles)
-                    results[i].cycles = results_retrieve[i][each_tasklet].cycles;
+                if (results_retrieve[i * nr_results + each_tasklet].cycles > results[i].cycles)
+                    results[i].cycles = results_retrieve[i * nr_results + each_tasklet].cycles;
             }
-            free(results_retrieve[i]);
         }
 #endif
-        if(rep >= p.n_warmup)
-            stop(&timer, 3);
 
 #if PERF
         uint64_t max_cycles = 0;
@@ -222,7 +321,7 @@ int main(int argc, char **argv) {
 #endif
 
         // Free memory
-        free(results_count);
+        free(results_retrieve);
     }
 #if PERF
     printf("DPU cycles  = %g cc\n", cc / p.n_reps);
@@ -235,8 +334,10 @@ int main(int argc, char **argv) {
     print(&timer, 1, p.n_reps);
     printf("DPU Kernel ");
     print(&timer, 2, p.n_reps);
-    printf("Inter-DPU ");
+    printf("DPU-CPU ");
     print(&timer, 3, p.n_reps);
+    printf("Inter-DPU ");
+    print(&timer, 4, p.n_reps);
 
     #if ENERGY
     double energy;
@@ -246,7 +347,7 @@ int main(int argc, char **argv) {
 
     // Check output
     bool status = true;
-    if(count != count_host) status = false;
+    if(!red_equal(&count, &count_host)) status = false;
     if (status) {
         printf("[" ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "] Outputs are equal\n");
     } else {
@@ -254,7 +355,9 @@ int main(int argc, char **argv) {
     }
 
     // Deallocation
+    pool_free(&pool);
     free(A);
+    free(runs);
     DPU_ASSERT(dpu_free(dpu_set));
 	
     return status ? 0 : -1;
@@ -15,27 +15,43 @@
 #ifdef UINT32
 #define T uint32_t
 #define DIV 2 // Shift right to divide by sizeof(T)
+#define T_MIN 0
+#define T_MAX UINT32_MAX
 #elif UINT64
 #define T uint64_t
 #define DIV 3 // Shift right to divide by sizeof(T)
+#define T_MIN 0
+#define T_MAX UINT64_MAX
 #elif INT32
 #define T int32_t
 #define DIV 2 // Shift right to divide by sizeof(T)
+#define T_MIN INT32_MIN
+#define T_MAX INT32_MAX
 #elif INT64
 #define T int64_t
 #define DIV 3 // Shift right to divide by sizeof(T)
+#define T_MIN INT64_MIN
+#define T_MAX INT64_MAX
 #elif FLOAT
 #define T float
 #define DIV 2 // Shift right to divide by sizeof(T)
+#define T_MIN (-FLT_MAX)
+#define T_MAX FLT_MAX
 #elif DOUBLE
 #define T double
 #define DIV 3 // Shift right to divide by sizeof(T)
+#define T_MIN (-DBL_MAX)
+#define T_MAX DBL_MAX
 #elif CHAR
 #define T char
 #define DIV 0 // Shift right to divide by sizeof(T)
+#define T_MIN CHAR_MIN
+#define T_MAX CHAR_MAX
 #elif SHORT
 #define T short
 #define DIV 1 // Shift right to divide by sizeof(T)
+#define T_MIN SHRT_MIN
+#define T_MAX SHRT_MAX
 #endif
 
 // Structures used by both the host and the dpu to communicate information
@@ -43,14 +59,24 @@ typedef struct {
     uint32_t size;
 	enum kernels {
 	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel2 = 1,
+	    nr_kernels = 2,
 	} kernel;
     T t_count;
 } dpu_arguments_t;
 
+// Run of equal values of a run-length encoded input. Each run is reduced at once
+typedef struct {
+    T value;
+    uint32_t length;
+} run_t;
+#define RUNS (BLOCK_SIZE / sizeof(run_t)) // Runs in a block
+
+#include "operators.h"
+
 typedef struct {
     uint64_t cycles;
-    T t_count;
+    red_t t_count;
 } dpu_results_t;
 
 #ifndef PERF
@@ -0,0 +1,129 @@
+#ifndef _OPERATORS_H_
+#define _OPERATORS_H_
+
+#include <limits.h>
+#include <float.h>
+
+// Reduction operators, shared by the DPU (per block, per tasklet) and the host (across DPUs).
+// The operator is selected at compile time with OP; OP_FUSED computes several aggregates
+// in a single pass over each MRAM block
+#if defined(OP_MIN)
+#define RED_AGGREGATES(X) X(min)
+#elif defined(OP_MAX)
+#define RED_AGGREGATES(X) X(max)
+#elif defined(OP_ARGMIN)
+#define RED_AGGREGATES(X) X(argmin)
+#elif defined(OP_ARGMAX)
+#define RED_AGGREGATES(X) X(argmax)
+#elif defined(OP_SUMSQ)
+#define RED_AGGREGATES(X) X(sumsq)
+#elif defined(OP_FUSED)
+#define RED_AGGREGATES(X) X(sum) X(sumsq) X(min) X(max) X(argmin) X(argmax)
+#else
+#ifndef OP_SUM
+#define OP_SUM
+#endif
+#define RED_AGGREGATES(X) X(sum)
+#endif
+
+// Fields of the accumulator
+#define RED_FIELD_sum    T sum;
+#define RED_FIELD_sumsq  T sumsq;
+#define RED_FIELD_min    T min;
+#define RED_FIELD_max    T max;
+#define RED_FIELD_argmin T argmin_value; uint32_t argmin;
+#define RED_FIELD_argmax T argmax_value; uint32_t argmax;
+
+// Identity
+#define RED_INIT_sum(r)    (r)->sum = 0;
+#define RED_INIT_sumsq(r)  (r)->sumsq = 0;
+#define RED_INIT_min(r)    (r)->min = T_MAX;
+#define RED_INIT_max(r)    (r)->max = T_MIN;
+#define RED_INIT_argmin(r) (r)->argmin_value = T_MAX; (r)->argmin = UINT32_MAX;
+#define RED_INIT_argmax(r) (r)->argmax_value = T_MIN; (r)->argmax = UINT32_MAX;
+
+// Accumulate element v at index i. The first index wins on ties
+#define RED_ELEMENT_sum(r, v, i)    (r)->sum += (v);
+#define RED_ELEMENT_sumsq(r, v, i)  (r)->sumsq += (v) * (v);
+#define RED_ELEMENT_min(r, v, i)    if ((v) < (r)->min) (r)->min = (v);
+#define RED_ELEMENT_max(r, v, i)    if ((v) > (r)->max) (r)->max = (v);
+#define RED_ELEMENT_argmin(r, v, i) if ((v) < (r)->argmin_value) { (r)->argmin_value = (v); (r)->argmin = (i); }
+#define RED_ELEMENT_argmax(r, v, i) if ((v) > (r)->argmax_value) { (r)->argmax_value = (v); (r)->argmax = (i); }
+
+// Accumulate a run of n equal elements v from index i on
+#define RED_RUN_sum(r, v, n, i)    (r)->sum += (v) * (T)(n);
+#define RED_RUN_sumsq(r, v, n, i)  (r)->sumsq += (v) * (v) * (T)(n);
+#define RED_RUN_min(r, v, n, i)    RED_ELEMENT_min(r, v, i)
+#define RED_RUN_max(r, v, n, i)    RED_ELEMENT_max(r, v, i)
+#define RED_RUN_argmin(r, v, n, i) RED_ELEMENT_argmin(r, v, i)
+#define RED_RUN_argmax(r, v, n, i) RED_ELEMENT_argmax(r, v, i)
+
+// Combine partial result o into r
+#define RED_COMBINE_sum(r, o)    (r)->sum += (o)->sum;
+#define RED_COMBINE_sumsq(r, o)  (r)->sumsq += (o)->sumsq;
+#define RED_COMBINE_min(r, o)    if ((o)->min < (r)->min) (r)->min = (o)->min;
+#define RED_COMBINE_max(r, o)    if ((o)->max > (r)->max) (r)->max = (o)->max;
+#define RED_COMBINE_argmin(r, o) \
+    if ((o)->argmin_value < (r)->argmin_value || ((o)->argmin_value == (r)->argmin_value && (o)->argmin < (r)->argmin)) { \
+        (r)->argmin_value = (o)->argmin_value; (r)->argmin = (o)->argmin; }
+#define RED_COMBINE_argmax(r, o) \
+    if ((o)->argmax_value > (r)->argmax_value || ((o)->argmax_value == (r)->argmax_value && (o)->argmax < (r)->argmax)) { \
+        (r)->argmax_value = (o)->argmax_value; (r)->argmax = (o)->argmax; }
+
+// Move indices of a partial result computed from element offset on
+#define RED_OFFSET_sum(r, offset)
+#define RED_OFFSET_sumsq(r, offset)
+#define RED_OFFSET_min(r, offset)
+#define RED_OFFSET_max(r, offset)
+#define RED_OFFSET_argmin(r, offset) if ((r)->argmin != UINT32_MAX) (r)->argmin += (offset);
+#define RED_OFFSET_argmax(r, offset) if ((r)->argmax != UINT32_MAX) (r)->argmax += (offset);
+
+// Equality of two results
+#define RED_EQUAL_sum(a, b)    ((a)->sum == (b)->sum) &&
+#define RED_EQUAL_sumsq(a, b)  ((a)->sumsq == (b)->sumsq) &&
+#define RED_EQUAL_min(a, b)    ((a)->min == (b)->min) &&
+#define RED_EQUAL_max(a, b)    ((a)->max == (b)->max) &&
+#define RED_EQUAL_argmin(a, b) ((a)->argmin_value == (b)->argmin_value && (a)->argmin == (b)->argmin) &&
+#define RED_EQUAL_argmax(a, b) ((a)->argmax_value == (b)->argmax_value && (a)->argmax == (b)->argmax) &&
+
+#define RED_FIELD(a) RED_FIELD_##a
+typedef struct {
+    RED_AGGREGATES(RED_FIELD)
+} red_t;
+
+#define RED_INIT(a) RED_INIT_##a(r)
+static inline void red_init(red_t *r) {
+    RED_AGGREGATES(RED_INIT)
+}
+
+#define RED_ELEMENT(a) RED_ELEMENT_##a(r, v, i)
+static inline void red_element(red_t *r, T v, uint32_t i) {
+    RED_AGGREGATES(RED_ELEMENT)
+    (void) i;
+}
+
+#define RED_RUN(a) RED_RUN_##a(r, v, n, i)
+static inline void red_run(red_t *r, T v, uint32_t n, uint32_t i) {
+    RED_AGGREGATES(RED_RUN)
+    (void) n;
+    (void) i;
+}
+
+#define RED_COMBINE(a) RED_COMBINE_##a(r, o)
+static inline void red_combine(red_t *r, const red_t *o) {
+    RED_AGGREGATES(RED_COMBINE)
+}
+
+#define RED_OFFSET(a) RED_OFFSET_##a(r, offset)
+static inline void red_offset(red_t *r, uint32_t offset) {
+    RED_AGGREGATES(RED_OFFSET)
+    (void) r;
+    (void) offset;
+}
+
+#define RED_EQUAL(a) RED_EQUAL_##a(x, y)
+static inline int red_equal(const red_t *x, const red_t *y) {
+    return RED_AGGREGATES(RED_EQUAL) 1;
+}
+
+#endif
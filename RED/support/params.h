@@ -8,6 +8,7 @@ typedef struct Params {
     int   n_warmup;
     int   n_reps;
     int  exp;
+    unsigned int   run_length;
 }Params;
 
 static void usage() {
@@ -22,6 +23,7 @@ static void usage() {
         "\n"
         "\nBenchmark-specific options:"
         "\n    -i <I>    input size (default=6553600 elements)"
+        "\n    -l <L>    run-length encoded input with runs of L elements on average (default=0, plain input)"
         "\n");
 }
 
@@ -31,9 +33,10 @@ struct Params input_params(int argc, char **argv) {
     p.n_warmup      = 1;
     p.n_reps        = 3;
     p.exp           = 0;
+    p.run_length    = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hi:w:e:x:")) >= 0) {
+    while((opt = getopt(argc, argv, "hi:w:e:x:l:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
@@ -43,6 +46,7 @@ struct Params input_params(int argc, char **argv) {
         case 'w': p.n_warmup      = atoi(optarg); break;
         case 'e': p.n_reps        = atoi(optarg); break;
         case 'x': p.exp           = atoi(optarg); break;
+        case 'l': p.run_length    = atoi(optarg); break;
         default:
             fprintf(stderr, "\nUnrecognized option!\n");
             usage();
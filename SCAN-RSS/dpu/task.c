@@ -19,27 +19,53 @@ __host dpu_results_t DPU_RESULTS[NR_TASKLETS];
 // Array for communication between adjacent tasklets
 T message[NR_TASKLETS];
 T message_partial_count;
+uint32_t message_first_head[NR_TASKLETS];
+uint32_t message_last_head[NR_TASKLETS];
 
-// Reduction in each tasklet
-static T reduction(T *input){
-    T output = 0;
+// Reduction in each tasklet, from element first on
+static T reduction(T *input, unsigned int first){
+    T output = SCAN_IDENTITY;
     #pragma unroll
-    for(unsigned int j = 0; j < REGS; j++) {
-        output += input[j];
+    for(unsigned int j = first; j < REGS; j++) {
+        output = scan_op(output, input[j]);
     }
     return output;
 }
-// Scan in each tasklet
-static T scan(T *output, T *input){
-    output[0] = input[0];
+// Scan in each tasklet. Returns the aggregate of the block (from its last head flag on, if any);
+// *l_open is the number of leading elements that still need the prefix of the preceding blocks
+static T scan(T *output, T *input, uint8_t *heads, unsigned int *l_open){
+    T acc = SCAN_IDENTITY;
+    unsigned int open = REGS;
     #pragma unroll
-    for(unsigned int j = 1; j < REGS; j++) {
-        output[j] = output[j - 1] + input[j];
+    for(unsigned int j = 0; j < REGS; j++) {
+#if SEGMENTED
+        if(heads[j]){
+            acc = SCAN_IDENTITY;
+            if(open == REGS)
+                open = j;
+        }
+#endif
+#if EXCLUSIVE
+        output[j] = acc;
+        acc = scan_op(acc, input[j]);
+#else
+        acc = scan_op(acc, input[j]);
+        output[j] = acc;
+#endif
     }
-    return output[REGS - 1];
+    (void) heads;
+    *l_open = open;
+    return acc;
 }
-// Handshake with adjacent tasklets
-static T handshake_sync(T l_count, unsigned int tasklet_id){
+
+// Prefix after a block, given the prefix before it
+static inline T carry(T p_count, T l_count, unsigned int l_open){
+    return l_open < REGS ? l_count : scan_op(p_count, l_count);
+}
+
+#ifndef LOOKBACK
+// Handshake with adjacent tasklets. Returns the prefix of the block of this tasklet
+static T handshake_sync(T l_count, unsigned int l_open, unsigned int tasklet_id){
     T p_count;
     // Wait and read message
     if(tasklet_id != 0){
@@ -47,23 +73,81 @@ static T handshake_sync(T l_count, unsigned int tasklet_id){
         p_count = message[tasklet_id];
     }
     else
-        p_count = 0;
+        p_count = message_partial_count;
     // Write message and notify
     if(tasklet_id < NR_TASKLETS - 1){
-        message[tasklet_id + 1] = p_count + l_count;
+        message[tasklet_id + 1] = carry(p_count, l_count, l_open);
         handshake_notify();
     }
+    else
+        message_partial_count = carry(p_count, l_count, l_open);
+    return p_count;
+}
+#else
+// Decoupled look-back. Each block publishes its aggregate (LB_AGGREGATE) as soon as it is scanned,
+// and its inclusive prefix (LB_PREFIX) once resolved; a block with a head flag knows its inclusive prefix
+// right away. The status word tags the flag with the block index. A block never looks back past the
+// previous block of its own tasklet, so a slot can be reused once every tasklet has finished the round
+// after the one of its previous block: with 3 * NR_TASKLETS slots, a tasklet waits for all the others
+// to have finished the round before the previous one
+#define LB_AGGREGATE 1
+#define LB_PREFIX 2
+#define LB_SLOTS (3 * NR_TASKLETS)
+typedef struct {
+    uint32_t status; // (block << 2) | flag
+    T aggregate;
+    T prefix;
+} lookback_t;
+volatile lookback_t lookback[LB_SLOTS];
+volatile uint32_t lookback_rounds[NR_TASKLETS]; // Rounds finished by each tasklet
+
+// Exclusive prefix of a block, with the aggregates and prefixes published by the preceding blocks
+static T lookback_sync(T l_count, unsigned int l_open, uint32_t block, T t_count){
+    volatile lookback_t *slot = &lookback[block % LB_SLOTS];
+    uint32_t round = block / NR_TASKLETS;
+    for(unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++)
+        while(lookback_rounds[each_tasklet] + 1 < round);
+
+    if(block == 0 || l_open < REGS){
+        slot->prefix = carry(t_count, l_count, l_open);
+        slot->status = (block << 2) | LB_PREFIX;
+        if(block == 0 || l_open == 0)
+            return t_count;
+    }
+    else{
+        slot->aggregate = l_count;
+        slot->status = (block << 2) | LB_AGGREGATE;
+    }
+
+    T p_count = SCAN_IDENTITY;
+    for(uint32_t b = block - 1; ; b--){
+        volatile lookback_t *prev = &lookback[b % LB_SLOTS];
+        uint32_t status;
+        // Wait for block b to publish at least its aggregate
+        while(((status = prev->status) >> 2) != b);
+        if((status & 3) == LB_PREFIX){
+            p_count = scan_op(prev->prefix, p_count);
+            break;
+        }
+        p_count = scan_op(prev->aggregate, p_count);
+    }
+
+    if(l_open == REGS){
+        slot->prefix = scan_op(p_count, l_count);
+        slot->status = (block << 2) | LB_PREFIX;
+    }
     return p_count;
 }
+#endif
 
 // Barrier
 BARRIER_INIT(my_barrier, NR_TASKLETS);
 
-// Add in each tasklet
-static void add(T *output, T p_count){
+// Add in each tasklet (the first l_size elements)
+static void add(T *output, T p_count, unsigned int l_size){
     #pragma unroll
-    for(unsigned int j = 0; j < REGS; j++) {
-        output[j] += p_count;
+    for(unsigned int j = 0; j < l_size; j++) {
+        output[j] = scan_op(p_count, output[j]);
     }
 }
 
@@ -99,17 +183,52 @@ int main_kernel1() {
 
     // Initialize a local cache to store the MRAM block
     T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
-	
+
+    // The aggregate of the DPU only covers the elements from its last head flag on
+    uint32_t first_head = NO_HEAD;
+    uint32_t last_head = 0;
+#if SEGMENTED
+    uint32_t mram_base_addr_H = (uint32_t)(DPU_MRAM_HEAP_POINTER + 2 * input_size_dpu_bytes);
+    uint8_t *cache_H = (uint8_t *) mem_alloc(REGS);
+    uint32_t l_first_head = NO_HEAD;
+    uint32_t l_last_head = 0;
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+        mram_read((const __mram_ptr void*)(mram_base_addr_H + (byte_index >> DIV)), cache_H, REGS);
+        for(unsigned int j = 0; j < REGS; j++) {
+            if(cache_H[j]){
+                if(l_first_head == NO_HEAD)
+                    l_first_head = (byte_index >> DIV) + j;
+                l_last_head = (byte_index >> DIV) + j;
+            }
+        }
+    }
+    message_first_head[tasklet_id] = l_first_head;
+    message_last_head[tasklet_id] = l_last_head;
+    // Barrier
+    barrier_wait(&my_barrier);
+    for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++){
+        if(message_first_head[each_tasklet] < first_head)
+            first_head = message_first_head[each_tasklet];
+        if(message_last_head[each_tasklet] > last_head)
+            last_head = message_last_head[each_tasklet];
+    }
+#endif
+    uint32_t last_head_bytes = last_head << DIV;
+
     // Local count
-    T l_count = 0;
+    T l_count = SCAN_IDENTITY;
 
     for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
 
+        // Skip the blocks before the last head flag
+        if(byte_index + BLOCK_SIZE <= last_head_bytes)
+            continue;
+
         // Load cache with current MRAM block
         mram_read((const __mram_ptr void*)(mram_base_addr_A + byte_index), cache_A, BLOCK_SIZE);
 
         // Reduction in each tasklet
-        l_count += reduction(cache_A);
+        l_count = scan_op(l_count, reduction(cache_A, byte_index < last_head_bytes ? (last_head_bytes - byte_index) >> DIV : 0));
 
     }
 
@@ -121,10 +240,11 @@ int main_kernel1() {
     barrier_wait(&my_barrier);
     if(tasklet_id == 0){
         for (unsigned int each_tasklet = 1; each_tasklet < NR_TASKLETS; each_tasklet++){
-            message[0] += message[each_tasklet];
+            message[0] = scan_op(message[0], message[each_tasklet]);
         }
-        // Total count in this DPU
+        // Total count and first head flag in this DPU
         result->t_count = message[0];
+        result->first_head = first_head;
     }
 
     return 0;
@@ -150,14 +270,29 @@ int main_kernel2() {
     uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
     uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
     uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes);
+#if SEGMENTED
+    uint32_t mram_base_addr_H = (uint32_t)(DPU_MRAM_HEAP_POINTER + 2 * input_size_dpu_bytes);
+#endif
 
     // Initialize a local cache to store the MRAM block
     T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
     T *cache_B = (T *) mem_alloc(BLOCK_SIZE);
-	
+#if SEGMENTED
+    uint8_t *cache_H = (uint8_t *) mem_alloc(REGS);
+#else
+    uint8_t *cache_H = NULL;
+#endif
+    uint32_t first_head = NO_HEAD;
+
     // Initialize shared variable
+#ifdef LOOKBACK
+    for(unsigned int i = tasklet_id; i < LB_SLOTS; i += NR_TASKLETS)
+        lookback[i].status = UINT32_MAX;
+    lookback_rounds[tasklet_id] = 0;
+#else
     if(tasklet_id == NR_TASKLETS - 1)
         message_partial_count = DPU_INPUT_ARGUMENTS.t_count;
+#endif
     // Barrier
     barrier_wait(&my_barrier);
 
@@ -165,28 +300,49 @@ int main_kernel2() {
 
         // Load cache with current MRAM block
         mram_read((const __mram_ptr void*)(mram_base_addr_A + byte_index), cache_A, BLOCK_SIZE);
+#if SEGMENTED
+        mram_read((const __mram_ptr void*)(mram_base_addr_H + (byte_index >> DIV)), cache_H, REGS);
+#endif
 
         // Scan in each tasklet
-        T l_count = scan(cache_B, cache_A); 
-
+        unsigned int l_open;
+        T l_count = scan(cache_B, cache_A, cache_H, &l_open);
+        if(l_open < REGS && first_head == NO_HEAD)
+            first_head = (byte_index >> DIV) + l_open;
+
+#ifdef LOOKBACK
+        // Look back at the preceding blocks
+        T p_count = lookback_sync(l_count, l_open, byte_index >> BLOCK_SIZE_LOG2, DPU_INPUT_ARGUMENTS.t_count);
+        lookback_rounds[tasklet_id]++;
+#else
         // Sync with adjacent tasklets
-        T p_count = handshake_sync(l_count, tasklet_id);
+        T p_count = handshake_sync(l_count, l_open, tasklet_id);
 
         // Barrier
         barrier_wait(&my_barrier);
+#endif
 
         // Add in each tasklet
-        add(cache_B, message_partial_count + p_count);
+        add(cache_B, p_count, l_open);
 
         // Write cache to current MRAM block
         mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_B + byte_index), BLOCK_SIZE);
-
-        // Total count in this DPU
-        if(tasklet_id == NR_TASKLETS - 1){
-            result->t_count = message_partial_count + p_count + l_count;
-            message_partial_count = result->t_count;
-        }
 	}
-		
+    message_first_head[tasklet_id] = first_head;
+
+    // Total count and first head flag in this DPU
+    barrier_wait(&my_barrier);
+    if(tasklet_id == NR_TASKLETS - 1){
+#ifdef LOOKBACK
+        result->t_count = input_size_dpu_bytes ? lookback[((input_size_dpu_bytes >> BLOCK_SIZE_LOG2) - 1) % LB_SLOTS].prefix : DPU_INPUT_ARGUMENTS.t_count; // No blocks: pass the carry through
+#else
+        result->t_count = message_partial_count;
+#endif
+        result->first_head = NO_HEAD;
+        for(unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++)
+            if(message_first_head[each_tasklet] < result->first_head)
+                result->first_head = message_first_head[each_tasklet];
+    }
+
     return 0;
 }
@@ -9,3 +9,29 @@ do
 			make clean
 			wait
 done
+
+for j in HAND LOOKBACK
+do
+	for k in 1 2 4 8 12 16 20 24
+	do
+		    NR_DPUS=1 NR_TASKLETS=${k} BL=10 VERSION=SINGLE SYNC=${j} make all
+			wait
+            ./bin/host_code -w 10 -e 100 -i 3932160 > profile/${j}_tl${k}_bl10_dpu1
+			wait
+			make clean
+			wait
+	done
+done
+
+for j in 0 1
+do
+	for k in 1 4 16 64
+	do
+		    NR_DPUS=${k} NR_TASKLETS=16 BL=10 VERSION=SINGLE LAZY=${j} make all
+			wait
+            ./bin/host_code -w 10 -e 100 -i 3932160 > profile/LAZY${j}_tl16_bl10_dpu${k}
+			wait
+			make clean
+			wait
+	done
+done
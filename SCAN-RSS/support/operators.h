@@ -0,0 +1,36 @@
+#ifndef _OPERATORS_H_
+#define _OPERATORS_H_
+
+#include <limits.h>
+#include <float.h>
+
+// Scan operators, selected at compile time with OP. All of them are associative and commutative
+#if defined(OP_MAX)
+#define SCAN_IDENTITY T_MIN
+#define scan_op(a, b) ((a) > (b) ? (a) : (b))
+#elif defined(OP_MIN)
+#define SCAN_IDENTITY T_MAX
+#define scan_op(a, b) ((a) < (b) ? (a) : (b))
+#elif defined(OP_PROD)
+#define SCAN_IDENTITY ((T) 1)
+#define scan_op(a, b) ((a) * (b))
+#else
+#ifndef OP_SUM
+#define OP_SUM
+#endif
+#define SCAN_IDENTITY ((T) 0)
+#define scan_op(a, b) ((a) + (b))
+#endif
+
+// Segmented scan: a head flag (one byte per element) starts a new segment
+#ifndef SEGMENTED
+#define SEGMENTED 0
+#endif
+#define NO_HEAD UINT32_MAX
+
+// Exclusive scan: an output does not include its own element (identity at the head of a segment)
+#ifndef EXCLUSIVE
+#define EXCLUSIVE 0
+#endif
+
+#endif
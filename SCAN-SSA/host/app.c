@@ -16,6 +16,7 @@
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 // Define the DPU Binary path as DPU_BINARY here
 #ifndef DPU_BINARY
@@ -30,27 +31,79 @@
 static T* A;
 static T* C;
 static T* C2;
+static uint8_t* H;
 
 // Create input arrays
-static void read_input(T* A, unsigned int nr_elements, unsigned int nr_elements_round) {
+static void read_input(T* A, uint8_t* H, unsigned int nr_elements, unsigned int nr_elements_round, unsigned int segment) {
     srand(0);
     printf("nr_elements\t%u\t", nr_elements);
     for (unsigned int i = 0; i < nr_elements; i++) {
+#ifdef OP_PROD
+        A[i] = (rand() % 2) ? (T) 1 : (T) -1; // The product of larger values overflows within a few hundred elements
+#else
         A[i] = (T) (rand());
+#endif
+#if SEGMENTED
+        H[i] = (rand() % segment) == 0; // Head flags, one segment every segment elements on average
+#endif
     }
     for (unsigned int i = nr_elements; i < nr_elements_round; i++) {
         A[i] = 0;
+        H[i] = 0;
     }
+    (void) segment;
 }
 
 // Compute output in the host
-static void scan_host(T* C, T* A, unsigned int nr_elements) {
-    C[0] = A[0];
-    for (unsigned int i = 1; i < nr_elements; i++) {
-        C[i] = C[i - 1] + A[i];
+static void scan_host(T* C, T* A, uint8_t* H, unsigned int nr_elements) {
+    T acc = SCAN_IDENTITY;
+    for (unsigned int i = 0; i < nr_elements; i++) {
+#if SEGMENTED
+        if(H[i])
+            acc = SCAN_IDENTITY;
+#endif
+#if EXCLUSIVE
+        C[i] = acc;
+        acc = scan_op(acc, A[i]);
+#else
+        acc = scan_op(acc, A[i]);
+        C[i] = acc;
+#endif
     }
+    (void) H;
 }
 
+#if LAZY
+// Lazy carry (LAZY=1): kernel 2 is not launched. The prefix of the preceding DPUs stays as metadata
+// of each DPU and the host threads apply it, to the elements before the first head flag of the DPU,
+// right after the results are copied back
+typedef struct {
+    T *output;
+    T *carry;
+    dpu_results_t *results;
+    unsigned int input_size_dpu;
+    unsigned int nr_dpus;
+} carry_args_t;
+
+static void add_carry(void *arg, unsigned int thread, unsigned int nr_threads) {
+    carry_args_t *c = (carry_args_t *) arg;
+    uint64_t first, last;
+    pool_range((uint64_t) c->nr_dpus * c->input_size_dpu, thread, nr_threads, &first, &last);
+    for (uint64_t e = first; e < last; ) {
+        uint64_t dpu = e / c->input_size_dpu;
+        uint64_t end = (dpu + 1) * c->input_size_dpu;
+        uint64_t open = dpu * c->input_size_dpu + (c->results[dpu].first_head < c->input_size_dpu ? c->results[dpu].first_head : c->input_size_dpu);
+        T carry = c->carry[dpu];
+        if (end > last)
+            end = last;
+        for (uint64_t j = e; j < end && j < open; j++) {
+            c->output[j] = scan_op(carry, c->output[j]);
+        }
+        e = end;
+    }
+}
+#endif
+
 // Main of the Host Application
 int main(int argc, char **argv) {
 
@@ -82,16 +135,23 @@ int main(int argc, char **argv) {
     A = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
     C = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
     C2 = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
+    H = calloc(input_size_dpu_round * nr_of_dpus, sizeof(uint8_t));
     T *bufferA = A;
     T *bufferC = C2;
 
     // Create an input file with arbitrary data
-    read_input(A, input_size, input_size_dpu_round * nr_of_dpus);
+    read_input(A, H, input_size, input_size_dpu_round * nr_of_dpus, p.segment);
+
+#if LAZY
+    // Host threads
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+#endif
 
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\n", NR_TASKLETS, BL);
+    printf("NR_TASKLETS\t%d\tBL\t%d\tLAZY\t%d\n", NR_TASKLETS, BL, LAZY);
 
     // Loop over main kernel
     for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
@@ -99,7 +159,7 @@ int main(int argc, char **argv) {
         // Compute output on CPU (performance comparison and verification purposes)
         if(rep >= p.n_warmup)
             start(&timer, 0, rep - p.n_warmup);
-        scan_host(C, A, input_size);
+        scan_host(C, A, H, input_size);
         if(rep >= p.n_warmup)
             stop(&timer, 0);
 
@@ -109,7 +169,7 @@ int main(int argc, char **argv) {
         // Input arguments
         const unsigned int input_size_dpu = input_size_dpu_round;
         unsigned int kernel = 0;
-        dpu_arguments_t input_arguments = {input_size_dpu * sizeof(T), kernel, 0};
+        dpu_arguments_t input_arguments = {input_size_dpu * sizeof(T), kernel, NO_HEAD, SCAN_IDENTITY};
         // Copy input arrays
         i = 0;
         DPU_FOREACH(dpu_set, dpu, i) {
@@ -120,6 +180,12 @@ int main(int argc, char **argv) {
             DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + input_size_dpu * i));
         }
         DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, input_size_dpu * sizeof(T), DPU_XFER_DEFAULT));
+#if SEGMENTED
+        DPU_FOREACH(dpu_set, dpu, i) {
+            DPU_ASSERT(dpu_prepare_xfer(dpu, H + input_size_dpu * i));
+        }
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 2 * input_size_dpu * sizeof(T), input_size_dpu * sizeof(uint8_t), DPU_XFER_DEFAULT));
+#endif
         if(rep >= p.n_warmup)
             stop(&timer, 1);
 
@@ -156,7 +222,7 @@ int main(int argc, char **argv) {
         dpu_results_t results[nr_of_dpus];
         T* results_scan = malloc(nr_of_dpus * sizeof(T));
         i = 0;
-        accum = 0;
+        accum = SCAN_IDENTITY;
 
         if(rep >= p.n_warmup)
             start(&timer, 3, rep - p.n_warmup);
@@ -175,19 +241,22 @@ int main(int argc, char **argv) {
         DPU_FOREACH(dpu_set, dpu, i) {
             // Retrieve tasklet timings
             for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
-                if(each_tasklet == NR_TASKLETS - 1)
+                if(each_tasklet == NR_TASKLETS - 1){
                     results[i].t_count = results_retrieve[i][each_tasklet].t_count;
+                    results[i].first_head = results_retrieve[i][each_tasklet].first_head;
+                }
             }
             free(results_retrieve[i]);
-            // Sequential scan
+            // Sequential scan: a DPU with a head flag does not propagate the carry of the preceding DPUs
             T temp = results[i].t_count;
             results_scan[i] = accum;
-            accum += temp;
+            accum = results[i].first_head != NO_HEAD ? temp : scan_op(accum, temp);
 #if PRINT
             printf("i=%d -- %lu,  %lu, %lu\n", i, results_scan[i], accum, temp);
 #endif
         }
 
+#if !LAZY
         // Arguments for add kernel (2nd kernel)
         kernel = 1;
         dpu_arguments_t input_arguments_2[NR_DPUS];
@@ -195,14 +264,17 @@ int main(int argc, char **argv) {
             input_arguments_2[i].size=input_size_dpu * sizeof(T); 
             input_arguments_2[i].kernel=kernel;
             input_arguments_2[i].t_count=results_scan[i];
+            input_arguments_2[i].first_head=results[i].first_head;
         }
         DPU_FOREACH(dpu_set, dpu, i) {
             DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments_2[i]));
         }
         DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments_2[0]), DPU_XFER_DEFAULT));
+#endif
         if(rep >= p.n_warmup)
             stop(&timer, 3);
 
+#if !LAZY
         printf("Run program on DPU(s) \n");
         // Run DPU kernel
         if(rep >= p.n_warmup) {
@@ -229,6 +301,7 @@ int main(int argc, char **argv) {
                 each_dpu++;
             }
         }
+#endif
 #endif
 
         printf("Retrieve results\n");
@@ -240,6 +313,11 @@ int main(int argc, char **argv) {
             DPU_ASSERT(dpu_prepare_xfer(dpu, bufferC + input_size_dpu * i));
         }
         DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), input_size_dpu * sizeof(T), DPU_XFER_DEFAULT));
+#if LAZY
+        // Apply the carry of each DPU
+        carry_args_t carry_args = {bufferC, results_scan, results, input_size_dpu, nr_of_dpus};
+        pool_run(&pool, add_carry, &carry_args);
+#endif
         if(rep >= p.n_warmup)
             stop(&timer, 5);
 
@@ -256,8 +334,10 @@ int main(int argc, char **argv) {
     print(&timer, 2, p.n_reps);
     printf("Inter-DPU (Scan) ");
     print(&timer, 3, p.n_reps);
+#if !LAZY
     printf("DPU Kernel Add ");
     print(&timer, 4, p.n_reps);
+#endif
     printf("DPU-CPU ");
     print(&timer, 5, p.n_reps);
 
@@ -285,9 +365,13 @@ int main(int argc, char **argv) {
     }
 
     // Deallocation
+#if LAZY
+    pool_free(&pool);
+#endif
     free(A);
     free(C);
     free(C2);
+    free(H);
     DPU_ASSERT(dpu_free(dpu_set));
 	
     return status ? 0 : -1;
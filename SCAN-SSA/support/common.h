@@ -15,31 +15,49 @@
 #ifdef UINT32
 #define T uint32_t
 #define DIV 2 // Shift right to divide by sizeof(T)
+#define T_MIN 0
+#define T_MAX UINT32_MAX
 #elif UINT64
 #define T uint64_t
 #define DIV 3 // Shift right to divide by sizeof(T)
+#define T_MIN 0
+#define T_MAX UINT64_MAX
 #elif INT32
 #define T int32_t
 #define DIV 2 // Shift right to divide by sizeof(T)
+#define T_MIN INT32_MIN
+#define T_MAX INT32_MAX
 #elif INT64
 #define T int64_t
 #define DIV 3 // Shift right to divide by sizeof(T)
+#define T_MIN INT64_MIN
+#define T_MAX INT64_MAX
 #elif FLOAT
 #define T float
 #define DIV 2 // Shift right to divide by sizeof(T)
+#define T_MIN (-FLT_MAX)
+#define T_MAX FLT_MAX
 #elif DOUBLE
 #define T double
 #define DIV 3 // Shift right to divide by sizeof(T)
+#define T_MIN (-DBL_MAX)
+#define T_MAX DBL_MAX
 #elif CHAR
 #define T char
 #define DIV 0 // Shift right to divide by sizeof(T)
+#define T_MIN CHAR_MIN
+#define T_MAX CHAR_MAX
 #elif SHORT
 #define T short
 #define DIV 1 // Shift right to divide by sizeof(T)
+#define T_MIN SHRT_MIN
+#define T_MAX SHRT_MAX
 #endif
 
 #define REGS (BLOCK_SIZE >> DIV)
 
+#include "operators.h"
+
 // Structures used by both the host and the dpu to communicate information
 typedef struct {
     uint32_t size;
@@ -48,11 +66,13 @@ typedef struct {
 	    kernel2 = 1,
 	    nr_kernels = 2,
 	} kernel;
+    uint32_t first_head; // First head flag of the DPU (add kernel)
     T t_count;
 } dpu_arguments_t;
 
 typedef struct {
     T t_count;
+    uint32_t first_head;
 } dpu_results_t;
 
 #ifndef ENERGY
@@ -5,6 +5,8 @@
 
 typedef struct Params {
     unsigned int   input_size;
+    unsigned int   segment;
+    unsigned int   n_threads;
     int   n_warmup;
     int   n_reps;
     int  exp;
@@ -22,24 +24,30 @@ static void usage() {
         "\n"
         "\nBenchmark-specific options:"
         "\n    -i <I>    input size (default=3932160 elements)"
+        "\n    -s <S>    average segment length, with SEGMENTED=1 (default=4096 elements)"
+        "\n    -t <T>    # of host threads for the carry add, with LAZY=1 (default=4)"
         "\n");
 }
 
 struct Params input_params(int argc, char **argv) {
     struct Params p;
     p.input_size    = 3932160;
+    p.segment       = 4096;
+    p.n_threads     = 4;
     p.n_warmup      = 1;
     p.n_reps        = 3;
     p.exp           = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hi:w:e:x:")) >= 0) {
+    while((opt = getopt(argc, argv, "hi:s:t:w:e:x:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
         exit(0);
         break;
         case 'i': p.input_size    = atoi(optarg); break;
+        case 's': p.segment       = atoi(optarg); break;
+        case 't': p.n_threads     = atoi(optarg); break;
         case 'w': p.n_warmup      = atoi(optarg); break;
         case 'e': p.n_reps        = atoi(optarg); break;
         case 'x': p.exp           = atoi(optarg); break;
@@ -50,6 +58,8 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    assert(p.segment > 0 && "Invalid segment length!");
+    assert(p.n_threads > 0 && "Invalid # of host threads!");
 
     return p;
 }
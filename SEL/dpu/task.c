@@ -18,36 +18,181 @@ __host dpu_results_t DPU_RESULTS[NR_TASKLETS];
 
 // Array for communication between adjacent tasklets
 uint32_t message[NR_TASKLETS];
+uint32_t message_last[NR_TASKLETS];
 uint32_t message_partial_count;
+uint32_t message_partial_last;
 
-// SEL in each tasklet
-static unsigned int select(T *output, T *input){
+// Evaluate the predicate program on a block, one instruction at a time over the l_size elements
+// of the block, with a stack of PRED_STACK flag vectors. Returns the flags of the block
+static uint8_t *interpret(const predicate_t *pred, T **columns, uint8_t *stack, unsigned int l_size){
+    uint8_t *top = stack - REGS;
+    for(unsigned int pc = 0; pc < pred->length; pc++) {
+        const pred_instr_t *in = &pred->code[pc];
+        const T *x = columns[in->column];
+        const T a = in->a;
+        const T b = in->b;
+        switch(in->op) {
+        case PRED_AND:
+            top -= REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] &= top[j + REGS];
+            break;
+        case PRED_OR:
+            top -= REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] |= top[j + REGS];
+            break;
+        case PRED_NOT:
+            for(unsigned int j = 0; j < l_size; j++) top[j] ^= 1;
+            break;
+        case PRED_EQ:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] == a;
+            break;
+        case PRED_NE:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] != a;
+            break;
+        case PRED_LT:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] < a;
+            break;
+        case PRED_LE:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] <= a;
+            break;
+        case PRED_GT:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] > a;
+            break;
+        case PRED_GE:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] >= a;
+            break;
+        case PRED_RANGE:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] - a <= b - a;
+            break;
+        case PRED_MOD:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) top[j] = x[j] % a == b;
+            break;
+        case PRED_IN:
+            top += REGS;
+            for(unsigned int j = 0; j < l_size; j++) {
+                uint8_t found = 0;
+                for(unsigned int k = a; k < a + b; k++) found |= x[j] == pred->in_list[k];
+                top[j] = found;
+            }
+            break;
+        }
+    }
+    return top;
+}
+
+// Flags of a block with the interpreter
+static uint8_t *filter_interpreter(uint8_t *stack, T **columns, const uint64_t *bitmap, unsigned int l_size){
+    (void) bitmap;
+    return interpret(&DPU_INPUT_ARGUMENTS.predicate, columns, stack, l_size);
+}
+
+// Flags of a block with the fast path of the shape of the predicate
+static uint8_t *filter_shape(uint8_t *flags, T **columns, const uint64_t *bitmap, unsigned int l_size){
+    const predicate_t *pred = &DPU_INPUT_ARGUMENTS.predicate;
+    const T *x = columns[pred->shape_column];
+    const T a = pred->shape_a;
+    const T b = pred->shape_b;
+    const uint8_t invert = pred->shape_invert;
+    (void) bitmap;
+    if(pred->shape == SHAPE_RANGE) {
+        #pragma unroll
+        for(unsigned int j = 0; j < l_size; j++) {
+            flags[j] = (x[j] - a <= b) ^ invert;
+        }
+    }
+    else {
+        #pragma unroll
+        for(unsigned int j = 0; j < l_size; j++) {
+            flags[j] = ((x[j] & a) == b) ^ invert;
+        }
+    }
+    return flags;
+}
+
+// Flags of a block from the bitmap of a previous selection
+static uint8_t *filter_bitmap(uint8_t *flags, T **columns, const uint64_t *bitmap, unsigned int l_size){
+    (void) columns;
+    for(unsigned int j = 0; j < l_size; j++) {
+        flags[j] = (bitmap[j >> 6] >> (j & 63)) & 1;
+    }
+    return flags;
+}
+
+// Compaction of the selected values in each tasklet
+static unsigned int compact_values(T *output, const T *input, const uint8_t *flags, unsigned int l_size){
     unsigned int pos = 0;
     #pragma unroll
-    for(unsigned int j = 0; j < REGS; j++) {
-        if(!pred(input[j])) {
-            output[pos] = input[j];
-            pos++;
-        }
+    for(unsigned int j = 0; j < l_size; j++) {
+        output[pos] = input[j];
+        pos += flags[j];
     }
     return pos;
 }
 
-// Handshake with adjacent tasklets
-static unsigned int handshake_sync(unsigned int l_count, unsigned int tasklet_id){
+// Compaction of the row ids of the selected elements in each tasklet
+static void compact_rows(uint32_t *output, uint32_t first_row, const uint8_t *flags, unsigned int l_size){
+    unsigned int pos = 0;
+    #pragma unroll
+    for(unsigned int j = 0; j < l_size; j++) {
+        output[pos] = first_row + j;
+        pos += flags[j];
+    }
+}
+
+// Count of the selected elements of a block; *l_last is the index of the last one
+static unsigned int count(const uint8_t *flags, unsigned int l_size, unsigned int *l_last){
+    unsigned int pos = 0;
+    for(unsigned int j = 0; j < l_size; j++) {
+        if(flags[j])
+            *l_last = j;
+        pos += flags[j];
+    }
+    return pos;
+}
+
+// Bitmap of a block: bit j of word w is the flag of element 64 * w + j
+static void pack(uint64_t *bitmap, const uint8_t *flags, unsigned int l_size){
+    for(unsigned int w = 0; (w << 6) < REGS; w++) {
+        uint64_t word = 0;
+        for(unsigned int j = 0; j < 64 && (w << 6) + j < l_size; j++) {
+            word |= (uint64_t) flags[(w << 6) + j] << j;
+        }
+        bitmap[w] = word;
+    }
+}
+
+// Handshake with adjacent tasklets. Returns the output position of the block of this tasklet, and
+// in *p_last the last row id selected before this block
+static unsigned int handshake_sync(unsigned int l_count, uint32_t l_last, unsigned int tasklet_id, uint32_t *p_last){
     unsigned int p_count;
     // Wait and read message
     if(tasklet_id != 0){
         handshake_wait_for(tasklet_id - 1);
         p_count = message[tasklet_id];
+        *p_last = message_last[tasklet_id];
+    }
+    else{
+        p_count = message_partial_count;
+        *p_last = message_partial_last;
     }
-    else
-        p_count = 0;
     // Write message and notify
     if(tasklet_id < NR_TASKLETS - 1){
         message[tasklet_id + 1] = p_count + l_count;
+        message_last[tasklet_id + 1] = l_count > 0 ? l_last : *p_last;
         handshake_notify();
     }
+    else{
+        message_partial_count = p_count + l_count;
+        message_partial_last = l_count > 0 ? l_last : *p_last;
+    }
     return p_count;
 }
 
@@ -55,16 +200,48 @@ static unsigned int handshake_sync(unsigned int l_count, unsigned int tasklet_id
 BARRIER_INIT(my_barrier, NR_TASKLETS);
 
 extern int main_kernel1(void);
+extern int main_kernel2(void);
+extern int main_kernel3(void);
+extern int main_kernel4(void);
+extern int main_kernel5(void);
 
-int (*kernels[nr_kernels])(void) = {main_kernel1};
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2, main_kernel3, main_kernel4, main_kernel5};
 
 int main(void) { 
     // Kernel
     return kernels[DPU_INPUT_ARGUMENTS.kernel](); 
 }
 
-// main_kernel1
+typedef uint8_t *(*filter_t)(uint8_t *, T **, const uint64_t *, unsigned int);
+static int select_kernel(filter_t filter);
+static int select_rle(filter_t filter);
+
+// main_kernel1: predicate interpreter
 int main_kernel1() {
+    return select_kernel(filter_interpreter);
+}
+
+// main_kernel2: fast path for the shape of the predicate
+int main_kernel2() {
+    return select_kernel(filter_shape);
+}
+
+// main_kernel3: projection of a column with the bitmap of a previous selection
+int main_kernel3() {
+    return select_kernel(filter_bitmap);
+}
+
+// main_kernel4: predicate interpreter over run-length encoded input
+int main_kernel4() {
+    return select_rle(filter_interpreter);
+}
+
+// main_kernel5: fast path over run-length encoded input
+int main_kernel5() {
+    return select_rle(filter_shape);
+}
+
+static int select_kernel(filter_t filter) {
     unsigned int tasklet_id = me();
 #if PRINT
     printf("tasklet_id = %u\n", tasklet_id);
@@ -78,45 +255,188 @@ int main_kernel1() {
     dpu_results_t *result = &DPU_RESULTS[tasklet_id];
 
     uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size;
+    uint32_t valid_bytes = DPU_INPUT_ARGUMENTS.valid;
+    uint32_t output_mode = DPU_INPUT_ARGUMENTS.output;
+    uint32_t column = DPU_INPUT_ARGUMENTS.column; // Column of the selected values
+    uint32_t columns = (filter == filter_bitmap ? 0 : DPU_INPUT_ARGUMENTS.predicate.columns) | (output_mode == OUTPUT_VALUES ? 1 << column : 0);
 
-    // Address of the current processing block in MRAM
+    // Address of the current processing block in MRAM. Column c starts at c * input_size_dpu_bytes,
+    // followed by the output (values or row ids) and the bitmap (one bit per element)
     uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
     uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
-    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes);
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + DPU_INPUT_ARGUMENTS.nr_columns * input_size_dpu_bytes);
+    uint32_t mram_base_addr_M = mram_base_addr_B + input_size_dpu_bytes;
 
-    // Initialize a local cache to store the MRAM block
-    T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
+    // Initialize a local cache to store the MRAM block of each column used by the predicate
+    T *cache_A[PRED_MAX_COLUMNS];
+    for(unsigned int c = 0; c < PRED_MAX_COLUMNS; c++)
+        cache_A[c] = (columns >> c) & 1 ? (T *) mem_alloc(BLOCK_SIZE) : NULL;
     T *cache_B = (T *) mem_alloc(BLOCK_SIZE);
+    uint64_t *cache_M = (uint64_t *) mem_alloc(REGS >> 3);
+    uint8_t *stack = (uint8_t *) mem_alloc(filter == filter_interpreter ? PRED_STACK * REGS : REGS);
 
     // Initialize shared variable
-    if(tasklet_id == NR_TASKLETS - 1)
+    if(tasklet_id == NR_TASKLETS - 1){
         message_partial_count = 0;
+        message_partial_last = 0;
+    }
     // Barrier
     barrier_wait(&my_barrier);
 
+    uint32_t t_count = 0;
     for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
 
+        // Bound checking: padding elements are never selected
+        unsigned int l_size = byte_index >= valid_bytes ? 0 : (byte_index + BLOCK_SIZE >= valid_bytes ? (valid_bytes - byte_index) >> 3 : REGS);
+
         // Load cache with current MRAM block
-        mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, BLOCK_SIZE);
+        for(unsigned int c = 0; c < PRED_MAX_COLUMNS; c++)
+            if(cache_A[c] != NULL)
+                mram_read((__mram_ptr void const*)(mram_base_addr_A + c * input_size_dpu_bytes + byte_index), cache_A[c], BLOCK_SIZE);
+        if(filter == filter_bitmap)
+            mram_read((__mram_ptr void const*)(mram_base_addr_M + (byte_index >> 6)), cache_M, REGS >> 3);
 
         // SELECT in each tasklet
-        uint32_t l_count = select(cache_B, cache_A); // In-place or out-of-place?
+        uint8_t *flags = filter(stack, cache_A, cache_M, l_size);
+
+        if(output_mode == OUTPUT_BITMAP){
+            // Each block has its own position in the bitmap: no ordering between tasklets
+            pack(cache_M, flags, l_size);
+            mram_write(cache_M, (__mram_ptr void*)(mram_base_addr_M + (byte_index >> 6)), REGS >> 3);
+            unsigned int l_last;
+            t_count += count(flags, l_size, &l_last);
+            continue;
+        }
+
+        uint32_t l_count, l_last = 0, p_last;
+        if(output_mode == OUTPUT_VALUES)
+            l_count = compact_values(cache_B, cache_A[column], flags, l_size);
+        else{
+            l_count = count(flags, l_size, &l_last);
+            l_last += DPU_INPUT_ARGUMENTS.first_row + (byte_index >> 3);
+        }
 
         // Sync with adjacent tasklets
-        uint32_t p_count = handshake_sync(l_count, tasklet_id);
+        uint32_t p_count = handshake_sync(l_count, l_last, tasklet_id, &p_last);
 
         // Barrier
         barrier_wait(&my_barrier);
 
         // Write cache to current MRAM block
-        mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_B + (message_partial_count + p_count) * sizeof(T)), l_count * sizeof(T));
+        if(output_mode == OUTPUT_VALUES){
+            if(l_count > 0)
+                mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_B + p_count * sizeof(T)), l_count * sizeof(T));
+        }
+        else{
+            // Row ids are 4 bytes and MRAM writes are 8-byte aligned: a block starting in the middle of
+            // an 8-byte word also writes the last row id of the preceding blocks, and a block ending in
+            // the middle of an 8-byte word leaves it to the next block
+            uint32_t *rows = (uint32_t *) cache_B;
+            rows[0] = p_last;
+            compact_rows(rows + (p_count & 1), DPU_INPUT_ARGUMENTS.first_row + (byte_index >> 3), flags, l_size);
+            uint32_t words = ((p_count & 1) + l_count) >> 1;
+            if(words > 0)
+                mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_B + (p_count >> 1) * sizeof(uint64_t)), words * sizeof(uint64_t));
+        }
 
         // Total count in this DPU
+        if(tasklet_id == NR_TASKLETS - 1)
+            result->t_count = p_count + l_count;
+
+    }
+
+    if(output_mode == OUTPUT_BITMAP){
+        // Total count in this DPU
+        message[tasklet_id] = t_count;
+        barrier_wait(&my_barrier);
         if(tasklet_id == NR_TASKLETS - 1){
-            result->t_count = message_partial_count + p_count + l_count;
-            message_partial_count = result->t_count;
+            for(unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS - 1; each_tasklet++)
+                t_count += message[each_tasklet];
+            result->t_count = t_count;
+        }
+    }
+    else if(output_mode == OUTPUT_ROWS){
+        // Last 8-byte word of the row ids, if it is not complete
+        barrier_wait(&my_barrier);
+        if(tasklet_id == NR_TASKLETS - 1 && (message_partial_count & 1)){
+            uint32_t *rows = (uint32_t *) cache_B;
+            rows[0] = message_partial_last;
+            rows[1] = 0;
+            mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_B + (message_partial_count >> 1) * sizeof(uint64_t)), sizeof(uint64_t));
+        }
+    }
+
+    return 0;
+}
+
+// Selection of the runs of a run-length encoded column, without decompression: the predicate sees the value
+// of each run once, and the selected runs are compacted in place
+static int select_rle(filter_t filter) {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    dpu_results_t *result = &DPU_RESULTS[tasklet_id];
+
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size; // Runs of this DPU in bytes
+    uint32_t valid_bytes = DPU_INPUT_ARGUMENTS.valid;
+
+    // Address of the current processing block in MRAM: the runs, followed by the selected runs
+    uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
+    uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes);
+
+    // Initialize a local cache to store the MRAM block, and the values of its runs
+    run_t *cache_R = (run_t *) mem_alloc(BLOCK_SIZE);
+    T *columns[PRED_MAX_COLUMNS] = {(T *) mem_alloc(RUNS * sizeof(T))};
+    uint8_t *stack = (uint8_t *) mem_alloc(filter == filter_interpreter ? PRED_STACK * REGS : REGS);
+
+    // Initialize shared variable
+    if(tasklet_id == NR_TASKLETS - 1){
+        message_partial_count = 0;
+        message_partial_last = 0;
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+
+        // Bound checking: padding runs are never selected
+        unsigned int l_size = byte_index >= valid_bytes ? 0 : (byte_index + BLOCK_SIZE >= valid_bytes ? (valid_bytes - byte_index) / sizeof(run_t) : RUNS);
+
+        // Load cache with current MRAM block
+        mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_R, BLOCK_SIZE);
+        for(unsigned int j = 0; j < l_size; j++)
+            columns[0][j] = cache_R[j].value;
+
+        // SELECT in each tasklet
+        uint8_t *flags = filter(stack, columns, NULL, l_size);
+        uint32_t l_count = 0, p_last;
+        for(unsigned int j = 0; j < l_size; j++) {
+            cache_R[l_count] = cache_R[j];
+            l_count += flags[j];
         }
 
+        // Sync with adjacent tasklets
+        uint32_t p_count = handshake_sync(l_count, 0, tasklet_id, &p_last);
+
+        // Barrier
+        barrier_wait(&my_barrier);
+
+        // Write cache to current MRAM block
+        if(l_count > 0)
+            mram_write(cache_R, (__mram_ptr void*)(mram_base_addr_B + p_count * sizeof(run_t)), l_count * sizeof(run_t));
+
+        // Total count in this DPU
+        if(tasklet_id == NR_TASKLETS - 1)
+            result->t_count = p_count + l_count;
+
     }
 
     return 0;
@@ -16,6 +16,7 @@
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 // Define the DPU Binary path as DPU_BINARY here
 #ifndef DPU_BINARY
@@ -30,32 +31,176 @@
 static T* A;
 static T* C;
 static T* C2;
-
-// Create input arrays
-static void read_input(T* A, unsigned int nr_elements, unsigned int nr_elements_round) {
-    //srand(0);
+static uint32_t* R;
+static uint64_t* bitmap;
+static uint8_t* staging;
+static run_t* runs;
+static run_t* runs_out;
+
+// Create input arrays. Column c starts at A + c * nr_elements_round
+// With run_length > 0, column 0 holds runs of 1 to 2 * run_length - 1 elements of the same value
+static void read_input(T* A, unsigned int nr_elements, unsigned int nr_elements_round, unsigned int nr_columns, unsigned int run_length) {
+    srand(0);
     printf("nr_elements\t%u\t", nr_elements);
+    T value = 0;
+    unsigned int left = 0;
     for (unsigned int i = 0; i < nr_elements; i++) {
         //A[i] = (T) (rand());
-        A[i] = i + 1;
+        if (run_length == 0)
+            A[i] = i + 1;
+        else {
+            if (left == 0) {
+                value++;
+                left = 1 + rand() % (2 * run_length - 1);
+            }
+            A[i] = value;
+            left--;
+        }
+        for (unsigned int c = 1; c < nr_columns; c++) {
+            A[c * nr_elements_round + i] = (T) (rand() % 1000);
+        }
     }
-    for (unsigned int i = nr_elements; i < nr_elements_round; i++) { // Complete with removable elements
-        A[i] = 0;
+    for (unsigned int i = nr_elements; i < nr_elements_round; i++) { // Complete with padding elements
+        for (unsigned int c = 0; c < nr_columns; c++) {
+            A[c * nr_elements_round + i] = 0;
+        }
+    }
+}
+
+// Evaluate the predicate on row i
+static bool pred(const predicate_t *p, T* A, unsigned int nr_elements_round, unsigned int i) {
+    bool stack[PRED_STACK];
+    int top = -1;
+    for (unsigned int pc = 0; pc < p->length; pc++) {
+        const pred_instr_t *in = &p->code[pc];
+        T x = A[in->column * nr_elements_round + i];
+        switch (in->op) {
+        case PRED_AND: top--; stack[top] = stack[top] && stack[top + 1]; break;
+        case PRED_OR: top--; stack[top] = stack[top] || stack[top + 1]; break;
+        case PRED_NOT: stack[top] = !stack[top]; break;
+        case PRED_EQ: stack[++top] = x == in->a; break;
+        case PRED_NE: stack[++top] = x != in->a; break;
+        case PRED_LT: stack[++top] = x < in->a; break;
+        case PRED_LE: stack[++top] = x <= in->a; break;
+        case PRED_GT: stack[++top] = x > in->a; break;
+        case PRED_GE: stack[++top] = x >= in->a; break;
+        case PRED_RANGE: stack[++top] = x >= in->a && x <= in->b; break;
+        case PRED_MOD: stack[++top] = x % in->a == in->b; break;
+        case PRED_IN:
+            stack[++top] = false;
+            for (T k = in->a; k < in->a + in->b; k++)
+                stack[top] = stack[top] || x == p->in_list[k];
+            break;
+        }
     }
+    return stack[0];
 }
 
-// Compute output in the host
-static unsigned int select_host(T* C, T* A, unsigned int nr_elements) {
+// Compute output in the host: selected values of a column and their row ids
+static unsigned int select_host(T* C, uint32_t* R, T* A, unsigned int nr_elements, unsigned int nr_elements_round, const predicate_t *p, unsigned int column) {
     unsigned int pos = 0;
     for (unsigned int i = 0; i < nr_elements; i++) {
-        if(!pred(A[i])) {
-            C[pos] = A[i];
+        if(pred(p, A, nr_elements_round, i)) {
+            C[pos] = A[column * nr_elements_round + i];
+            R[pos] = i;
+            pos++;
+        }
+    }
+    return pos;
+}
+
+// Run-length encoding of rows first to last - 1 (runs may be NULL to count them only). Returns the number of runs
+static unsigned int rle_host(run_t* runs, T* A, uint64_t first, uint64_t last) {
+    unsigned int pos = 0;
+    for (uint64_t k = first; k < last; k++) {
+        if (k > first && A[k] == A[k - 1]) {
+            if (runs != NULL)
+                runs[pos - 1].length++;
+        }
+        else {
+            if (runs != NULL) {
+                runs[pos].value = A[k];
+                runs[pos].length = 1;
+            }
             pos++;
         }
     }
     return pos;
 }
 
+// Compaction of the padded output: each host thread copies a range of the output elements
+typedef struct {
+    uint8_t *output;
+    uint8_t *staging;
+    dpu_results_t *results;
+    uint32_t *results_scan;
+    uint32_t stride; // Bytes of each DPU in the staging buffer
+    uint32_t element; // Bytes of an output element
+    uint32_t total_count;
+    unsigned int nr_dpus;
+} compact_args_t;
+
+static void compact(void *arg, unsigned int thread, unsigned int nr_threads) {
+    compact_args_t *c = (compact_args_t *) arg;
+    uint64_t first, last;
+    pool_range(c->total_count, thread, nr_threads, &first, &last);
+    // Last DPU whose output starts at or before first
+    unsigned int lo = 0, hi = c->nr_dpus;
+    while (hi - lo > 1) {
+        unsigned int mid = (lo + hi) / 2;
+        if (c->results_scan[mid] <= first)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    for (unsigned int i = lo; i < c->nr_dpus && c->results_scan[i] < last; i++) {
+        uint64_t from = first > c->results_scan[i] ? first : c->results_scan[i];
+        uint64_t to = c->results_scan[i] + c->results[i].t_count;
+        if (to > last)
+            to = last;
+        if (from < to)
+            memcpy(c->output + from * c->element, c->staging + (uint64_t) c->stride * i + (from - c->results_scan[i]) * c->element, (to - from) * c->element);
+    }
+}
+
+// Retrieval of a compacted output (values or row ids) at offset of the MRAM heap of each DPU.
+// MRAM transfers are multiples of 8 bytes. Returns true for the padded parallel retrieval
+static bool retrieve_output(struct dpu_set_t dpu_set, unsigned int retrieve, uint8_t *output, uint32_t element, uint32_t offset,
+    dpu_results_t *results, uint32_t *results_scan, uint32_t total_count, unsigned int nr_dpus, Pool *pool) {
+    struct dpu_set_t dpu;
+    unsigned int i = 0;
+    // Padded parallel retrieval, unless the output of some DPUs is much larger than the average
+    uint32_t max_count = 0;
+    for(i = 0; i < nr_dpus; i++) {
+        if(results[i].t_count > max_count)
+            max_count = results[i].t_count;
+    }
+    bool parallel = retrieve == RETRIEVE_PARALLEL || (retrieve == RETRIEVE_AUTO && (uint64_t) max_count * nr_dpus <= (uint64_t) MAX_PADDING * total_count);
+
+    if(parallel) {
+        uint32_t stride = (max_count * element + 7) & ~7;
+        if(stride > 0) {
+            // PARALLEL RETRIEVE TRANSFER
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, staging + (uint64_t) stride * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, offset, stride, DPU_XFER_DEFAULT));
+            compact_args_t compact_args = {output, staging, results, results_scan, stride, element, total_count, nr_dpus};
+            pool_run(pool, compact, &compact_args);
+        }
+    }
+    else {
+        // The padding of each DPU is overwritten by the next one
+        DPU_FOREACH (dpu_set, dpu, i) {
+            // Copy output array
+            uint32_t bytes = (results[i].t_count * element + 7) & ~7;
+            if(bytes > 0)
+                DPU_ASSERT(dpu_copy_from(dpu, DPU_MRAM_HEAP_POINTER_NAME, offset, output + (uint64_t) results_scan[i] * element, bytes));
+        }
+    }
+    return parallel;
+}
+
 // Main of the Host Application
 int main(int argc, char **argv) {
 
@@ -84,20 +229,66 @@ int main(int argc, char **argv) {
     const unsigned int input_size_dpu_round = 
         (input_size_dpu_ % (NR_TASKLETS * REGS) != 0) ? roundup(input_size_dpu_, (NR_TASKLETS * REGS)) : input_size_dpu_; // Input size per DPU (max.), 8-byte aligned
 
+    // The caches of the columns used by the predicate (and column 0) must fit in WRAM
+    const predicate_t *predicate = &p.predicate;
+    const unsigned int used_columns = __builtin_popcount(predicate->columns | 1);
+    assert(((used_columns + 1) * BLOCK_SIZE + PRED_STACK * REGS) * NR_TASKLETS <= WRAM_BUDGET && "Column caches do not fit in WRAM, reduce BL or NR_TASKLETS!");
+    assert((uint64_t) (p.nr_columns + 1) * input_size_dpu_round * sizeof(T) + input_size_dpu_round / 8 <= MRAM_CAPACITY && "Input columns and output do not fit in MRAM!");
+    const uint32_t load_columns = predicate->columns | 1 | (p.project >= 0 ? 1 << p.project : 0);
+    const unsigned int kernel = (p.generic || predicate->shape == SHAPE_GENERIC ? kernel1 : kernel2) + (p.run_length > 0 ? kernel4 : kernel1);
+
     // Input/output allocation
-    A = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
+    A = malloc((uint64_t) input_size_dpu_round * nr_of_dpus * p.nr_columns * sizeof(T));
     C = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
     C2 = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
+    R = malloc(input_size_dpu_round * nr_of_dpus * sizeof(uint32_t));
+    bitmap = malloc(input_size_dpu_round * nr_of_dpus / 8);
+    staging = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
     T *bufferA = A;
     T *bufferC = C2;
 
     // Create an input file with arbitrary data
-    read_input(A, input_size, input_size_dpu_round * nr_of_dpus);
+    read_input(A, input_size, input_size_dpu_round * nr_of_dpus, p.nr_columns, p.run_length);
+
+    // Run-length encoding of column 0, once. The runs of all DPUs are padded to the same number of blocks
+    unsigned int runs_dpu = 0;
+    unsigned int *runs_valid = calloc(nr_of_dpus, sizeof(unsigned int));
+    if(p.run_length > 0) {
+        for(i = 0; i < nr_of_dpus; i++) {
+            uint64_t first = (uint64_t) input_size_dpu_round * i;
+            uint64_t last = first + input_size_dpu_round < input_size ? first + input_size_dpu_round : input_size;
+            runs_valid[i] = first < input_size ? rle_host(NULL, A, first, last) : 0;
+            if(runs_valid[i] > runs_dpu)
+                runs_dpu = runs_valid[i];
+        }
+        runs_dpu = (runs_dpu % (NR_TASKLETS * RUNS) != 0) ? roundup(runs_dpu, (NR_TASKLETS * RUNS)) : runs_dpu;
+        assert((uint64_t) 2 * runs_dpu * sizeof(run_t) <= MRAM_CAPACITY && "Runs and output do not fit in MRAM!");
+        runs = calloc((uint64_t) runs_dpu * nr_of_dpus, sizeof(run_t));
+        runs_out = malloc((uint64_t) runs_dpu * nr_of_dpus * sizeof(run_t));
+        for(i = 0; i < nr_of_dpus; i++) {
+            uint64_t first = (uint64_t) input_size_dpu_round * i;
+            uint64_t last = first + input_size_dpu_round < input_size ? first + input_size_dpu_round : input_size;
+            if(first < input_size)
+                rle_host(runs + (uint64_t) runs_dpu * i, A, first, last);
+        }
+        printf("Column 0 (MB)\t%f\tRLE (MB)\t%f\n", (double) input_size_dpu_round * nr_of_dpus * sizeof(T) / (1 << 20), (double) runs_dpu * nr_of_dpus * sizeof(run_t) / (1 << 20));
+        if((uint64_t) runs_dpu * sizeof(run_t) > (uint64_t) input_size_dpu_round * sizeof(T)) {
+            free(staging);
+            staging = malloc((uint64_t) runs_dpu * nr_of_dpus * sizeof(run_t));
+        }
+    }
+
+    // Host threads
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+    bool parallel = false;
 
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\n", NR_TASKLETS, BL);
+    static const char *output_names[] = {"values", "row ids", "bitmap"};
+    printf("NR_TASKLETS\t%d\tBL\t%d\tpredicate\t%s\tpath\t%s\toutput\t%s\tinput\t%s\n", NR_TASKLETS, BL, p.predicate_text, kernel == kernel1 || kernel == kernel4 ? "interpreter" : "fast", output_names[p.output],
+        p.run_length > 0 ? "rle" : "plain");
 
     // Loop over main kernel
     for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
@@ -105,7 +296,7 @@ int main(int argc, char **argv) {
         // Compute output on CPU (performance comparison and verification purposes)
         if(rep >= p.n_warmup)
             start(&timer, 0, rep - p.n_warmup);
-        total_count = select_host(C, A, input_size);
+        total_count = select_host(C, R, A, input_size, input_size_dpu_round * nr_of_dpus, predicate, p.project >= 0 ? p.project : 0);
         if(rep >= p.n_warmup)
             stop(&timer, 0);
 
@@ -114,18 +305,45 @@ int main(int argc, char **argv) {
             start(&timer, 1, rep - p.n_warmup);
         // Input arguments
         const unsigned int input_size_dpu = input_size_dpu_round;
-        unsigned int kernel = 0;
-        dpu_arguments_t input_arguments = {input_size_dpu * sizeof(T), kernel};
+        dpu_arguments_t input_arguments[NR_DPUS];
+        for(i=0; i<nr_of_dpus; i++) {
+            unsigned int first = input_size_dpu * i;
+            unsigned int rows = first >= input_size ? 0 : (input_size - first < input_size_dpu ? input_size - first : input_size_dpu);
+            input_arguments[i].size=input_size_dpu * sizeof(T);
+            input_arguments[i].valid=rows * sizeof(T);
+            input_arguments[i].nr_columns=p.nr_columns;
+            input_arguments[i].output=p.output;
+            input_arguments[i].column=0;
+            input_arguments[i].first_row=first;
+            input_arguments[i].kernel=kernel;
+            input_arguments[i].predicate=*predicate;
+            if(p.run_length > 0) {
+                input_arguments[i].size=runs_dpu * sizeof(run_t);
+                input_arguments[i].valid=runs_valid[i] * sizeof(run_t);
+                input_arguments[i].nr_columns=1;
+            }
+        }
         // Copy input arrays
         i = 0;
         DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments));
+            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
         }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments), DPU_XFER_DEFAULT));
-        DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + input_size_dpu * i));
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
+        // Only the columns used by the predicate, column 0 and the projected column
+        if(p.run_length > 0) {
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, runs + (uint64_t) runs_dpu * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, runs_dpu * sizeof(run_t), DPU_XFER_DEFAULT));
+        }
+        for(unsigned int c = 0; c < p.nr_columns && p.run_length == 0; c++) {
+            if(!((load_columns >> c) & 1))
+                continue;
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + (uint64_t) input_size_dpu * nr_of_dpus * c + input_size_dpu * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, c * input_size_dpu * sizeof(T), input_size_dpu * sizeof(T), DPU_XFER_DEFAULT));
         }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, input_size_dpu * sizeof(T), DPU_XFER_DEFAULT));
         if(rep >= p.n_warmup)
             stop(&timer, 1);
 
@@ -197,15 +415,48 @@ int main(int argc, char **argv) {
         i = 0;
         if(rep >= p.n_warmup)
             start(&timer, 4, rep - p.n_warmup);
-        DPU_FOREACH (dpu_set, dpu) {
-            // Copy output array
-            DPU_ASSERT(dpu_copy_from(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), bufferC + results_scan[i], results[i].t_count * sizeof(T)));
-
-            i++;
+        if(p.output == OUTPUT_BITMAP) {
+            // PARALLEL RETRIEVE TRANSFER
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, bitmap + (input_size_dpu >> 6) * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, (p.nr_columns + 1) * input_size_dpu * sizeof(T), input_size_dpu >> 3, DPU_XFER_DEFAULT));
         }
+        else if(p.run_length > 0)
+            parallel = retrieve_output(dpu_set, p.retrieve, (uint8_t *) runs_out, sizeof(run_t), runs_dpu * sizeof(run_t),
+                results, results_scan, accum, nr_of_dpus, &pool);
+        else
+            parallel = retrieve_output(dpu_set, p.retrieve, (uint8_t *) bufferC, p.output == OUTPUT_ROWS ? sizeof(uint32_t) : sizeof(T), p.nr_columns * input_size_dpu * sizeof(T),
+                results, results_scan, accum, nr_of_dpus, &pool);
         if(rep >= p.n_warmup)
             stop(&timer, 4);
 
+        if(p.project >= 0) {
+            // Projection of another column with the bitmap, already in MRAM
+            if(rep >= p.n_warmup)
+                start(&timer, 5, rep - p.n_warmup);
+            for(i=0; i<nr_of_dpus; i++) {
+                input_arguments[i].output=OUTPUT_VALUES;
+                input_arguments[i].column=p.project;
+                input_arguments[i].kernel=kernel3;
+            }
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
+            DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
+            if(rep >= p.n_warmup)
+                stop(&timer, 5);
+
+            // The counts of the DPUs are those of the selection
+            if(rep >= p.n_warmup)
+                start(&timer, 6, rep - p.n_warmup);
+            parallel = retrieve_output(dpu_set, p.retrieve, (uint8_t *) bufferC, sizeof(T), p.nr_columns * input_size_dpu * sizeof(T),
+                results, results_scan, accum, nr_of_dpus, &pool);
+            if(rep >= p.n_warmup)
+                stop(&timer, 6);
+        }
+
         // Free memory
         free(results_scan);
     }
@@ -221,6 +472,15 @@ int main(int argc, char **argv) {
     print(&timer, 3, p.n_reps);
     printf("DPU-CPU ");
     print(&timer, 4, p.n_reps);
+    if(p.project >= 0) {
+        printf("DPU Kernel Projection ");
+        print(&timer, 5, p.n_reps);
+        printf("Projection DPU-CPU ");
+        print(&timer, 6, p.n_reps);
+    }
+    if(p.output != OUTPUT_BITMAP || p.project >= 0)
+        printf("\nRetrieval\t%s", parallel ? "padded parallel" : "serial");
+    printf("\nFilter throughput (MElements/s)\t%f\t%s\n", (double) input_size * p.n_reps / timer.time[2], kernel == kernel1 || kernel == kernel4 ? "interpreter" : "fast");
 
     #if ENERGY
     double energy;
@@ -230,13 +490,54 @@ int main(int argc, char **argv) {
 
     // Check output
     bool status = true;
-    if(accum != total_count) status = false;
-    for (i = 0; i < accum; i++) {
-        if(C[i] != bufferC[i]){ 
-            status = false;
+    if(p.run_length > 0) {
+        // Selected runs, expanded
+        unsigned int k = 0;
+        for (i = 0; i < accum; i++) {
+            for (unsigned int j = 0; j < runs_out[i].length; j++, k++) {
+                if(k >= total_count || C[k] != runs_out[i].value)
+                    status = false;
+            }
+        }
+        if(k != total_count) status = false;
 #if PRINT
-            printf("%d: %lu -- %lu\n", i, C[i], bufferC[i]);
+        printf("runs %u, rows %u, total_count %u\n", accum, k, total_count);
 #endif
+        accum = 0;
+    }
+    else if(accum != total_count) status = false;
+    if(p.output == OUTPUT_ROWS) {
+        uint32_t *rows = (uint32_t *) bufferC;
+        for (i = 0; i < accum; i++) {
+            if(R[i] != rows[i]){
+                status = false;
+#if PRINT
+                printf("%d: %u -- %u\n", i, R[i], rows[i]);
+#endif
+            }
+        }
+    }
+    if(p.output == OUTPUT_BITMAP) {
+        unsigned int k = 0;
+        for (i = 0; i < input_size_dpu_round * nr_of_dpus; i++) {
+            bool selected = k < total_count && R[k] == i;
+            k += selected;
+            if(((bitmap[i >> 6] >> (i & 63)) & 1) != selected){
+                status = false;
+#if PRINT
+                printf("%d: %d -- %lu\n", i, selected, (bitmap[i >> 6] >> (i & 63)) & 1);
+#endif
+            }
+        }
+    }
+    if((p.output == OUTPUT_VALUES && p.run_length == 0) || p.project >= 0) {
+        for (i = 0; i < accum; i++) {
+            if(C[i] != bufferC[i]){ 
+                status = false;
+#if PRINT
+                printf("%d: %lu -- %lu\n", i, C[i], bufferC[i]);
+#endif
+            }
         }
     }
     if (status) {
@@ -249,6 +550,13 @@ int main(int argc, char **argv) {
     free(A);
     free(C);
     free(C2);
+    free(R);
+    free(bitmap);
+    free(staging);
+    free(runs);
+    free(runs_out);
+    free(runs_valid);
+    pool_free(&pool);
     DPU_ASSERT(dpu_free(dpu_set));
 	
     return status ? 0 : -1;
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Filter throughput of the fast paths (-g 0) and of the interpreter on the same predicates (-g 1)
+for i in 1 
+do
+	for p in "c0%2==1" "c0<1966080" "c0[1000,2000000]" "c0==7 !"
+	do
+		for k in 1 2 4 8 16
+		do
+			NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
+			wait
+			for g in 0 1
+			do
+				./bin/host_code -w 2 -e 10 -p "${p}" -g ${g} > "profile/SEL_${p//[^a-z0-9]/_}_g${g}_tl${k}_dpu${i}.txt"
+				wait
+			done
+			make clean
+			wait
+		done
+	done
+done
+
+# Run-length encoded column 0
+for i in 1 
+do
+	for l in 4 16 64
+	do
+		for k in 1 2 4 8 16
+		do
+			NR_DPUS=$i NR_TASKLETS=$k BL=10 make all
+			wait
+			for g in 0 1
+			do
+				./bin/host_code -w 2 -e 10 -p "c0[1000,100000]" -l ${l} -g ${g} > profile/SEL_RLE_${l}_g${g}_tl${k}_dpu${i}.txt
+				wait
+			done
+			make clean
+			wait
+		done
+	done
+done
@@ -1,13 +1,29 @@
 #ifndef _COMMON_H_
 #define _COMMON_H_
 
+// Data type
+#define T uint64_t
+
+#include "predicate.h"
+
 // Structures used by both the host and the dpu to communicate information 
 typedef struct {
     uint32_t size;
+    uint32_t valid; // Elements of this DPU that are not padding, in bytes
+    uint32_t nr_columns;
+    uint32_t output; // Output mode
+    uint32_t column; // Column of the output values
+    uint32_t first_row; // Row id of the first element of this DPU
 	enum kernels {
-	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel1 = 0, // Predicate interpreter
+	    kernel2 = 1, // Fast path for the shape of the predicate
+	    kernel3 = 2, // Projection of a column with the bitmap of a previous selection
+	    kernel4 = 3, // Predicate interpreter over run-length encoded column 0
+	    kernel5 = 4, // Fast path over run-length encoded column 0
+	    nr_kernels = 5,
 	} kernel;
+    uint32_t pad;
+    predicate_t predicate;
 } dpu_arguments_t;
 
 typedef struct {
@@ -24,14 +40,36 @@ typedef struct {
 #define BL BLOCK_SIZE_LOG2
 #endif
 
-// Data type
-#define T uint64_t
 #define REGS (BLOCK_SIZE >> 3) // 64 bits
 
-// Sample predicate
-bool pred(const T x){
-  return (x % 2) == 0;
-}
+// Run of equal values of a run-length encoded column. The predicate is evaluated once per run, and the
+// output is the selected runs
+typedef struct {
+    T value;
+    uint32_t length;
+} run_t;
+#define RUNS (BLOCK_SIZE / sizeof(run_t)) // Runs in a block
+
+// WRAM available for the caches of all tasklets
+#define WRAM_BUDGET (48 << 10)
+#define MRAM_CAPACITY (64 << 20)
+
+// Output of the selection: the selected values (compacted), their row ids (compacted, 4 bytes),
+// or a bitmap with one bit per element (not compacted, so the tasklets need no ordering)
+enum output_modes {
+    OUTPUT_VALUES = 0,
+    OUTPUT_ROWS,
+    OUTPUT_BITMAP,
+};
+
+// Retrieval of the output. The padded parallel retrieval transfers max(t_count) elements from
+// every DPU; in automatic mode it is used unless this is more than MAX_PADDING times the output
+enum retrieve_modes {
+    RETRIEVE_AUTO = 0,
+    RETRIEVE_SERIAL,
+    RETRIEVE_PARALLEL,
+};
+#define MAX_PADDING 8
 
 #ifndef ENERGY
 #define ENERGY 0
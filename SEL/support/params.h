@@ -5,6 +5,15 @@
 
 typedef struct Params {
     unsigned int   input_size;
+    unsigned int   nr_columns;
+    unsigned int   generic;
+    unsigned int   retrieve;
+    unsigned int   output;
+    int            project;
+    unsigned int   run_length;
+    unsigned int   n_threads;
+    const char     *predicate_text;
+    predicate_t    predicate;
     int   n_warmup;
     int   n_reps;
     int  exp;
@@ -22,24 +31,184 @@ static void usage() {
         "\n"
         "\nBenchmark-specific options:"
         "\n    -i <I>    input size (default=3932160 elements)"
+        "\n    -c <C>    # of columns, up to 4 (default=1)"
+        "\n    -p <P>    predicate (default=\"c0%%2==1\"), in postfix notation. Terms, for column k:"
+        "\n                ck==v ck!=v ck<v ck<=v ck>v ck>=v  comparison"
+        "\n                ck[a,b]                           range a <= x <= b"
+        "\n                ck%%m==r                           modulo"
+        "\n                ck{v,v,...}                       IN-list"
+        "\n              combined with & | ! (e.g., \"c0>100 c1{1,5,7} & c2[10,20] |\")"
+        "\n    -g <G>    use the fast path of the shape of the predicate, if any (0), or disable it and always run the interpreter (1) (default=0)"
+        "\n    -o <O>    output: selected values (0), row ids (1) or bitmap (2) (default=0)"
+        "\n    -j <J>    with a bitmap output, projection of column J on the DPUs (default=none)"
+        "\n    -l <L>    column 0 sorted with runs of L elements on average, run-length encoded on the host and filtered"
+        "\n              on the DPUs without decompression; predicates on column 0 and selected values only (default=0, no runs)"
+        "\n    -r <R>    retrieval of the output: automatic (0), serial (1) or padded parallel (2) (default=0)"
+        "\n    -t <T>    # of host threads for the compaction of the padded output (default=4)"
         "\n");
 }
 
+static void predicate_error(const char *text, const char *s, const char *msg) {
+    fprintf(stderr, "\nInvalid predicate \"%s\" at \"%s\": %s\n", text, s, msg);
+    usage();
+    exit(0);
+}
+
+static T predicate_value(const char *text, const char **s) {
+    char *end;
+    T v = strtoull(*s, &end, 0);
+    if (end == *s)
+        predicate_error(text, *s, "expected a value");
+    *s = end;
+    return v;
+}
+
+// Specialized shape of a single comparison on one column, possibly negated
+static void predicate_shape(predicate_t *pred) {
+    const pred_instr_t *in = &pred->code[0];
+    T lo = 0, hi = UINT64_MAX;
+    pred->shape = SHAPE_GENERIC;
+    pred->shape_column = in->column;
+    pred->shape_invert = pred->length == 2 && pred->code[1].op == PRED_NOT;
+    if (pred->length != 1 + pred->shape_invert)
+        return;
+    switch (in->op) {
+    case PRED_EQ: lo = hi = in->a; break;
+    case PRED_NE: lo = hi = in->a; pred->shape_invert ^= 1; break;
+    case PRED_LT: if (in->a == 0) return; hi = in->a - 1; break;
+    case PRED_LE: hi = in->a; break;
+    case PRED_GT: if (in->a == UINT64_MAX) return; lo = in->a + 1; break;
+    case PRED_GE: lo = in->a; break;
+    case PRED_RANGE: lo = in->a; hi = in->b; break;
+    case PRED_MOD:
+        if ((in->a & (in->a - 1)) == 0 && in->b < in->a) {
+            pred->shape = SHAPE_MASK;
+            pred->shape_a = in->a - 1;
+            pred->shape_b = in->b;
+        }
+        return;
+    default: return;
+    }
+    pred->shape = SHAPE_RANGE;
+    pred->shape_a = lo;
+    pred->shape_b = hi - lo;
+}
+
+// Compile a predicate into bytecode
+static void parse_predicate(predicate_t *pred, const char *text, unsigned int nr_columns) {
+    static const struct { const char *symbol; uint32_t op; } comparisons[] = {
+        {"==", PRED_EQ}, {"!=", PRED_NE}, {"<=", PRED_LE}, {">=", PRED_GE}, {"<", PRED_LT}, {">", PRED_GT},
+    };
+    const char *s = text;
+    unsigned int depth = 0;
+    memset(pred, 0, sizeof(*pred));
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+            continue;
+        }
+        if (pred->length == PRED_MAX_INSTR)
+            predicate_error(text, s, "too many terms");
+        pred_instr_t *in = &pred->code[pred->length++];
+        if (*s == '&' || *s == '|' || *s == '!') {
+            in->op = *s == '&' ? PRED_AND : (*s == '|' ? PRED_OR : PRED_NOT);
+            if (depth < (in->op == PRED_NOT ? 1u : 2u))
+                predicate_error(text, s, "missing operand");
+            depth -= in->op != PRED_NOT;
+            s++;
+            continue;
+        }
+        const char *term = s;
+        if (*s++ != 'c')
+            predicate_error(text, term, "expected a column");
+        in->column = predicate_value(text, &s);
+        if (in->column >= nr_columns)
+            predicate_error(text, term, "column out of range");
+        pred->columns |= 1 << in->column;
+        if (*s == '[') {
+            s++;
+            in->op = PRED_RANGE;
+            in->a = predicate_value(text, &s);
+            if (*s++ != ',')
+                predicate_error(text, term, "expected ','");
+            in->b = predicate_value(text, &s);
+            if (*s++ != ']' || in->a > in->b)
+                predicate_error(text, term, "invalid range");
+        }
+        else if (*s == '{') {
+            in->op = PRED_IN;
+            in->a = pred->nr_in;
+            do {
+                s++;
+                if (pred->nr_in == PRED_MAX_IN)
+                    predicate_error(text, term, "IN-list too long");
+                pred->in_list[pred->nr_in++] = predicate_value(text, &s);
+            } while (*s == ',');
+            if (*s++ != '}')
+                predicate_error(text, term, "expected '}'");
+            in->b = pred->nr_in - in->a;
+        }
+        else if (*s == '%') {
+            s++;
+            in->op = PRED_MOD;
+            in->a = predicate_value(text, &s);
+            if (strncmp(s, "==", 2) != 0 || in->a == 0)
+                predicate_error(text, term, "invalid modulo");
+            s += 2;
+            in->b = predicate_value(text, &s);
+        }
+        else {
+            unsigned int k;
+            for (k = 0; k < sizeof(comparisons) / sizeof(comparisons[0]); k++)
+                if (strncmp(s, comparisons[k].symbol, strlen(comparisons[k].symbol)) == 0)
+                    break;
+            if (k == sizeof(comparisons) / sizeof(comparisons[0]))
+                predicate_error(text, term, "expected a comparison");
+            s += strlen(comparisons[k].symbol);
+            in->op = comparisons[k].op;
+            in->a = predicate_value(text, &s);
+        }
+        if (*s != ' ' && *s != '\0')
+            predicate_error(text, s, "unexpected character");
+        if (++depth > PRED_STACK)
+            predicate_error(text, term, "too many nested terms");
+    }
+    if (depth != 1)
+        predicate_error(text, s, "the predicate must leave exactly one value");
+    predicate_shape(pred);
+}
+
 struct Params input_params(int argc, char **argv) {
     struct Params p;
     p.input_size    = 3932160;
+    p.nr_columns    = 1;
+    p.generic       = 0;
+    p.retrieve      = RETRIEVE_AUTO;
+    p.output        = OUTPUT_VALUES;
+    p.project       = -1;
+    p.run_length    = 0;
+    p.n_threads     = 4;
+    p.predicate_text = "c0%2==1"; // Odd elements
     p.n_warmup      = 1;
     p.n_reps        = 3;
     p.exp           = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hi:w:e:x:")) >= 0) {
+    while((opt = getopt(argc, argv, "hi:c:p:g:o:j:l:r:t:w:e:x:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
         exit(0);
         break;
         case 'i': p.input_size    = atoi(optarg); break;
+        case 'c': p.nr_columns    = atoi(optarg); break;
+        case 'p': p.predicate_text = optarg; break;
+        case 'g': p.generic       = atoi(optarg); break;
+        case 'o': p.output        = atoi(optarg); break;
+        case 'j': p.project       = atoi(optarg); break;
+        case 'l': p.run_length    = atoi(optarg); break;
+        case 'r': p.retrieve      = atoi(optarg); break;
+        case 't': p.n_threads     = atoi(optarg); break;
         case 'w': p.n_warmup      = atoi(optarg); break;
         case 'e': p.n_reps        = atoi(optarg); break;
         case 'x': p.exp           = atoi(optarg); break;
@@ -50,6 +219,14 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    assert(p.retrieve <= RETRIEVE_PARALLEL && "Invalid retrieval mode!");
+    assert(p.output <= OUTPUT_BITMAP && "Invalid output mode!");
+    assert((p.output != OUTPUT_BITMAP || BL >= 9) && "The bitmap of a block must be a multiple of 8 bytes (BL >= 9)!");
+    assert((p.project < 0 || (p.output == OUTPUT_BITMAP && p.project < (int) p.nr_columns)) && "Invalid projection!");
+    assert(p.n_threads > 0 && "Invalid # of host threads!");
+    assert(p.nr_columns > 0 && p.nr_columns <= PRED_MAX_COLUMNS && "Invalid # of columns!");
+    parse_predicate(&p.predicate, p.predicate_text, p.nr_columns);
+    assert((p.run_length == 0 || (p.predicate.columns == 1 && p.output == OUTPUT_VALUES)) && "Run-length encoded input needs a predicate on column 0 and the selected values as output!");
 
     return p;
 }
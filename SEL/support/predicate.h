@@ -0,0 +1,55 @@
+#ifndef _PREDICATE_H_
+#define _PREDICATE_H_
+
+// Predicate bytecode. A predicate is a postfix program over the columns of a row: each comparison
+// pushes a boolean, AND/OR/NOT combine the booleans on top of the stack. Rows for which the program
+// leaves true are selected. The program travels in DPU_INPUT_ARGUMENTS, so a new filter needs
+// neither a rebuild nor a dpu_load
+#define PRED_MAX_INSTR 16
+#define PRED_MAX_IN 32
+#define PRED_STACK 4
+#define PRED_MAX_COLUMNS 4
+
+enum pred_opcodes {
+    PRED_EQ = 0, // x == a
+    PRED_NE,     // x != a
+    PRED_LT,     // x < a
+    PRED_LE,     // x <= a
+    PRED_GT,     // x > a
+    PRED_GE,     // x >= a
+    PRED_RANGE,  // a <= x <= b
+    PRED_MOD,    // x % a == b
+    PRED_IN,     // x in in_list[a .. a + b - 1]
+    PRED_AND,
+    PRED_OR,
+    PRED_NOT,
+};
+
+// Common shapes with a specialized loop on the DPU
+enum pred_shapes {
+    SHAPE_GENERIC = 0, // Interpreter
+    SHAPE_RANGE,       // a <= x <= a + b on a single column (any comparison), or its negation
+    SHAPE_MASK,        // (x & a) == b on a single column (modulo a power of two)
+};
+
+typedef struct {
+    uint32_t op;
+    uint32_t column;
+    T a;
+    T b;
+} pred_instr_t;
+
+typedef struct {
+    uint32_t length;
+    uint32_t columns; // Bitmask of the columns used by the program
+    uint32_t shape;
+    uint32_t shape_column;
+    uint32_t shape_invert;
+    uint32_t nr_in;
+    T shape_a;
+    T shape_b;
+    pred_instr_t code[PRED_MAX_INSTR];
+    T in_list[PRED_MAX_IN];
+} predicate_t;
+
+#endif
@@ -34,8 +34,9 @@ MUTEX_INIT(done_mutex);
 
 extern int main_kernel1(void);
 extern int main_kernel2(void);
+extern int main_kernel3(void);
 
-int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2};
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2, main_kernel3};
 
 int main(void) { 
     // Kernel
@@ -81,6 +82,7 @@ int main_kernel2() {
 #endif
     if (tasklet_id == 0){ // Initialize once the cycle counter
         mem_reset(); // Reset the heap
+        curr_tile = 0; // The DPU set is reused across rounds
     }
     // Barrier
     barrier_wait(&my_barrier);
@@ -89,6 +91,8 @@ int main_kernel2() {
     uint32_t m = DPU_INPUT_ARGUMENTS.m;
     uint32_t n = DPU_INPUT_ARGUMENTS.n;
     uint32_t M_ = DPU_INPUT_ARGUMENTS.M_;
+    if (M_ == 0) // Idle DPU in this round
+        return 0;
     uint32_t done_array = (uint32_t)(DPU_MRAM_HEAP_POINTER + M_ * m * n * sizeof(T));
 
     const uint32_t tile_max = M_ * n - 1; // Tile id upper bound
@@ -129,6 +133,41 @@ int main_kernel2() {
     return 0;
 }
 
+// Steps 2 and 3 out of place: each m x n tile is transposed in WRAM and its n rows
+// are written to their final position in a second copy of the panel. No synchronization
+int main_kernel3() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t A = (uint32_t)DPU_MRAM_HEAP_POINTER; // A in MRAM
+    uint32_t M_ = DPU_INPUT_ARGUMENTS.M_;
+    uint32_t m = DPU_INPUT_ARGUMENTS.m;
+    uint32_t n = DPU_INPUT_ARGUMENTS.n;
+    uint32_t B = (uint32_t)(DPU_MRAM_HEAP_POINTER + M_ * m * n * sizeof(T)); // Transposed panel in MRAM
+
+    T* data = (T*) mem_alloc(m * n * sizeof(T));
+    T* backup = (T*) mem_alloc(m * n * sizeof(T));
+
+    for(unsigned int tile = tasklet_id; tile < M_; tile += NR_TASKLETS){
+        read_tile_step2(A, tile * m * n, data, m, n);
+        for (unsigned int i = 0; i < m * n; i++){
+            backup[(i * m) - (m * n - 1) * (i / n)] = data[i];
+        }
+        for (unsigned int row = 0; row < n; row++){
+            write_tile_step3(B, row * M_ * m + tile * m, backup + row * m, m);
+        }
+    }
+
+    return 0;
+}
+
 // Auxiliary functions
 uint32_t get_tile(){
     mutex_lock(tile_mutex);
@@ -17,6 +17,7 @@
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 // Define the DPU Binary path as DPU_BINARY here
 #ifndef DPU_BINARY
@@ -31,6 +32,7 @@
 static T* A_host;
 static T* A_backup;
 static T* A_result;
+static T* A_tiled;
 
 // Create input arrays
 static void read_input(T* A, unsigned int nr_elements) {
@@ -41,6 +43,44 @@ static void read_input(T* A, unsigned int nr_elements) {
     }
 }
 
+// Step 1 pre-tiling: the n-column panel of each DPU becomes contiguous (M_ * m rows of n elements)
+// Rows and columns beyond the input matrix are padded with zeros
+typedef struct {
+    T *input;
+    T *output;
+    unsigned int rows; // Input rows
+    unsigned int row_elements; // Input columns
+    unsigned int padded_rows; // M_ * m
+    unsigned int n;
+    unsigned int first_dpu;
+    unsigned int nr_dpus;
+} tile_args_t;
+
+// Rows gathered together, so that source rows and destination panels stay in cache
+#define TILE_ROWS 64
+
+static void pre_tile(void *arg, unsigned int thread, unsigned int nr_threads) {
+    tile_args_t *t = (tile_args_t *) arg;
+    uint64_t first, last;
+    pool_range(divceil(t->padded_rows, TILE_ROWS), thread, nr_threads, &first, &last);
+    for (uint64_t tile = first; tile < last; tile++) {
+        uint64_t row_end = (tile + 1) * TILE_ROWS < t->padded_rows ? (tile + 1) * TILE_ROWS : t->padded_rows;
+        for (uint64_t d = t->first_dpu; d < t->first_dpu + t->nr_dpus; d++) {
+            T *output = t->output + d * t->padded_rows * t->n;
+            uint64_t valid = 0; // Columns of the panel inside the input matrix
+            if (d * t->n < t->row_elements)
+                valid = (t->row_elements - d * t->n < t->n) ? t->row_elements - d * t->n : t->n;
+            for (uint64_t j = tile * TILE_ROWS; j < row_end; j++) {
+                if (j >= t->rows)
+                    valid = 0;
+                if (valid > 0)
+                    memcpy(&output[j * t->n], &t->input[j * t->row_elements + d * t->n], valid * sizeof(T));
+                memset(&output[j * t->n + valid], 0, (t->n - valid) * sizeof(T));
+            }
+        }
+    }
+}
+
 // Compute output in the host
 static void trns_host(T* input, unsigned int A, unsigned int B, unsigned int b){
    T* output = (T*) malloc(sizeof(T) * A * B * b);
@@ -70,94 +110,108 @@ int main(int argc, char **argv) {
     DPU_ASSERT(dpu_probe_init("energy_probe", &probe));
 #endif
 
+    // Allocate DPUs and load binary once. In the last round, the DPUs without a panel are idle
+    DPU_ASSERT(dpu_alloc(NR_DPUS, NULL, &dpu_set));
+    DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
+    DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
+    printf("Allocated %d DPU(s)\n", nr_of_dpus);
+
     unsigned int i = 0;
     unsigned int N_ = p.N_;
     const unsigned int n = p.n;
-    const unsigned int M_ = p.M_;
+    unsigned int M_ = p.M_;
     const unsigned int m = p.m;
     N_ = p.exp == 0 ? N_ * NR_DPUS : N_;
+    // Arbitrary rows x cols matrix, padded internally to M_ * m rows and N_ * n columns
+    if (p.rows > 0) {
+        M_ = divceil(p.rows, m);
+        N_ = divceil(p.cols, n);
+    }
+    const unsigned int rows = p.rows > 0 ? p.rows : M_ * m;
+    const unsigned int cols = p.rows > 0 ? p.cols : N_ * n;
 
     // Input/output allocation
-    A_host = malloc(M_ * m * N_ * n * sizeof(T));
-    A_backup = malloc(M_ * m * N_ * n * sizeof(T));
-    A_result = malloc(M_ * m * N_ * n * sizeof(T));
-    T* done_host = malloc(M_ * n); // Host array to reset done array of step 3
-    memset(done_host, 0, M_ * n);
+    A_host = malloc((uint64_t) rows * cols * sizeof(T));
+    A_backup = malloc((uint64_t) rows * cols * sizeof(T));
+    A_result = malloc((uint64_t) M_ * m * N_ * n * sizeof(T));
+    A_tiled = malloc((uint64_t) M_ * m * N_ * n * sizeof(T));
+    const unsigned int done_bytes = divceil(M_ * n, 8) * 8;
+    T* done_host = malloc(done_bytes); // Host array to reset done array of step 3
+    memset(done_host, 0, done_bytes);
+    dpu_arguments_t* input_arguments = malloc(nr_of_dpus * sizeof(dpu_arguments_t));
 
     // Create an input file with arbitrary data
-    read_input(A_host, M_ * m * N_ * n);
-    memcpy(A_backup, A_host, M_ * m * N_ * n * sizeof(T));
+    read_input(A_host, rows * cols);
+    memcpy(A_backup, A_host, (uint64_t) rows * cols * sizeof(T));
 
     // Timer declaration
     Timer timer;
 
+    // Host threads for the step 1 pre-tiling
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+
     printf("NR_TASKLETS\t%d\n", NR_TASKLETS);
     printf("M_\t%u, m\t%u, N_\t%u, n\t%u\n", M_, m, N_, n);
+    if (rows != M_ * m || cols != N_ * n)
+        printf("Matrix %u x %u, padded to %u x %u\n", rows, cols, M_ * m, N_ * n);
+
+    // Out of place when the free MRAM of each DPU holds a second copy of its panel
+    const uint64_t panel_bytes = (uint64_t) M_ * m * n * sizeof(T);
+    const bool out_of_place = p.path == PATH_OUT_OF_PLACE || (p.path == PATH_AUTO && 2 * panel_bytes <= DPU_CAPACITY);
+    assert((out_of_place ? 2 * panel_bytes : panel_bytes + done_bytes) <= DPU_CAPACITY && "Panel does not fit in MRAM!");
+    printf("%s transposition, %lu free MRAM bytes per DPU\n", out_of_place ? "Out-of-place" : "In-place", DPU_CAPACITY - panel_bytes);
 
     // Loop over main kernel
     for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
 
         int timer_fix = 0;
         // Compute output on CPU (performance comparison and verification purposes)
-        memcpy(A_host, A_backup, M_ * m * N_ * n * sizeof(T));
+        memcpy(A_host, A_backup, (uint64_t) rows * cols * sizeof(T));
         if(rep >= p.n_warmup)
             start(&timer, 0, rep - p.n_warmup + timer_fix);
-        trns_host(A_host, M_ * m, N_ * n, 1);
+        trns_host(A_host, rows, cols, 1);
         if(rep >= p.n_warmup)
             stop(&timer, 0);
 
         unsigned int curr_dpu = 0;
         unsigned int active_dpus;
-        unsigned int active_dpus_before = 0;
-        unsigned int first_round = 1;
 
         while(curr_dpu < N_){
-            // Allocate DPUs and load binary
-            if((N_ - curr_dpu) > NR_DPUS){
-                active_dpus = NR_DPUS;
+            // Panels of this round. Idle DPUs get M_ = 0
+            if((N_ - curr_dpu) > nr_of_dpus){
+                active_dpus = nr_of_dpus;
             } else {
                 active_dpus = (N_ - curr_dpu);
             }
-            if((active_dpus_before != active_dpus) && (!(first_round))){
-                DPU_ASSERT(dpu_free(dpu_set));
-                DPU_ASSERT(dpu_alloc(active_dpus, NULL, &dpu_set));
-                DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-                DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-                printf("Allocated %d DPU(s)\n", nr_of_dpus);
-            } else if (first_round){
-                DPU_ASSERT(dpu_alloc(active_dpus, NULL, &dpu_set));
-                DPU_ASSERT(dpu_load(dpu_set, DPU_BINARY, NULL));
-                DPU_ASSERT(dpu_get_nr_dpus(dpu_set, &nr_of_dpus));
-                printf("Allocated %d DPU(s)\n", nr_of_dpus);
-            }
 
             printf("Load input data (step 1)\n");
             if(rep >= p.n_warmup)
                 start(&timer, 1, rep - p.n_warmup + timer_fix);
-            // Load input matrix (step 1)
-            for(unsigned int j = 0; j < M_ * m; j++){
-                unsigned int i = 0;
-                DPU_FOREACH(dpu_set, dpu) {
-                    DPU_ASSERT(dpu_prepare_xfer(dpu, &A_backup[j * N_ * n + n * (i + curr_dpu)]));
-                    i++;
-                }
-                DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, sizeof(T) * j * n, sizeof(T) * n, DPU_XFER_DEFAULT));
+            // Load input matrix (step 1): pre-tiling on the host threads, then one parallel transfer
+            tile_args_t tile_args = {A_backup, A_tiled, rows, cols, M_ * m, n, curr_dpu, active_dpus};
+            pool_run(&pool, pre_tile, &tile_args);
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, &A_tiled[(uint64_t) (i < active_dpus ? i + curr_dpu : 0) * M_ * m * n]));
             }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, sizeof(T) * M_ * m * n, DPU_XFER_DEFAULT));
             if(rep >= p.n_warmup)
                 stop(&timer, 1);
             // Reset done array (for step 3)
-            DPU_FOREACH(dpu_set, dpu) {
-                DPU_ASSERT(dpu_prepare_xfer(dpu, done_host));
+            if (!out_of_place) {
+                DPU_FOREACH(dpu_set, dpu) {
+                    DPU_ASSERT(dpu_prepare_xfer(dpu, done_host));
+                }
+                DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, M_ * m * n * sizeof(T), done_bytes, DPU_XFER_DEFAULT));
             }
-            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, DPU_MRAM_HEAP_POINTER_NAME, M_ * m * n * sizeof(T), (M_ * n) / 8 == 0 ? 8 : M_ * n, DPU_XFER_DEFAULT));
 
-            unsigned int kernel = 0;
-            dpu_arguments_t input_arguments = {m, n, M_, kernel};
+            unsigned int kernel = out_of_place ? 2 : 0;
 	        DPU_FOREACH(dpu_set, dpu, i) {
-	            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments));
+                input_arguments[i] = (dpu_arguments_t) {m, n, i < active_dpus ? M_ : 0, kernel};
+	            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
 	        }
-	        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments), DPU_XFER_DEFAULT));
-            printf("Run step 2 on DPU(s) \n");
+	        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(dpu_arguments_t), DPU_XFER_DEFAULT));
+            printf(out_of_place ? "Run steps 2 and 3 on DPU(s) \n" : "Run step 2 on DPU(s) \n");
             // Run DPU kernel
             if(rep >= p.n_warmup){
                 start(&timer, 2, rep - p.n_warmup + timer_fix);
@@ -184,56 +238,60 @@ int main(int argc, char **argv) {
         }
 #endif
 
-            kernel = 1;
-            dpu_arguments_t input_arguments2 = {m, n, M_, kernel};
-	        DPU_FOREACH(dpu_set, dpu, i) {
-	            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments2));
-	        }
-	        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments2), DPU_XFER_DEFAULT));
-            printf("Run step 3 on DPU(s) \n");
-            // Run DPU kernel
-            if(rep >= p.n_warmup){
-                start(&timer, 3, rep - p.n_warmup + timer_fix);
+            if (!out_of_place) {
+                kernel = 1;
+    	        DPU_FOREACH(dpu_set, dpu, i) {
+                    input_arguments[i].kernel = kernel;
+    	            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
+    	        }
+    	        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(dpu_arguments_t), DPU_XFER_DEFAULT));
+                printf("Run step 3 on DPU(s) \n");
+                // Run DPU kernel
+                if(rep >= p.n_warmup){
+                    start(&timer, 3, rep - p.n_warmup + timer_fix);
 #if ENERGY
-                DPU_ASSERT(dpu_probe_start(&probe));
+                    DPU_ASSERT(dpu_probe_start(&probe));
 #endif
-            }
-            DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
-            if(rep >= p.n_warmup){
-                stop(&timer, 3);
+                }
+                DPU_ASSERT(dpu_launch(dpu_set, DPU_SYNCHRONOUS));
+                if(rep >= p.n_warmup){
+                    stop(&timer, 3);
 #if ENERGY
-                DPU_ASSERT(dpu_probe_stop(&probe));
+                    DPU_ASSERT(dpu_probe_stop(&probe));
 #endif
-            }
+                }
 #if PRINT
-        {
-            unsigned int each_dpu = 0;
-            printf("Display DPU Logs\n");
-            DPU_FOREACH (dpu_set, dpu) {
-                printf("DPU#%d:\n", each_dpu);
-                DPU_ASSERT(dpulog_read_for_dpu(dpu.dpu, stdout));
-                each_dpu++;
+            {
+                unsigned int each_dpu = 0;
+                printf("Display DPU Logs\n");
+                DPU_FOREACH (dpu_set, dpu) {
+                    printf("DPU#%d:\n", each_dpu);
+                    DPU_ASSERT(dpulog_read_for_dpu(dpu.dpu, stdout));
+                    each_dpu++;
+                }
             }
-        }
 #endif
+            }
 
             printf("Retrieve results\n");
             if(rep >= p.n_warmup)
                 start(&timer, 4, rep - p.n_warmup + timer_fix);
-            DPU_FOREACH(dpu_set, dpu) {
-                DPU_ASSERT(dpu_prepare_xfer(dpu, (T*)(&A_result[curr_dpu * m * n * M_])));
-                curr_dpu++;
+            // Idle DPUs write to the (already transferred) pre-tiled buffer
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, i < active_dpus ? &A_result[(uint64_t) (i + curr_dpu) * m * n * M_] : A_tiled));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, out_of_place ? panel_bytes : 0, sizeof(T) * m * n * M_, DPU_XFER_DEFAULT));
+            curr_dpu += active_dpus;
+            // Remove the padding: N_ * n rows of M_ * m elements become cols rows of rows elements
+            if (curr_dpu >= N_ && rows != M_ * m) {
+                for (uint64_t r = 1; r < cols; r++)
+                    memmove(&A_result[r * rows], &A_result[r * M_ * m], rows * sizeof(T));
             }
-            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, 0, sizeof(T) * m * n * M_, DPU_XFER_DEFAULT));
             if(rep >= p.n_warmup)
                 stop(&timer, 4);
 
-            if(first_round){
-                first_round = 0;
-            }
             timer_fix++;
         }
-        DPU_ASSERT(dpu_free(dpu_set));
 
     }
 
@@ -242,10 +300,15 @@ int main(int argc, char **argv) {
     print(&timer, 0, p.n_reps);
     printf("CPU-DPU (Step 1) ");
     print(&timer, 1, p.n_reps);
-    printf("Step 2 ");
-    print(&timer, 2, p.n_reps);
-    printf("Step 3 ");
-    print(&timer, 3, p.n_reps);
+    if (out_of_place) {
+        printf("Out-of-place Steps 2+3 ");
+        print(&timer, 2, p.n_reps);
+    } else {
+        printf("Step 2 ");
+        print(&timer, 2, p.n_reps);
+        printf("Step 3 ");
+        print(&timer, 3, p.n_reps);
+    }
     printf("DPU-CPU ");
     print(&timer, 4, p.n_reps);
 
@@ -257,7 +320,7 @@ int main(int argc, char **argv) {
 
     // Check output
     bool status = true;
-    for (i = 0; i < M_ * m * N_ * n; i++) {
+    for (i = 0; i < rows * cols; i++) {
         if(A_host[i] != A_result[i]){ 
             status = false;
 #if PRINT
@@ -275,7 +338,11 @@ int main(int argc, char **argv) {
     free(A_host);
     free(A_backup);
     free(A_result);
+    free(A_tiled);
     free(done_host);
+    free(input_arguments);
+    pool_free(&pool);
+    DPU_ASSERT(dpu_free(dpu_set));
 	
     return status ? 0 : -1;
 }
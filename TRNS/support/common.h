@@ -20,12 +20,20 @@ typedef struct {
     uint32_t n;
     uint32_t M_;
 	enum kernels {
-	    kernel1 = 0,
-	    kernel2 = 1,
-	    nr_kernels = 2,
+	    kernel1 = 0, // Step 2, in place
+	    kernel2 = 1, // Step 3, in place (cycle following)
+	    kernel3 = 2, // Steps 2 and 3, out of place
+	    nr_kernels = 3,
 	} kernel;
 } dpu_arguments_t;
 
+#define DPU_CAPACITY (64 << 20) // A DPU's capacity is 64 MiB
+
+// Transposition path
+#define PATH_AUTO 0 // Out of place if two copies of the panel fit in MRAM
+#define PATH_IN_PLACE 1
+#define PATH_OUT_OF_PLACE 2
+
 #ifndef ENERGY
 #define ENERGY 0
 #endif
@@ -8,6 +8,10 @@ typedef struct Params {
     unsigned int   m;
     unsigned int   N_;
     unsigned int   n;
+    unsigned int   n_threads;
+    unsigned int   rows;
+    unsigned int   cols;
+    unsigned int   path;
     int   n_warmup;
     int   n_reps;
     int  exp;
@@ -28,6 +32,10 @@ static void usage() {
         "\n    -n <I>    n (default=8 elements)"
         "\n    -o <I>    M_ (default=12288 elements)"
         "\n    -p <I>    N_ (default=1 elements)"
+        "\n    -r <I>    rows of an arbitrary matrix, padded internally (default=0, M_ * m)"
+        "\n    -c <I>    columns of an arbitrary matrix, padded internally (default=N_ * n)"
+        "\n    -i <I>    in-place (1) or out-of-place (2) transposition, or chosen from the free MRAM (0) (default=0)"
+        "\n    -t <I>    # of host threads for the step 1 pre-tiling (default=4)"
         "\n");
 }
 
@@ -37,12 +45,16 @@ struct Params input_params(int argc, char **argv) {
     p.m             = 16;
     p.N_            = 1;
     p.n             = 8;
+    p.n_threads     = 4;
+    p.rows          = 0;
+    p.cols          = 0;
+    p.path          = PATH_AUTO;
     p.n_warmup      = 1;
     p.n_reps        = 3;
     p.exp           = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hw:e:x:m:n:o:p:")) >= 0) {
+    while((opt = getopt(argc, argv, "hw:e:x:m:n:o:p:t:r:c:i:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
@@ -55,6 +67,10 @@ struct Params input_params(int argc, char **argv) {
         case 'n': p.n             = atoi(optarg); break;
         case 'o': p.M_            = atoi(optarg); break;
         case 'p': p.N_            = atoi(optarg); break;
+        case 't': p.n_threads     = atoi(optarg); break;
+        case 'r': p.rows          = atoi(optarg); break;
+        case 'c': p.cols          = atoi(optarg); break;
+        case 'i': p.path          = atoi(optarg); break;
         default:
             fprintf(stderr, "\nUnrecognized option!\n");
             usage();
@@ -62,6 +78,10 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    if (p.rows > 0 && p.cols == 0)
+        p.cols = p.rows;
+    assert((p.rows > 0 || p.cols == 0) && "Columns need the # of rows!");
+    assert(p.path <= PATH_OUT_OF_PLACE && "Invalid transposition path!");
 
     return p;
 }
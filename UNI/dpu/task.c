@@ -10,6 +10,8 @@
 #include <perfcounter.h>
 #include <handshake.h>
 #include <barrier.h>
+#include <atomic_bit.h>
+#include <mutex.h>
 
 #include "../support/common.h"
 
@@ -22,6 +24,9 @@ T        message_value[NR_TASKLETS];
 uint32_t message_offset[NR_TASKLETS];
 uint32_t message_partial_count;
 T        message_last_from_last;
+// Run left open by the preceding blocks (run-length encoding)
+uint32_t message_length[NR_TASKLETS];
+uint32_t message_partial_length;
 
 // UNI in each tasklet
 static unsigned int unique(T *output, T *input){
@@ -49,7 +54,7 @@ static uint3 handshake_sync(T *output, unsigned int l_count, unsigned int taskle
         o_count = message_offset[tasklet_id];
     }
     else{
-        p_count = 0;
+        p_count = message_partial_count;
         offset = (message_last_from_last == output[0])?1:0;
         o_count = 0;
     }
@@ -60,16 +65,149 @@ static uint3 handshake_sync(T *output, unsigned int l_count, unsigned int taskle
         message_offset[tasklet_id + 1] = o_count + offset;
         handshake_notify();
     }
+    else
+        message_partial_count = p_count + l_count - o_count - offset;
     uint3 result = {p_count, o_count, offset}; 
     return result;
 }
 
+// Runs of a block: returns their number, with the length of the last one
+static unsigned int runs(const T *input, unsigned int l_size, unsigned int *l_final){
+    if(l_size == 0)
+        return 0;
+    unsigned int k = 1, final = 0;
+    for(unsigned int j = 1; j < l_size; j++) {
+        if(input[j] != input[j - 1]) {
+            final = j;
+            k++;
+        }
+    }
+    *l_final = l_size - final;
+    return k;
+}
+
+// Handshake with adjacent tasklets (run-length encoding). A block writes the runs that end in it, the last one
+// of the preceding blocks included; its own last run stays open for the next blocks. Returns the output position
+// of the block, and in *o_value and *o_length the run left open by the preceding blocks (*o_length = 0 if none)
+static unsigned int handshake_rle(const T *input, unsigned int k, unsigned int l_size, unsigned int l_final, unsigned int tasklet_id, T *o_value, uint32_t *o_length){
+    unsigned int p_count;
+    // Wait and read message
+    if(tasklet_id != 0){
+        handshake_wait_for(tasklet_id - 1);
+        p_count = message[tasklet_id];
+        *o_value = message_value[tasklet_id];
+        *o_length = message_length[tasklet_id];
+    }
+    else{
+        p_count = message_partial_count;
+        *o_value = message_last_from_last;
+        *o_length = message_partial_length;
+    }
+    // Runs written by this block and run left open
+    unsigned int l_count;
+    T value = *o_value;
+    uint32_t length = *o_length;
+    if(k == 0)
+        l_count = 0;
+    else if(length > 0 && input[0] == value) {
+        l_count = k - 1;
+        length = k == 1 ? length + l_size : l_final;
+        value = input[l_size - 1];
+    }
+    else {
+        l_count = (length > 0) + k - 1;
+        length = l_final;
+        value = input[l_size - 1];
+    }
+    // Write message and notify
+    if(tasklet_id < NR_TASKLETS - 1){
+        message[tasklet_id + 1] = p_count + l_count;
+        message_value[tasklet_id + 1] = value;
+        message_length[tasklet_id + 1] = length;
+        handshake_notify();
+    }
+    else{
+        message_partial_count = p_count + l_count;
+        message_last_from_last = value;
+        message_partial_length = length;
+    }
+    return p_count;
+}
+
+// Append a run to the output buffer of a tasklet, written to MRAM when full
+static void emit(run_t *output, unsigned int *l_count, uint32_t *p_count, T value, uint32_t length, uint32_t mram_base_addr_B){
+    if(*p_count + *l_count == 0) {
+        DPU_RESULTS[0].first = value;
+        DPU_RESULTS[0].first_length = length;
+    }
+    output[*l_count].value = value;
+    output[*l_count].length = length;
+    if(++*l_count == RUNS) {
+        mram_write(output, (__mram_ptr void*)(mram_base_addr_B + *p_count * sizeof(run_t)), RUNS * sizeof(run_t));
+        *p_count += RUNS;
+        *l_count = 0;
+    }
+}
+
 // Barrier
 BARRIER_INIT(my_barrier, NR_TASKLETS);
 
+// Mutexes of the MRAM hash set and the HyperLogLog registers
+ATOMIC_BIT_INIT(table_mutexes)[NR_LOCKS];
+mutex_id_t table_mutex[NR_LOCKS];
+// Mutex of the output count of the hash set
+MUTEX_INIT(count_mutex);
+
+// Shared WRAM filter and HyperLogLog registers
+T *filter;
+uint8_t *registers;
+
+// Multiplicative hash of the 64-bit value folded to 32 bits
+static inline uint32_t hash32(T value){
+    return ((uint32_t)value ^ (uint32_t)((uint64_t)value >> 32)) * 2654435761u;
+}
+
+// Insert a value into the MRAM hash set (linear probing). Returns 1 if the value was not in the set.
+// A slot changes only once, from EMPTY_VALUE to a value, under the mutex of the slot: a tasklet that
+// reads a value in a slot can compare it without the mutex
+static unsigned int insert(__mram_ptr T *table, uint32_t table_log2, T value, uint32_t h, T *cache){
+    uint32_t mask = (1u << table_log2) - 1;
+    uint32_t slot = h >> (32 - table_log2);
+    while(1){
+        mram_read(&table[slot], cache, sizeof(T));
+        if(*cache == EMPTY_VALUE){
+            mutex_id_t mutex = table_mutex[slot & (NR_LOCKS - 1)];
+            mutex_lock(mutex);
+            mram_read(&table[slot], cache, sizeof(T));
+            if(*cache == EMPTY_VALUE){
+                *cache = value;
+                mram_write(cache, &table[slot], sizeof(T));
+                mutex_unlock(mutex);
+                return 1;
+            }
+            mutex_unlock(mutex);
+        }
+        if(*cache == value)
+            return 0;
+        slot = (slot + 1) & mask;
+    }
+}
+
+// Append the new distinct values of a tasklet to the output of the DPU
+static void flush(T *output, unsigned int l_count, uint32_t mram_base_addr_B){
+    mutex_lock(count_mutex);
+    uint32_t p_count = message_partial_count;
+    message_partial_count += l_count;
+    mutex_unlock(count_mutex);
+    mram_write(output, (__mram_ptr void*)(mram_base_addr_B + p_count * sizeof(T)), l_count * sizeof(T));
+}
+
 extern int main_kernel1(void);
+extern int main_kernel2(void);
+extern int main_kernel3(void);
+extern int main_kernel4(void);
 
-int (*kernels[nr_kernels])(void) = {main_kernel1};
+int (*kernels[nr_kernels])(void) = {main_kernel1, main_kernel2, main_kernel3, main_kernel4};
 
 int main(void) { 
     // Kernel
@@ -121,8 +259,9 @@ int main_kernel1() {
         // Sync with adjacent tasklets
         uint3 po_count = handshake_sync(cache_B, l_count, tasklet_id);
 
-        // Write cache to current MRAM block
-        mram_write(&cache_B[po_count.z], (__mram_ptr void*)(mram_base_addr_B + (message_partial_count + po_count.x - po_count.y) * sizeof(T)), l_count * sizeof(T));
+        // Write cache to current MRAM block (without the first element if it repeats the previous block)
+        if(l_count > po_count.z)
+            mram_write(&cache_B[po_count.z], (__mram_ptr void*)(mram_base_addr_B + (po_count.x - po_count.y) * sizeof(T)), (l_count - po_count.z) * sizeof(T));
 
         // First
         if(tasklet_id == 0 && i == 0){
@@ -133,8 +272,7 @@ int main_kernel1() {
         if(tasklet_id == NR_TASKLETS - 1){
             message_last_from_last = cache_B[l_count - 1];
             result->last = cache_B[l_count - 1];
-            result->t_count = message_partial_count + po_count.x + l_count - po_count.y - po_count.z;
-            message_partial_count = result->t_count;
+            result->t_count = po_count.x + l_count - po_count.y - po_count.z;
         }
 
         // Barrier
@@ -145,3 +283,246 @@ int main_kernel1() {
 
     return 0;
 }
+
+// main_kernel2: distinct values of unsorted input. Each value that misses the WRAM filter is inserted into
+// the MRAM hash set; the values new to the set are appended to the output
+int main_kernel2() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+        for (unsigned int i = 0; i < NR_LOCKS; i++)
+            table_mutex[i] = &ATOMIC_BIT_GET(table_mutexes)[i];
+        filter = (T *) mem_alloc(FILTER_ENTRIES * sizeof(T));
+        message_partial_count = 0;
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    dpu_results_t *result = &DPU_RESULTS[tasklet_id];
+
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size; // Input size per DPU in bytes
+    uint32_t table_log2 = DPU_INPUT_ARGUMENTS.table_log2;
+
+    // Address of the current processing block in MRAM
+    uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
+    uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes);
+    __mram_ptr T *table_mram = (__mram_ptr T *)(DPU_MRAM_HEAP_POINTER + 2 * input_size_dpu_bytes);
+
+    // Initialize a local cache to store the MRAM block
+    T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
+    T *cache_B = (T *) mem_alloc(BLOCK_SIZE);
+    T *cache_S = (T *) mem_alloc(sizeof(T));
+
+    // Clear the filter and the MRAM hash set
+    for(unsigned int i = tasklet_id; i < FILTER_ENTRIES; i += NR_TASKLETS){
+        filter[i] = EMPTY_VALUE;
+    }
+    for(unsigned int i = 0; i < REGS; i++){
+        cache_B[i] = EMPTY_VALUE;
+    }
+    uint32_t table_bytes = sizeof(T) << table_log2;
+    for(unsigned int byte_index = tasklet_id << BLOCK_SIZE_LOG2; byte_index < table_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+        uint32_t l_size_bytes = (byte_index + BLOCK_SIZE >= table_bytes) ? (table_bytes - byte_index) : BLOCK_SIZE;
+        mram_write(cache_B, (__mram_ptr void*)((uint32_t)table_mram + byte_index), l_size_bytes);
+    }
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    unsigned int l_count = 0;
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+
+        // Load cache with current MRAM block
+        mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, BLOCK_SIZE);
+
+        for(unsigned int j = 0; j < REGS; j++) {
+            T value = cache_A[j];
+            uint32_t h = hash32(value);
+            T *f = &filter[h & (FILTER_ENTRIES - 1)];
+            if(*f == value)
+                continue;
+            if(insert(table_mram, table_log2, value, h, cache_S)){
+                cache_B[l_count++] = value;
+                if(l_count == REGS){
+                    flush(cache_B, l_count, mram_base_addr_B);
+                    l_count = 0;
+                }
+            }
+            // The value is in the set by now
+            *f = value;
+        }
+    }
+    if(l_count > 0)
+        flush(cache_B, l_count, mram_base_addr_B);
+
+    // Total count in this DPU
+    barrier_wait(&my_barrier);
+    if(tasklet_id == NR_TASKLETS - 1)
+        result->t_count = message_partial_count;
+
+    return 0;
+}
+
+// main_kernel3: HyperLogLog registers of the DPU. The rank of a value is the position of the first one bit
+// after the p bits that select its register. A register is only raised under its mutex, and only after
+// an unlocked read shows that it needs to be (rarely, once the registers have filled)
+int main_kernel3() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    uint32_t hll_p = DPU_INPUT_ARGUMENTS.hll_p;
+    uint32_t hll_m = 1 << hll_p;
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+        for (unsigned int i = 0; i < NR_LOCKS; i++)
+            table_mutex[i] = &ATOMIC_BIT_GET(table_mutexes)[i];
+        registers = (uint8_t *) mem_alloc(hll_m);
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size; // Input size per DPU in bytes
+
+    // Address of the current processing block in MRAM
+    uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
+    uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes);
+
+    // Initialize a local cache to store the MRAM block
+    T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
+
+    for(unsigned int i = tasklet_id; i < hll_m; i += NR_TASKLETS){
+        registers[i] = 0;
+    }
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+
+        // Load cache with current MRAM block
+        mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, BLOCK_SIZE);
+
+        for(unsigned int j = 0; j < REGS; j++) {
+            uint64_t h = hash64(cache_A[j]);
+            uint32_t index = h >> (64 - hll_p);
+            uint8_t rank = __builtin_clzll((h << hll_p) | (1ULL << (hll_p - 1))) + 1;
+            if(rank > registers[index]){
+                mutex_id_t mutex = table_mutex[index & (NR_LOCKS - 1)];
+                mutex_lock(mutex);
+                if(rank > registers[index])
+                    registers[index] = rank;
+                mutex_unlock(mutex);
+            }
+        }
+    }
+
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    // Write the registers to MRAM
+    for(unsigned int byte_index = tasklet_id << 11; byte_index < hll_m; byte_index += 2048 * NR_TASKLETS){
+        uint32_t l_size_bytes = (byte_index + 2048 >= hll_m) ? (hll_m - byte_index) : 2048;
+        mram_write(registers + byte_index, (__mram_ptr void*)(mram_base_addr_B + byte_index), l_size_bytes);
+    }
+
+    return 0;
+}
+
+// main_kernel4: run-length encoding of sorted input, as (value, run length) pairs
+int main_kernel4() {
+    unsigned int tasklet_id = me();
+#if PRINT
+    printf("tasklet_id = %u\n", tasklet_id);
+#endif
+    if (tasklet_id == 0){ // Initialize once the cycle counter
+        mem_reset(); // Reset the heap
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    dpu_results_t *result = &DPU_RESULTS[tasklet_id];
+
+    uint32_t input_size_dpu_bytes = DPU_INPUT_ARGUMENTS.size; // Input size per DPU in bytes
+    uint32_t valid_bytes = DPU_INPUT_ARGUMENTS.valid;
+
+    // Address of the current processing block in MRAM
+    uint32_t base_tasklet = tasklet_id << BLOCK_SIZE_LOG2;
+    uint32_t mram_base_addr_A = (uint32_t)DPU_MRAM_HEAP_POINTER;
+    uint32_t mram_base_addr_B = (uint32_t)(DPU_MRAM_HEAP_POINTER + input_size_dpu_bytes);
+
+    // Initialize a local cache to store the MRAM block
+    T *cache_A = (T *) mem_alloc(BLOCK_SIZE);
+    run_t *cache_B = (run_t *) mem_alloc(BLOCK_SIZE);
+
+    // Initialize shared variable
+    if(tasklet_id == NR_TASKLETS - 1){
+        message_partial_count = 0;
+        message_partial_length = 0;
+    }
+    // Barrier
+    barrier_wait(&my_barrier);
+
+    for(unsigned int byte_index = base_tasklet; byte_index < input_size_dpu_bytes; byte_index += BLOCK_SIZE * NR_TASKLETS){
+
+        // Bound checking: padding elements are not part of any run
+        unsigned int l_size = byte_index >= valid_bytes ? 0 : (byte_index + BLOCK_SIZE >= valid_bytes ? (valid_bytes - byte_index) >> 3 : REGS);
+
+        // Load cache with current MRAM block
+        mram_read((__mram_ptr void const*)(mram_base_addr_A + byte_index), cache_A, BLOCK_SIZE);
+
+        // Runs in each tasklet
+        unsigned int l_final = 0;
+        unsigned int k = runs(cache_A, l_size, &l_final);
+
+        // Sync with adjacent tasklets
+        T o_value;
+        uint32_t o_length;
+        uint32_t p_count = handshake_rle(cache_A, k, l_size, l_final, tasklet_id, &o_value, &o_length);
+
+        // Barrier
+        barrier_wait(&my_barrier);
+
+        // Write the runs that end in this block
+        unsigned int l_count = 0;
+        if(k > 0) {
+            uint32_t extra = 0;
+            if(o_length > 0 && cache_A[0] == o_value)
+                extra = o_length;
+            else if(o_length > 0)
+                emit(cache_B, &l_count, &p_count, o_value, o_length, mram_base_addr_B);
+            unsigned int start = 0;
+            for(unsigned int j = 1; j < l_size; j++) {
+                if(cache_A[j] != cache_A[j - 1]) {
+                    emit(cache_B, &l_count, &p_count, cache_A[j - 1], j - start + extra, mram_base_addr_B);
+                    extra = 0;
+                    start = j;
+                }
+            }
+        }
+        if(l_count > 0)
+            mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_B + p_count * sizeof(run_t)), l_count * sizeof(run_t));
+
+    }
+
+    // The last run of the DPU
+    barrier_wait(&my_barrier);
+    if(tasklet_id == NR_TASKLETS - 1){
+        unsigned int l_count = 0;
+        uint32_t p_count = message_partial_count;
+        if(message_partial_length > 0)
+            emit(cache_B, &l_count, &p_count, message_last_from_last, message_partial_length, mram_base_addr_B);
+        if(l_count > 0)
+            mram_write(cache_B, (__mram_ptr void*)(mram_base_addr_B + p_count * sizeof(run_t)), l_count * sizeof(run_t));
+        result->t_count = p_count + l_count;
+        result->last = message_last_from_last;
+        result->last_length = message_partial_length;
+    }
+
+    return 0;
+}
@@ -12,10 +12,12 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <assert.h>
+#include <math.h>
 
 #include "../support/common.h"
 #include "../support/timer.h"
 #include "../support/params.h"
+#include "../support/pool.h"
 
 // Define the DPU Binary path as DPU_BINARY here
 #ifndef DPU_BINARY
@@ -30,14 +32,20 @@
 static T* A;
 static T* C;
 static T* C2;
+static run_t* R;
+static run_t* R2;
+static uint8_t* registers_dpus;
+static uint8_t* registers;
 
 // Create input arrays
-static void read_input(T* A, unsigned int nr_elements, unsigned int nr_elements_round) {
-    //srand(0);
+static void read_input(T* A, unsigned int nr_elements, unsigned int nr_elements_round, unsigned int mode, uint64_t cardinality, unsigned int run_length) {
+    srand(0);
     printf("nr_elements\t%u\t", nr_elements);
     for (unsigned int i = 0; i < nr_elements; i++) {
-        //A[i] = (T) (rand());
-        A[i] = i%2==0?i:i+1;
+        if(mode == MODE_SORTED || mode == MODE_RLE)
+            A[i] = (T) ((i + 1) / run_length) * run_length;
+        else
+            A[i] = (T) ((((uint64_t) rand() << 31) | rand()) % cardinality);
     }
     for (unsigned int i = nr_elements; i < nr_elements_round; i++) {
         A[i] = A[nr_elements - 1];
@@ -58,6 +66,104 @@ static unsigned int unique_host(T* C, T* A, unsigned int nr_elements) {
     return pos;
 }
 
+// Run-length encoding in the host
+static unsigned int rle_host(run_t* R, T* A, unsigned int nr_elements) {
+    unsigned int pos = 0;
+    R[pos].value = A[0];
+    R[pos].length = 1;
+    for(unsigned int i = 1; i < nr_elements; i++) {
+        if(A[i] != A[i-1]) {
+            pos++;
+            R[pos].value = A[i];
+            R[pos].length = 1;
+        }
+        else
+            R[pos].length++;
+    }
+    return pos + 1;
+}
+
+static int compare(const void *a, const void *b) {
+    T x = *(const T *) a;
+    T y = *(const T *) b;
+    return (x > y) - (x < y);
+}
+
+// Distinct values of unsorted input in the host (sorted)
+static unsigned int distinct_host(T* C, T* A, unsigned int nr_elements) {
+    memcpy(C, A, nr_elements * sizeof(T));
+    qsort(C, nr_elements, sizeof(T), compare);
+    return unique_host(C, C, nr_elements);
+}
+
+// Merge of the distinct values of the DPUs into a hash set: each host thread inserts the values of a range of DPUs
+typedef struct {
+    T *table;
+    uint32_t table_log2;
+    T *values;
+    uint32_t *results_scan;
+    dpu_results_t *results;
+    unsigned int nr_dpus;
+} merge_set_args_t;
+
+static void merge_sets(void *arg, unsigned int thread, unsigned int nr_threads) {
+    merge_set_args_t *m = (merge_set_args_t *) arg;
+    uint64_t mask = (1ULL << m->table_log2) - 1;
+    uint64_t first, last;
+    pool_range(m->nr_dpus, thread, nr_threads, &first, &last);
+    for (uint64_t i = first; i < last; i++) {
+        T *values = m->values + m->results_scan[i];
+        for (unsigned int j = 0; j < m->results[i].t_count; j++) {
+            T value = values[j];
+            uint64_t slot = hash64(value) >> (64 - m->table_log2);
+            while (1) {
+                T expected = EMPTY_VALUE;
+                if (__atomic_compare_exchange_n(&m->table[slot], &expected, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) || expected == value)
+                    break;
+                slot = (slot + 1) & mask;
+            }
+        }
+    }
+}
+
+// Merge of the HyperLogLog registers of the DPUs: each host thread takes the maximum of a range of registers
+typedef struct {
+    uint8_t *registers;
+    uint8_t *registers_dpus;
+    unsigned int hll_m;
+    unsigned int nr_dpus;
+} merge_registers_args_t;
+
+static void merge_registers(void *arg, unsigned int thread, unsigned int nr_threads) {
+    merge_registers_args_t *m = (merge_registers_args_t *) arg;
+    uint64_t first, last;
+    pool_range(m->hll_m, thread, nr_threads, &first, &last);
+    memcpy(&m->registers[first], &m->registers_dpus[first], last - first);
+    for (unsigned int i = 1; i < m->nr_dpus; i++) {
+        uint8_t *partial = m->registers_dpus + (uint64_t) i * m->hll_m;
+        for (uint64_t k = first; k < last; k++) {
+            if (partial[k] > m->registers[k])
+                m->registers[k] = partial[k];
+        }
+    }
+}
+
+// HyperLogLog estimate, with linear counting for small cardinalities
+static double hll_estimate(uint8_t *registers, unsigned int hll_m) {
+    double alpha = hll_m == 16 ? 0.673 : hll_m == 32 ? 0.697 : hll_m == 64 ? 0.709 : 0.7213 / (1.0 + 1.079 / hll_m);
+    double sum = 0.0;
+    unsigned int zeros = 0;
+    for (unsigned int k = 0; k < hll_m; k++) {
+        sum += ldexp(1.0, -registers[k]);
+        if (registers[k] == 0)
+            zeros++;
+    }
+    double estimate = alpha * hll_m * hll_m / sum;
+    if (estimate <= 2.5 * hll_m && zeros > 0)
+        estimate = hll_m * log((double) hll_m / zeros);
+    return estimate;
+}
+
 // Main of the Host Application
 int main(int argc, char **argv) {
 
@@ -86,20 +192,41 @@ int main(int argc, char **argv) {
     const unsigned int input_size_dpu_round = 
         (input_size_dpu_ % (NR_TASKLETS * REGS) != 0) ? roundup(input_size_dpu_, (NR_TASKLETS * REGS)) : input_size_dpu_; // Input size per DPU (max.), 8-byte aligned
 
+    // MRAM hash set with at least twice as many slots as elements per DPU
+    uint32_t table_log2 = 1;
+    while((1ULL << table_log2) < 2ULL * input_size_dpu_round)
+        table_log2++;
+    assert((p.mode != MODE_HASH || 2ULL * input_size_dpu_round * sizeof(T) + (sizeof(T) << table_log2) <= MRAM_CAPACITY) && "Input, output and hash set do not fit in MRAM!");
+    assert((p.mode != MODE_RLE || (uint64_t) input_size_dpu_round * (sizeof(T) + sizeof(run_t)) <= MRAM_CAPACITY) && "Input and runs do not fit in MRAM!");
+    const unsigned int hll_m = 1 << p.hll_p;
+    static const unsigned int mode_kernels[] = {kernel1, kernel2, kernel3, kernel4};
+    const unsigned int kernel = mode_kernels[p.mode];
+
     // Input/output allocation
     A = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
     C = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
     C2 = malloc(input_size_dpu_round * nr_of_dpus * sizeof(T));
+    R = malloc((p.mode == MODE_RLE ? input_size_dpu_round * nr_of_dpus : 1) * sizeof(run_t));
+    R2 = malloc((p.mode == MODE_RLE ? input_size_dpu_round * nr_of_dpus : 1) * sizeof(run_t));
+    registers_dpus = malloc((uint64_t) hll_m * nr_of_dpus);
+    registers = malloc(hll_m);
     T *bufferA = A;
     T *bufferC = C2;
 
     // Create an input file with arbitrary data
-    read_input(A, input_size, input_size_dpu_round * nr_of_dpus);
+    read_input(A, input_size, input_size_dpu_round * nr_of_dpus, p.mode, p.cardinality, p.run_length);
+
+    // Host threads
+    Pool pool;
+    pool_init(&pool, p.n_threads);
+    merge_registers_args_t merge_registers_args = {registers, registers_dpus, hll_m, nr_of_dpus};
+    double estimate = 0.0;
 
     // Timer declaration
     Timer timer;
 
-    printf("NR_TASKLETS\t%d\tBL\t%d\n", NR_TASKLETS, BL);
+    static const char *mode_names[] = {"sorted", "hash", "hll", "rle"};
+    printf("NR_TASKLETS\t%d\tBL\t%d\tmode\t%s\n", NR_TASKLETS, BL, mode_names[p.mode]);
 
     // Loop over main kernel
     for(int rep = 0; rep < p.n_warmup + p.n_reps; rep++) {
@@ -107,7 +234,12 @@ int main(int argc, char **argv) {
         // Compute output on CPU (performance comparison and verification purposes)
         if(rep >= p.n_warmup)
             start(&timer, 0, rep - p.n_warmup);
-        total_count = unique_host(C, A, input_size);
+        if(p.mode == MODE_SORTED)
+            total_count = unique_host(C, A, input_size);
+        else if(p.mode == MODE_RLE)
+            total_count = rle_host(R, A, input_size);
+        else
+            total_count = distinct_host(C, A, input_size);
         if(rep >= p.n_warmup)
             stop(&timer, 0);
 
@@ -116,14 +248,22 @@ int main(int argc, char **argv) {
             start(&timer, 1, rep - p.n_warmup);
         // Input arguments
         const unsigned int input_size_dpu = input_size_dpu_round;
-        unsigned int kernel = 0;
-        dpu_arguments_t input_arguments = {input_size_dpu * sizeof(T), kernel};
+        dpu_arguments_t input_arguments[NR_DPUS];
+        for(i=0; i<nr_of_dpus; i++) {
+            unsigned int first = input_size_dpu * i;
+            unsigned int rows = first >= input_size ? 0 : (input_size - first < input_size_dpu ? input_size - first : input_size_dpu);
+            input_arguments[i].size=input_size_dpu * sizeof(T);
+            input_arguments[i].valid=rows * sizeof(T);
+            input_arguments[i].table_log2=table_log2;
+            input_arguments[i].hll_p=p.hll_p;
+            input_arguments[i].kernel=kernel;
+        }
         // Copy input arrays
         i = 0;
         DPU_FOREACH(dpu_set, dpu, i) {
-            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments));
+            DPU_ASSERT(dpu_prepare_xfer(dpu, &input_arguments[i]));
         }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments), DPU_XFER_DEFAULT));
+        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_TO_DPU, "DPU_INPUT_ARGUMENTS", 0, sizeof(input_arguments[0]), DPU_XFER_DEFAULT));
         DPU_FOREACH(dpu_set, dpu, i) {
             DPU_ASSERT(dpu_prepare_xfer(dpu, bufferA + input_size_dpu * i));
         }
@@ -160,72 +300,139 @@ int main(int argc, char **argv) {
 #endif
 
         printf("Retrieve results\n");
-        dpu_results_t results[nr_of_dpus];
-        uint32_t* results_scan = malloc(nr_of_dpus * sizeof(uint32_t));
-        uint32_t* offset = calloc(nr_of_dpus, sizeof(uint32_t));
-        uint32_t* offset_scan = calloc(nr_of_dpus, sizeof(uint32_t));
-        i = 0;
-        accum = 0;
-
-        if(rep >= p.n_warmup)
-            start(&timer, 3, rep - p.n_warmup);
-        // PARALLEL RETRIEVE TRANSFER
-        dpu_results_t* results_retrieve[nr_of_dpus];
-
-        DPU_FOREACH(dpu_set, dpu, i) {
-            results_retrieve[i] = (dpu_results_t*)malloc(NR_TASKLETS * sizeof(dpu_results_t));
-            DPU_ASSERT(dpu_prepare_xfer(dpu, results_retrieve[i]));
-        }
-        DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, "DPU_RESULTS", 0, NR_TASKLETS * sizeof(dpu_results_t), DPU_XFER_DEFAULT));
-
-        DPU_FOREACH(dpu_set, dpu, i) {
-            // Retrieve tasklet timings
-            for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
-                // First output element of this DPU
-                if(each_tasklet == 0){
-                    results[i].first = results_retrieve[i][each_tasklet].first;
+        if(p.mode != MODE_HLL) {
+            dpu_results_t results[nr_of_dpus];
+            uint32_t* results_scan = malloc(nr_of_dpus * sizeof(uint32_t));
+            uint32_t* offset = calloc(nr_of_dpus, sizeof(uint32_t));
+            uint32_t* offset_scan = calloc(nr_of_dpus, sizeof(uint32_t));
+            i = 0;
+            accum = 0;
+
+            if(rep >= p.n_warmup)
+                start(&timer, 3, rep - p.n_warmup);
+            // PARALLEL RETRIEVE TRANSFER
+            dpu_results_t* results_retrieve[nr_of_dpus];
+
+            DPU_FOREACH(dpu_set, dpu, i) {
+                results_retrieve[i] = (dpu_results_t*)malloc(NR_TASKLETS * sizeof(dpu_results_t));
+                DPU_ASSERT(dpu_prepare_xfer(dpu, results_retrieve[i]));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, "DPU_RESULTS", 0, NR_TASKLETS * sizeof(dpu_results_t), DPU_XFER_DEFAULT));
+
+            DPU_FOREACH(dpu_set, dpu, i) {
+                // Retrieve tasklet timings
+                for (unsigned int each_tasklet = 0; each_tasklet < NR_TASKLETS; each_tasklet++) {
+                    // First output element of this DPU
+                    if(each_tasklet == 0){
+                        results[i].first = results_retrieve[i][each_tasklet].first;
+                        results[i].first_length = results_retrieve[i][each_tasklet].first_length;
+                    }
+                    // Last output element of this DPU and count
+                    if(each_tasklet == NR_TASKLETS - 1){
+                        results[i].t_count = results_retrieve[i][each_tasklet].t_count;
+                        results[i].last = results_retrieve[i][each_tasklet].last;
+                        results[i].last_length = results_retrieve[i][each_tasklet].last_length;
+                    }
                 }
-                // Last output element of this DPU and count
-                if(each_tasklet == NR_TASKLETS - 1){
-                    results[i].t_count = results_retrieve[i][each_tasklet].t_count;
-                    results[i].last = results_retrieve[i][each_tasklet].last;
+                // Check if first(i) == last(i-1) -- offset (sorted input only)
+                if(i != 0 && (p.mode == MODE_SORTED || p.mode == MODE_RLE)){
+                    if(p.mode == MODE_RLE && results[i].t_count == 0){ // Only padding in this DPU
+                        results[i].last = results[i - 1].last;
+                        results[i].last_length = results[i - 1].last_length;
+                    }
+                    else if(results[i].first == results[i - 1].last)
+                        offset[i] = 1;
+                    // Sequential scan - offset
+                    offset_scan[i] += offset[i];
                 }
-            }
-            // Check if first(i) == last(i-1) -- offset
-            if(i != 0){
-                if(results[i].first == results[i - 1].last)
-                    offset[i] = 1;
-                // Sequential scan - offset
-                offset_scan[i] += offset[i];
-            }
-            // Sequential scan
-            uint32_t temp = results[i].t_count - offset[i];
-            results_scan[i] = accum;
-            accum += temp;
+                // Sequential scan
+                uint32_t temp = results[i].t_count - offset[i];
+                results_scan[i] = accum;
+                accum += temp;
 #if PRINT
-            printf("i=%d -- %u,  %u, %u -- %u\n", i, results_scan[i], accum, temp, offset_scan[i]);
+                printf("i=%d -- %u,  %u, %u -- %u\n", i, results_scan[i], accum, temp, offset_scan[i]);
 #endif
-            free(results_retrieve[i]);
-        }
-        if(rep >= p.n_warmup)
-		    stop(&timer, 3);
+                free(results_retrieve[i]);
+            }
+            if(rep >= p.n_warmup)
+                stop(&timer, 3);
 
-        i = 0;
-        if(rep >= p.n_warmup)
-            start(&timer, 4, rep - p.n_warmup);
-        DPU_FOREACH (dpu_set, dpu) {
-            // Copy output array
-            DPU_ASSERT(dpu_copy_from(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), bufferC + results_scan[i] - offset_scan[i], results[i].t_count * sizeof(T)));
+            i = 0;
+            if(rep >= p.n_warmup)
+                start(&timer, 4, rep - p.n_warmup);
+            DPU_FOREACH (dpu_set, dpu) {
+                // Copy output array
+                if(p.mode == MODE_RLE){
+                    if(results[i].t_count > 0)
+                        DPU_ASSERT(dpu_copy_from(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), R2 + results_scan[i] - offset_scan[i], results[i].t_count * sizeof(run_t)));
+                }
+                else
+                    DPU_ASSERT(dpu_copy_from(dpu, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), bufferC + results_scan[i] - offset_scan[i], results[i].t_count * sizeof(T)));
 
-            i++;
-        }
-        if(rep >= p.n_warmup)
-            stop(&timer, 4);
+                i++;
+            }
+            // A run split between DPUs is written once, with the lengths of all its parts
+            if(p.mode == MODE_RLE){
+                uint32_t length = results[0].last_length;
+                for(i = 1; i < nr_of_dpus; i++) {
+                    if(results[i].t_count == 0)
+                        continue;
+                    if(offset[i]){
+                        R2[results_scan[i] - offset_scan[i]].length = length + results[i].first_length;
+                        length = results[i].t_count == 1 ? length + results[i].first_length : results[i].last_length;
+                    }
+                    else
+                        length = results[i].last_length;
+                }
+            }
+            if(rep >= p.n_warmup)
+                stop(&timer, 4);
+
+            // Merge of the distinct values of the DPUs in a host hash set
+            if(p.mode == MODE_HASH) {
+                if(rep >= p.n_warmup)
+                    start(&timer, 5, rep - p.n_warmup);
+                uint32_t merge_log2 = 1;
+                while((1ULL << merge_log2) < 2ULL * accum)
+                    merge_log2++;
+                T *table_host = malloc(sizeof(T) << merge_log2);
+                for(uint64_t slot = 0; slot < (1ULL << merge_log2); slot++)
+                    table_host[slot] = EMPTY_VALUE;
+                merge_set_args_t merge_set_args = {table_host, merge_log2, bufferC, results_scan, results, nr_of_dpus};
+                pool_run(&pool, merge_sets, &merge_set_args);
+                accum = 0;
+                for(uint64_t slot = 0; slot < (1ULL << merge_log2); slot++)
+                    if(table_host[slot] != EMPTY_VALUE)
+                        bufferC[accum++] = table_host[slot];
+                free(table_host);
+                if(rep >= p.n_warmup)
+                    stop(&timer, 5);
+            }
 
-        // Free memory
-        free(results_scan);
-        free(offset);
-        free(offset_scan);
+            // Free memory
+            free(results_scan);
+            free(offset);
+            free(offset_scan);
+        }
+        else {
+            if(rep >= p.n_warmup)
+                start(&timer, 4, rep - p.n_warmup);
+            // PARALLEL RETRIEVE TRANSFER
+            DPU_FOREACH(dpu_set, dpu, i) {
+                DPU_ASSERT(dpu_prepare_xfer(dpu, registers_dpus + (uint64_t) hll_m * i));
+            }
+            DPU_ASSERT(dpu_push_xfer(dpu_set, DPU_XFER_FROM_DPU, DPU_MRAM_HEAP_POINTER_NAME, input_size_dpu * sizeof(T), hll_m, DPU_XFER_DEFAULT));
+            if(rep >= p.n_warmup)
+                stop(&timer, 4);
+
+            // Merge of the HyperLogLog registers of the DPUs and estimate
+            if(rep >= p.n_warmup)
+                start(&timer, 5, rep - p.n_warmup);
+            pool_run(&pool, merge_registers, &merge_registers_args);
+            estimate = hll_estimate(registers, hll_m);
+            if(rep >= p.n_warmup)
+                stop(&timer, 5);
+        }
 
     }
 
@@ -236,10 +443,16 @@ int main(int argc, char **argv) {
     print(&timer, 1, p.n_reps);
     printf("DPU Kernel ");
     print(&timer, 2, p.n_reps);
-    printf("Inter-DPU ");
-    print(&timer, 3, p.n_reps);
+    if(p.mode != MODE_HLL) {
+        printf("Inter-DPU ");
+        print(&timer, 3, p.n_reps);
+    }
     printf("DPU-CPU ");
     print(&timer, 4, p.n_reps);
+    if(p.mode == MODE_HASH || p.mode == MODE_HLL) {
+        printf("Merge ");
+        print(&timer, 5, p.n_reps);
+    }
 
 #if ENERGY
     double energy;
@@ -249,7 +462,29 @@ int main(int argc, char **argv) {
 
     // Check output
     bool status = true;
-    if(accum != total_count) status = false;
+    if(p.mode == MODE_HLL) {
+        // Within 4 standard errors of the exact count
+        double error = (estimate - total_count) / total_count;
+        printf("\nHLL estimate\t%.0f\texact\t%u\terror (%%)\t%.2f\n", estimate, total_count, 100.0 * error);
+        status = fabs(error) <= 4 * 1.04 / sqrt(hll_m);
+        accum = 0;
+    }
+    else if(accum != total_count) status = false;
+    if(p.mode == MODE_RLE) {
+        printf("\nRuns\t%u\tCompression\t%.2f\n", accum, (double) input_size * sizeof(T) / (accum * sizeof(run_t)));
+        for (i = 0; i < accum; i++) {
+            if(R[i].value != R2[i].value || R[i].length != R2[i].length) {
+                status = false;
+#if PRINT
+                printf("%d: %ld %u -- %ld %u\n", i, R[i].value, R[i].length, R2[i].value, R2[i].length);
+#endif
+            }
+        }
+        accum = 0;
+    }
+    // The distinct values of unsorted input come in no particular order
+    if(p.mode == MODE_HASH)
+        qsort(bufferC, accum, sizeof(T), compare);
 #if PRINT
     printf("accum %u, total_count %u\n", accum, total_count);
 #endif
@@ -268,9 +503,14 @@ int main(int argc, char **argv) {
     }
 
     // Deallocation
+    pool_free(&pool);
+    free(registers_dpus);
+    free(registers);
     free(A);
     free(C);
     free(C2);
+    free(R);
+    free(R2);
     DPU_ASSERT(dpu_free(dpu_set));
 	
     return status ? 0 : -1;
@@ -4,13 +4,34 @@
 // Data type
 #define T int64_t
 #define REGS (BLOCK_SIZE >> 3) // 64 bits
+#define EMPTY_VALUE INT64_MIN // A value that is not in the input array
+
+// Unique over sorted input (adjacent duplicates), distinct values of unsorted input, or approximate count-distinct
+#define MODE_SORTED 0
+#define MODE_HASH 1
+#define MODE_HLL 2
+#define MODE_RLE 3
+
+// Shared WRAM filter (entries) in front of the MRAM hash set: a value found in the filter is already in the set
+#define FILTER_ENTRIES 1024
+// Mutexes protecting the insertion into the MRAM hash set and the HyperLogLog registers
+#define NR_LOCKS 8
+// HyperLogLog precision: 2^p one-byte registers per DPU
+#define HLL_P_MIN 4
+#define HLL_P_MAX 14
 
 // Structures used by both the host and the dpu to communicate information
 typedef struct {
     uint32_t size;
+    uint32_t valid; // Elements of this DPU that are not padding, in bytes
+    uint32_t table_log2; // Slots of the MRAM hash set (log2)
+    uint32_t hll_p; // HyperLogLog precision
 	enum kernels {
-	    kernel1 = 0,
-	    nr_kernels = 1,
+	    kernel1 = 0, // Unique of sorted input
+	    kernel2 = 1, // Distinct values with a hash set in MRAM
+	    kernel3 = 2, // HyperLogLog registers
+	    kernel4 = 3, // Run-length encoding of sorted input
+	    nr_kernels = 4,
 	} kernel;
 } dpu_arguments_t;
 
@@ -18,8 +39,17 @@ typedef struct {
     uint32_t t_count;
     T first;
     T last;
+    uint32_t first_length; // Run-length encoding: length of the first and last run
+    uint32_t last_length;
 } dpu_results_t;
 
+// Run of equal values of a run-length encoded column
+typedef struct {
+    T value;
+    uint32_t length;
+} run_t;
+#define RUNS (BLOCK_SIZE / sizeof(run_t)) // Runs in a block
+
 // Transfer size between MRAM and WRAM
 #ifdef BL
 #define BLOCK_SIZE_LOG2 BL
@@ -30,6 +60,16 @@ typedef struct {
 #define BL BLOCK_SIZE_LOG2
 #endif
 
+// 64-bit mixer (MurmurHash3 fmix64) for the HyperLogLog registers and the host hash set
+static inline uint64_t hash64(uint64_t x){
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
 typedef struct{unsigned int x; unsigned int y; unsigned int z;} uint3;
 
 #ifndef ENERGY
@@ -37,6 +77,8 @@ typedef struct{unsigned int x; unsigned int y; unsigned int z;} uint3;
 #endif
 #define PRINT 0
 
+#define MRAM_CAPACITY (64 << 20)
+
 #define ANSI_COLOR_RED     "\x1b[31m"
 #define ANSI_COLOR_GREEN   "\x1b[32m"
 #define ANSI_COLOR_RESET   "\x1b[0m"
@@ -5,6 +5,11 @@
 
 typedef struct Params {
     unsigned int   input_size;
+    unsigned int   mode;
+    uint64_t       cardinality;
+    unsigned int   hll_p;
+    unsigned int   run_length;
+    unsigned int   n_threads;
     int   n_warmup;
     int   n_reps;
     int  exp;
@@ -19,27 +24,43 @@ static void usage() {
         "\n    -w <W>    # of untimed warmup iterations (default=1)"
         "\n    -e <E>    # of timed repetition iterations (default=3)"
         "\n    -x <X>    Weak (0) or strong (1) scaling (default=0)"
+        "\n    -t <T>    # of host threads for the merge of the DPU results (default=4)"
         "\n"
         "\nBenchmark-specific options:"
-        "\n    -i <I>    input size (default=3932160 elements)"
+        "\n    -i <I>    input size (default=3932160 elements, 1M with -m 1 and -m 3)"
+        "\n    -m <M>    0 unique of sorted input, 1 distinct values of unsorted input (hash set), 2 approximate count-distinct (HyperLogLog),"
+        "\n              3 run-length encoding of sorted input (default=0)"
+        "\n    -l <L>    run length of the sorted input (default=2)"
+        "\n    -k <K>    distinct values of the unsorted input (default=65536)"
+        "\n    -p <P>    HyperLogLog precision, 2^P registers per DPU (default=12)"
         "\n");
 }
 
 struct Params input_params(int argc, char **argv) {
     struct Params p;
-    p.input_size    = 3932160;
+    p.input_size    = 0;
+    p.mode          = MODE_SORTED;
+    p.cardinality   = 65536;
+    p.hll_p         = 12;
+    p.run_length    = 2;
+    p.n_threads     = 4;
     p.n_warmup      = 1;
     p.n_reps        = 3;
     p.exp           = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "hi:w:e:x:")) >= 0) {
+    while((opt = getopt(argc, argv, "hi:m:k:p:l:t:w:e:x:")) >= 0) {
         switch(opt) {
         case 'h':
         usage();
         exit(0);
         break;
         case 'i': p.input_size    = atoi(optarg); break;
+        case 'm': p.mode          = atoi(optarg); break;
+        case 'k': p.cardinality   = strtoull(optarg, NULL, 10); break;
+        case 'p': p.hll_p         = atoi(optarg); break;
+        case 'l': p.run_length    = atoi(optarg); break;
+        case 't': p.n_threads     = atoi(optarg); break;
         case 'w': p.n_warmup      = atoi(optarg); break;
         case 'e': p.n_reps        = atoi(optarg); break;
         case 'x': p.exp           = atoi(optarg); break;
@@ -50,6 +71,13 @@ struct Params input_params(int argc, char **argv) {
         }
     }
     assert(NR_DPUS > 0 && "Invalid # of dpus!");
+    assert(p.mode <= MODE_RLE && "Invalid mode!");
+    assert(p.run_length > 0 && "Invalid run length!");
+    assert(p.cardinality > 0 && "Invalid # of distinct values!");
+    assert(p.hll_p >= HLL_P_MIN && p.hll_p <= HLL_P_MAX && "Invalid HyperLogLog precision!");
+    assert(p.n_threads > 0 && "Invalid # of host threads!");
+    if(p.input_size == 0)
+        p.input_size = (p.mode == MODE_HASH || p.mode == MODE_RLE) ? (1 << 20) : 3932160;
 
     return p;
 }